@@ -34,6 +34,12 @@ struct ArkanoidSettings
     float ball_speed = 150.0f;
 
     float carriage_width = 100.0f;
+
+    unsigned int seed = 1337;   // level layout and gameplay randomness
+
+    int level_generator = 0;        // index into level_generators (levelgen.h), 0 = classic grid
+    float level_density = 0.85f;    // share of filled cells (not used by classic)
+    float level_difficulty = 0.5f;  // 0..1 hit point curve (not used by classic)
 };
 
 struct ArkanoidDebugData
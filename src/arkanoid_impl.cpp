@@ -1,4 +1,9 @@
 ﻿#include "arkanoid_impl.h"
+#include "draw_geometry.h"
+#include "event_log.h"
+#include "level_cache.h"
+#include "metrics.h"
+#include "probes.h"
 #include <GLFW/glfw3.h>
 #include <algorithm>
 #include <random>
@@ -6,6 +11,7 @@
 #include <cmath>
 #include <string>
 #include <sstream>
+#include <cstring>
 
 #ifdef USE_ARKANOID_IMPL
 // Factory function to create an Arkanoid instance
@@ -33,6 +39,26 @@ static inline Rect make_rect_xywh(float x, float y, float w, float h) {
     return r;
 }
 
+// Brick color with 'hp' hit points left: warmer and darker as it takes damage
+static ImU32 damaged_brick_color(ImU32 base, int hp) {
+    int r = (base >> IM_COL32_R_SHIFT) & 255;
+    int g = (base >> IM_COL32_G_SHIFT) & 255;
+    int bl = (base >> IM_COL32_B_SHIFT) & 255;
+
+    if (hp == 2) {
+        r = std::min(255, r + 30);
+        g = std::max(60, g - 20);
+        bl = std::max(30, bl - 60);
+    }
+    else if (hp == 1) {
+        r = std::min(255, r + 60);
+        g = std::max(40, g - 40);
+        bl = std::max(20, bl - 100);
+    }
+
+    return IM_COL32(r, g, bl, 255);
+}
+
 
 
 // ----------------- Money & Shop -----------------
@@ -44,15 +70,64 @@ bool ArkanoidImpl::try_purchase(int cost) {
         balance -= cost;
         shop_message = "Purchased for $" + std::to_string(cost) + "!";
         shop_message_timer = shop_message_duration;
+        ARK_PROBE3(purchase, cost, balance, 1);
+        log_purchase(GameEventType::Purchase, cost);
         return true;
     }
     else {
         shop_message = "Not enough $";
         shop_message_timer = shop_message_duration;
+        ARK_PROBE3(purchase, cost, balance, 0);
+        log_purchase(GameEventType::PurchaseFailed, cost);
         return false;
     }
 }
 
+// ----------------- Event Log -----------------
+
+static inline void log_event(const GameEvent& e) {
+    if (GameEventLog* log = event_sink()) log->append(e);
+}
+
+void ArkanoidImpl::log_purchase(GameEventType type, int cost) const {
+    if (!event_sink()) return;
+    GameEvent e;
+    e.type = (uint8_t)type;
+    e.score = score;
+    e.value = cost;
+    e.money = balance * 100;
+    log_event(e);
+}
+
+// Brick events carry the cell and what the hit earned, in score and in shop cents
+void ArkanoidImpl::log_brick_event(GameEventType type, int index, int gained) const {
+    if (!event_sink()) return;
+    GameEvent e;
+    e.type = (uint8_t)type;
+    e.row = (int16_t)(index / bricks_cols);
+    e.col = (int16_t)(index % bricks_cols);
+    e.combo = (int16_t)combo_mult;
+    e.hit_points = (int16_t)(bricks[index].alive ? bricks[index].hit_points : 0);
+    e.score = score;
+    e.value = gained;
+    e.money = gained * 100 / score_per_dollar;
+    log_event(e);
+}
+
+void ArkanoidImpl::end_combo_chain() {
+    if (combo_chain > 0 && event_sink()) {
+        GameEvent e;
+        e.type = (uint8_t)GameEventType::ComboEnd;
+        e.combo = (int16_t)std::min(combo_chain, 32767);
+        e.score = score;
+        e.value = combo_chain;
+        log_event(e);
+    }
+    combo_chain = 0;
+}
+
+
+
 // Add money to balance and total_money counters
 void ArkanoidImpl::add_money(int amount) {
     if (amount <= 0) return;
@@ -77,12 +152,257 @@ void ArkanoidImpl::grant_money_from_score() {
 
 
 
+// ----------------- State Digest -----------------
+
+void ArkanoidStateDigest::set_float(Field f, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    fields[f] = bits;
+}
+
+// FNV-1a over all fields
+uint64_t ArkanoidStateDigest::hash() const {
+    uint64_t h = 14695981039346656037ull;
+    for (uint32_t v : fields) {
+        for (int i = 0; i < 4; ++i) {
+            h ^= (v >> (i * 8)) & 255;
+            h *= 1099511628211ull;
+        }
+    }
+    return h;
+}
+
+const char* ArkanoidStateDigest::field_name(int f) {
+    static const char* names[Count] = {
+        "state", "score", "lives", "balance", "total_money", "combo_mult", "destroyed_bricks",
+        "alive_bricks", "bricks_hash", "bonus_count", "bonus_hash",
+        "ball_pos.x", "ball_pos.y", "ball_vel.x", "ball_vel.y", "ball_speed_cur", "ball_speed_target",
+        "carriage.x", "carriage.w", "flags",
+    };
+    return (f >= 0 && f < Count) ? names[f] : "?";
+}
+
+bool ArkanoidStateDigest::field_is_float(int f) {
+    return (f >= BallPosX && f <= CarriageW);
+}
+
+std::string ArkanoidStateDigest::format_field(int f, uint32_t value) {
+    char buf[64];
+    if (field_is_float(f)) {
+        float v;
+        memcpy(&v, &value, sizeof(v));
+        snprintf(buf, sizeof(buf), "%.6g", v);
+    }
+    else if (f == BricksHash || f == BonusHash || f == Flags) snprintf(buf, sizeof(buf), "0x%08x", value);
+    else snprintf(buf, sizeof(buf), "%d", (int)value);
+    return buf;
+}
+
+// Small FNV-1a step used to fold entity lists into a single digest field
+static inline uint32_t fnv1a32(uint32_t h, const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+void ArkanoidImpl::capture_digest(ArkanoidStateDigest& d) const {
+    using F = ArkanoidStateDigest;
+    d.set_int(F::State, (int)state);
+    d.set_int(F::Score, score);
+    d.set_int(F::Lives, lives);
+    d.set_int(F::Balance, balance);
+    d.set_int(F::TotalMoney, total_money);
+    d.set_int(F::ComboMult, combo_mult);
+    d.set_int(F::DestroyedBricks, destroyed_bricks_count);
+
+    int alive = 0;
+    uint32_t bh = 2166136261u;
+    for (const auto& b : bricks) {
+        int32_t v[2] = { b.alive ? (b.hidden ? 2 : 1) : 0, b.hit_points };
+        bh = fnv1a32(bh, v, sizeof(v));
+        if (b.alive) alive++;
+    }
+    d.set_int(F::AliveBricks, alive);
+    d.fields[F::BricksHash] = bh;
+
+    uint32_t oh = 2166136261u;
+    for (const auto& b : bonuses) {
+        float v[2] = { b.rect_world.pos.x, b.rect_world.pos.y };
+        int32_t t = (int32_t)b.type;
+        oh = fnv1a32(oh, v, sizeof(v));
+        oh = fnv1a32(oh, &t, sizeof(t));
+    }
+    d.set_int(F::BonusCount, (int)bonuses.size());
+    d.fields[F::BonusHash] = oh;
+
+    d.set_float(F::BallPosX, ball_pos.x);
+    d.set_float(F::BallPosY, ball_pos.y);
+    d.set_float(F::BallVelX, ball_vel.x);
+    d.set_float(F::BallVelY, ball_vel.y);
+    d.set_float(F::BallSpeedCur, ball_speed_cur);
+    d.set_float(F::BallSpeedTarget, ball_speed_target);
+    d.set_float(F::CarriageX, carriage_world.pos.x);
+    d.set_float(F::CarriageW, carriage_world.size.x);
+
+    uint32_t flags = 0;
+    flags |= pierce_mode ? 1u : 0u;
+    flags |= slowmo_mode ? 2u : 0u;
+    flags |= magnet_active ? 4u : 0u;
+    flags |= score_mult_active ? 8u : 0u;
+    flags |= cheat_invincible ? 16u : 0u;
+    flags |= (freeze_timer > 0.0f) ? 32u : 0u;
+    flags |= paused ? 64u : 0u;
+    flags |= (uint32_t)score_mult_value << 8;
+    d.fields[F::Flags] = flags;
+}
+
+
+
+void ArkanoidImpl::observe(Observation& o) const {
+    o.ball_pos = ball_pos;
+    o.ball_vel = ball_vel;
+    o.ball_radius = ball_radius;
+    o.carriage = carriage_world;
+    o.world_size = world_size;
+    o.playing = state == GameState::Playing;
+    o.won = state == GameState::Win;
+    o.score = score;
+    o.lives = lives;
+    o.balance = balance;
+    o.total_money = total_money;
+    o.destroyed_bricks = destroyed_bricks_count;
+}
+
+
+
+// ----------------- State Snapshot -----------------
+
+// Every gameplay member, in serialization order. Keep in sync with arkanoid_impl.h;
+// purely visual and diagnostic state (geometry cache, perf, quality) is left out.
+#define ARKANOID_STATE_FIELDS(X) \
+    X(settings) X(world_size) X(screen_scale) X(screen_offset) \
+    X(bricks) X(bricks_cols) X(bricks_rows) X(brick_size) X(bricks_origin) X(destroyed_bricks_count) \
+    X(brick_scripts.clock) X(brick_scripts.frames) X(brick_scripts.queue) \
+    X(bonuses) X(particles) \
+    X(carriage_world) X(carriage_height) X(carriage_speed) \
+    X(ball_pos) X(ball_vel) X(ball_radius) X(ball_speed_target) X(ball_speed_cur) X(ball_min_speed) X(ball_max_speed) \
+    X(freeze_timer) X(state) X(score) X(lives) X(combo_timer) X(combo_window) X(combo_mult) \
+    X(pierce_mode) X(pierce_timer) X(pierce_duration) \
+    X(slowmo_mode) X(slowmo_timer) X(slowmo_duration) X(slowmo_factor) \
+    X(trail_mode) X(ball_trail) \
+    X(cheat_enlarge_paddle) X(cheat_extra_life) X(cheat_speed_lock) \
+    X(magnet_active) X(magnet_timer) X(magnet_duration) X(magnet_strength) \
+    X(score_mult_active) X(score_mult_timer) X(score_mult_duration) X(score_mult_value) \
+    X(cheat_invincible) X(cheat_freeze_ball) X(ball_launched) X(paused) X(rng) \
+    X(bricks_to_speedup) X(speedup_factor) \
+    X(balance) X(total_money) X(money_from_score_accumulator) X(score_per_dollar) \
+    X(shop_message) X(shop_message_timer) X(shop_message_duration)
+
+static const char state_magic[4] = { 'A', 'R', 'K', 'S' };
+
+// Layout fingerprint: snapshots only load into the build that wrote them
+static uint32_t state_layout_tag() {
+    uint32_t sizes[6] = { (uint32_t)sizeof(ArkanoidSettings), (uint32_t)sizeof(Rect), (uint32_t)sizeof(ImU32), (uint32_t)sizeof(std::mt19937),
+        (uint32_t)sizeof(BrickScriptFrame), brick_script_abi };
+    return fnv1a32(2166136261u, sizes, sizeof(sizes));
+}
+
+struct StateWriter
+{
+    std::vector<uint8_t>& out;
+
+    void bytes(const void* p, size_t n) { out.insert(out.end(), (const uint8_t*)p, (const uint8_t*)p + n); }
+    template <typename T> void field(const T& v) { bytes(&v, sizeof(T)); }
+    template <typename T, typename A> void field(const std::vector<T, A>& v) {
+        field((uint32_t)v.size());
+        bytes(v.data(), v.size() * sizeof(T));
+    }
+    void field(const std::string& v) {
+        field((uint32_t)v.size());
+        bytes(v.data(), v.size());
+    }
+    void field(const std::mt19937& v) {
+        std::ostringstream ss;
+        ss << v;
+        field(ss.str());
+    }
+};
+
+struct StateReader
+{
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    bool bytes(void* dst, size_t n) {
+        if (!ok || (size_t)(end - p) < n) return ok = false;
+        memcpy(dst, p, n);
+        p += n;
+        return true;
+    }
+    template <typename T> void field(T& v) { bytes((void*)&v, sizeof(T)); }
+    template <typename T, typename A> void field(std::vector<T, A>& v) {
+        uint32_t n = 0;
+        if (!bytes(&n, sizeof(n)) || (size_t)(end - p) / sizeof(T) < n) { ok = false; return; }
+        v.resize(n);
+        bytes((void*)v.data(), n * sizeof(T));
+    }
+    void field(std::string& v) {
+        uint32_t n = 0;
+        if (!bytes(&n, sizeof(n)) || (size_t)(end - p) < n) { ok = false; return; }
+        v.assign((const char*)p, n);
+        p += n;
+    }
+    void field(std::mt19937& v) {
+        std::string text;
+        field(text);
+        std::istringstream ss(text);
+        if (ok && !(ss >> v)) ok = false;
+    }
+};
+
+void ArkanoidImpl::save_state(std::vector<uint8_t>& out) const {
+    out.clear();
+    StateWriter w{ out };
+    w.bytes(state_magic, 4);
+    w.field(state_layout_tag());
+#define ARKANOID_WRITE_FIELD(name) w.field(name);
+    ARKANOID_STATE_FIELDS(ARKANOID_WRITE_FIELD)
+#undef ARKANOID_WRITE_FIELD
+}
+
+bool ArkanoidImpl::load_state(const uint8_t* data, size_t size) {
+    StateReader r{ data, data + size };
+    char magic[4];
+    uint32_t tag = 0;
+    if (!r.bytes(magic, 4) || memcmp(magic, state_magic, 4) != 0 || !r.bytes(&tag, sizeof(tag)) || tag != state_layout_tag())
+        return false;
+
+    // Fields are read in place; a truncated snapshot restores the previous state
+    std::vector<uint8_t> backup;
+    save_state(backup);
+    release_level_storage();
+#define ARKANOID_READ_FIELD(name) r.field(name);
+    ARKANOID_STATE_FIELDS(ARKANOID_READ_FIELD)
+#undef ARKANOID_READ_FIELD
+    if (!r.ok || r.p != r.end) {
+        load_state(backup.data(), backup.size());
+        return false;
+    }
+    rebuild_brick_grid();
+    brick_scripts.rebuild_index((int)bricks.size());
+    return true;
+}
+
+
+
 // ----------------- Reset / Build Level -----------------
 
 // Reset game state and prepare new level
 void ArkanoidImpl::reset(const ArkanoidSettings& s) {
     settings = s;
     world_size = Vect(s.world_size.x, s.world_size.y);
+    light_map.resize(world_size, 64, 48);   // fixed cell count, whatever the world size
 
     // Setup ball
     ball_radius = s.ball_radius;
@@ -107,6 +427,7 @@ void ArkanoidImpl::reset(const ArkanoidSettings& s) {
     score = 0;
     balance = 0;
     lives = 3;
+    end_combo_chain();
     combo_timer = 0.0f;
     combo_mult = 1;
     pierce_mode = false;
@@ -117,6 +438,7 @@ void ArkanoidImpl::reset(const ArkanoidSettings& s) {
     ball_trail.clear();
     bonuses.clear();
     particles.clear();
+    debris.clear();
 
     // Reset cheats
     cheat_enlarge_paddle = false;
@@ -134,16 +456,74 @@ void ArkanoidImpl::reset(const ArkanoidSettings& s) {
 
     destroyed_bricks_count = 0;
     paused = false;
+    freeze_timer = 0.0f;
 
-    build_level(s);
+    // Restarting the same level is a bulk copy of its pristine image; anything else is built
+    if (!restore_pristine_level(s)) {
+        rng.seed(s.seed);
+        build_level(s);
+        capture_pristine_level(s);
+    }
+    ARK_PROBE3(level_reset, s.seed, s.level_generator, bricks.size());
+    if (event_sink()) {
+        GameEvent e;
+        e.type = (uint8_t)GameEventType::LevelReset;
+        e.value = (int32_t)bricks.size();
+        log_event(e);
+    }
 }
 
-// Build bricks layout according to settings
+// Generate the bricks layout according to settings
 void ArkanoidImpl::build_level(const ArkanoidSettings& s) {
-    bricks.clear();
+    LevelGenParams p;
+    p.cols = (int)clampf((float)s.bricks_columns_count, ArkanoidSettings::bricks_columns_min, ArkanoidSettings::bricks_columns_max);
+    p.rows = (int)clampf((float)s.bricks_rows_count, ArkanoidSettings::bricks_rows_min, ArkanoidSettings::bricks_rows_max);
+    p.seed = s.seed;
+    p.density = s.level_density;
+    p.difficulty = s.level_difficulty;
+
+    generate_level_cached(level_cache(), s.level_generator, p, level_scratch);
+    load_level(level_scratch, s);
+}
+
+void ArkanoidImpl::capture_pristine_level(const ArkanoidSettings& s) {
+    pristine.valid = true;
+    pristine.settings = s;
+    pristine.bricks.assign(bricks.begin(), bricks.end());
+    pristine.cols = bricks_cols;
+    pristine.rows = bricks_rows;
+    pristine.brick_size = brick_size;
+    pristine.bricks_origin = bricks_origin;
+    pristine.rng = rng;
+}
 
-    bricks_cols = (int)clampf((float)s.bricks_columns_count, ArkanoidSettings::bricks_columns_min, ArkanoidSettings::bricks_columns_max);
-    bricks_rows = (int)clampf((float)s.bricks_rows_count, ArkanoidSettings::bricks_rows_min, ArkanoidSettings::bricks_rows_max);
+bool ArkanoidImpl::restore_pristine_level(const ArkanoidSettings& s) {
+    if (!pristine.valid || memcmp(&pristine.settings, &s, sizeof(ArkanoidSettings)) != 0) return false;
+
+    release_level_storage();
+    bricks.assign(pristine.bricks.begin(), pristine.bricks.end());
+    bricks_cols = pristine.cols;
+    bricks_rows = pristine.rows;
+    brick_size = pristine.brick_size;
+    bricks_origin = pristine.bricks_origin;
+    rng = pristine.rng;
+    rebuild_brick_grid();
+    start_brick_scripts();
+    return true;
+}
+
+// Lay out level cells in the world and create the bricks (empty cells become dead bricks)
+void ArkanoidImpl::load_level(const LevelData& level, const ArkanoidSettings& s) {
+    release_level_storage();
+    brick_geometry_dirty = true;
+
+    // A different layout: the pristine image (reset() captures it again) and the editor's
+    // commands no longer apply
+    pristine.valid = false;
+    editor.clear_history();
+
+    bricks_cols = level.cols;
+    bricks_rows = level.rows;
 
     float pad_x = clampf(s.bricks_columns_padding, ArkanoidSettings::bricks_columns_padding_min, ArkanoidSettings::bricks_columns_padding_max);
     float pad_y = clampf(s.bricks_rows_padding, ArkanoidSettings::bricks_rows_padding_min, ArkanoidSettings::bricks_rows_padding_max);
@@ -161,35 +541,181 @@ void ArkanoidImpl::build_level(const ArkanoidSettings& s) {
     brick_size = Vect(bw, bh);
     bricks_origin = Vect(side_margin, top_margin);
 
-    // Random generators
-    std::mt19937 rng(1337);
-    std::uniform_real_distribution<float> unif(0.0f, 1.0f);
-    std::uniform_int_distribution<int> hpDist(0, 99);
-
-    // Populate bricks
+    // Populate bricks (sized up front: arena memory is not reused until the next level)
     bricks.reserve((size_t)(bricks_cols * bricks_rows));
     for (int r = 0; r < bricks_rows; ++r) {
         for (int c = 0; c < bricks_cols; ++c) {
+            const LevelCell& cell = level.at(r, c);
             float x = bricks_origin.x + c * (bw + pad_x);
             float y = bricks_origin.y + r * (bh + pad_y);
             Brick b;
             b.rect_world = make_rect_xywh(x, y, bw, bh);
-            b.alive = true;
+            b.alive = cell.hit_points > 0;
+            b.script = cell.script;
             b.score = 10 + (int)(bricks_rows - 1 - r) * 2;
-
-            float p = unif(rng);
-            b.bonus = (p < 0.15f);
-            b.base_color = b.bonus ? IM_COL32(255, 200, 80, 255) : IM_COL32(140 + (int)(90.0f * r / std::max(1, bricks_rows - 1)), 180, 230, 255);
-
-            int rnd = hpDist(rng);
-            if (rnd < 5) b.hit_points = 3;
-            else if (rnd < 25) b.hit_points = 2;
-            else b.hit_points = 1;
-
+            b.bonus = cell.bonus != 0;
+            b.base_color = cell.color;
+            b.hit_points = std::max(1, (int)cell.hit_points);
             b.color = b.base_color;
             bricks.push_back(b);
         }
     }
+    rebuild_brick_grid();
+    start_brick_scripts();
+}
+
+
+
+// ----------------- Level Editing -----------------
+
+void ArkanoidImpl::rebuild_brick_grid() {
+    // Pitch is taken from the laid-out bricks, so restored states need no settings
+    Vect pitch = brick_size;
+    if (bricks_cols > 1) pitch.x = bricks[1].rect_world.pos.x - bricks[0].rect_world.pos.x;
+    if (bricks_rows > 1) pitch.y = bricks[bricks_cols].rect_world.pos.y - bricks[0].rect_world.pos.y;
+    brick_grid.reset(bricks_cols, bricks_rows, bricks_origin, pitch);
+    for (int i = 0; i < (int)bricks.size(); ++i)
+        if (bricks[i].alive) brick_grid.set_alive(i, true);
+    brick_geometry_dirty = true;
+    dirty_bricks.clear();
+    dirty_bricks.reserve(bricks.size());   // mark_brick_dirty() never holds more
+}
+
+// Tear down everything held in the level arena in one go
+void ArkanoidImpl::release_level_storage() {
+    bricks = std::pmr::vector<Brick>(&level_arena);
+    dirty_bricks = std::pmr::vector<int>(&level_arena);
+    brick_grid.release();
+    brick_scripts.release();
+    level_arena.release();
+    debris.clear();   // sleeping pieces point into the old grid
+}
+
+void ArkanoidImpl::set_brick_alive(int index, bool alive) {
+    Brick& b = bricks[index];
+    if (b.alive == alive) return;
+    b.alive = alive;
+    brick_grid.set_alive(index, alive);
+    mark_brick_dirty(index);
+}
+
+LevelCell ArkanoidImpl::brick_cell(int index) const {
+    const Brick& b = bricks[index];
+    LevelCell c;
+    c.hit_points = (uint8_t)(b.alive ? b.hit_points : 0);
+    c.bonus = b.bonus ? 1 : 0;
+    c.script = b.script;
+    c.color = b.base_color;
+    return c;
+}
+
+void ArkanoidImpl::set_brick_cell(int index, const LevelCell& cell) {
+    Brick& b = bricks[index];
+    b.hit_points = std::max(1, (int)cell.hit_points);
+    b.bonus = cell.bonus != 0;
+    b.base_color = cell.color;
+    b.color = cell.color;
+    b.hidden = false;
+    b.script = cell.script;
+    mark_brick_dirty(index);
+    set_brick_alive(index, cell.hit_points > 0);
+    brick_scripts.start(index, b.alive ? (BrickScriptType)b.script : BrickScriptType::None);
+
+    // Edits are part of the level: restarting it brings them back, so the editor's history stays valid
+    if (pristine.valid) pristine.bricks[index] = b;
+
+    // Painting into a cleared level makes it playable again
+    if (brick_grid.alive > 0 && state == GameState::Win) state = GameState::Playing;
+}
+
+void ArkanoidImpl::level_snapshot(LevelData& out) const {
+    out.cols = bricks_cols;
+    out.rows = bricks_rows;
+    out.seed = settings.seed;
+    out.generator = (uint32_t)settings.level_generator;
+    out.cells.resize(bricks.size());
+    for (int i = 0; i < (int)bricks.size(); ++i) out.cells[i] = brick_cell(i);
+}
+
+
+
+// ----------------- Brick Scripts -----------------
+
+// The level as brick_script.h sees it; every change goes through the same paths as play and
+// editing, so the broadphase counts and the geometry batches stay in sync
+class ArkanoidImpl::ScriptWorld : public BrickScriptWorld
+{
+public:
+    explicit ScriptWorld(ArkanoidImpl& game) : g(game) {}
+
+    int columns() const override { return g.bricks_cols; }
+    int rows() const override { return g.bricks_rows; }
+
+    int hit_points(int brick) const override {
+        const Brick& b = g.bricks[brick];
+        return b.alive ? b.hit_points : 0;
+    }
+
+    void set_hit_points(int brick, int hp, bool full) override {
+        Brick& b = g.bricks[brick];
+        b.hit_points = std::max(1, std::min(3, hp));
+        b.color = full ? b.base_color : damaged_brick_color(b.base_color, b.hit_points);
+        g.mark_brick_dirty(brick);
+    }
+
+    void set_hidden(int brick, bool hidden) override {
+        Brick& b = g.bricks[brick];
+        if (b.hidden == hidden) return;
+        b.hidden = hidden;
+        g.mark_brick_dirty(brick);
+    }
+
+    bool spawn(int from, int to) override {
+        Brick& b = g.bricks[to];
+        if (b.alive) return false;
+        const Brick& src = g.bricks[from];
+        b.hit_points = 1;
+        b.bonus = false;
+        b.hidden = false;
+        b.script = 0;
+        b.base_color = src.base_color;
+        b.color = src.base_color;
+        g.set_brick_alive(to, true);
+        g.spawn_particles(rect_center(b.rect_world), b.color, 6);
+        return true;
+    }
+
+    bool move(int from, int to) override {
+        if (g.bricks[to].alive || !g.bricks[from].alive) return false;
+        // The brick keeps its state; the cells keep their place and row score
+        Brick& dst = g.bricks[to];
+        Rect rect = dst.rect_world;
+        int row_score = dst.score;
+        dst = g.bricks[from];
+        dst.rect_world = rect;
+        dst.score = row_score;
+        dst.alive = false;
+        g.bricks[from].script = 0;
+        g.bricks[from].hidden = false;
+        g.set_brick_alive(from, false);
+        g.set_brick_alive(to, true);
+        return true;
+    }
+
+private:
+    ArkanoidImpl& g;
+};
+
+void ArkanoidImpl::start_brick_scripts() {
+    brick_scripts.reset((int)bricks.size());
+    for (int i = 0; i < (int)bricks.size(); ++i)
+        if (bricks[i].alive && bricks[i].script) brick_scripts.start(i, (BrickScriptType)bricks[i].script);
+}
+
+void ArkanoidImpl::step_brick_scripts(float dt) {
+    if (brick_scripts.empty()) return;
+    ScriptWorld world(*this);
+    brick_scripts.step(dt, world);
 }
 
 
@@ -198,6 +724,15 @@ void ArkanoidImpl::build_level(const ArkanoidSettings& s) {
 
 // Update game state each frame
 void ArkanoidImpl::update(ImGuiIO& io, ArkanoidDebugData& debug_data, float elapsed) {
+    PerfTimer timer;
+    perf.frame_ms = elapsed * 1000.0f;
+    ARK_PROBE2(frame_begin, perf.frames, elapsed * 1e6f);
+    if (GameEventLog* log = event_sink()) log->next_frame();
+    update_game(io, debug_data, elapsed);
+    perf.update_ms = timer.lap_ms();
+}
+
+void ArkanoidImpl::update_game(ImGuiIO& io, ArkanoidDebugData& debug_data, float elapsed) {
     // Compute scaling for screen rendering
     screen_scale = world_to_screen_scale(io);
     debug_data.hits.clear();
@@ -220,25 +755,41 @@ void ArkanoidImpl::update(ImGuiIO& io, ArkanoidDebugData& debug_data, float elap
     }
 
     grant_money_from_score();
+
+    PerfTimer phase;
     handle_cheats_and_controls(io, dt);
+    perf.set_phase(PerfPhase::Controls, phase.lap_ms());
 
     if (paused) return;
 
     launch_ball_if_needed();
     integrate_ball(dt);
+    perf.set_phase(PerfPhase::Ball, phase.lap_ms());
     integrate_bonuses(dt);
+    perf.set_phase(PerfPhase::Bonuses, phase.lap_ms());
     integrate_particles(dt);
+    perf.set_phase(PerfPhase::Particles, phase.lap_ms());
+    step_brick_scripts(dt);
+    perf.set_phase(PerfPhase::Scripts, phase.lap_ms());
     handle_collisions(debug_data);
+    perf.set_phase(PerfPhase::Collisions, phase.lap_ms());
 
     // Win condition check
-    bool any_alive = false;
-    for (const auto& b : bricks) if (b.alive) { any_alive = true; break; }
-    if (!any_alive) state = GameState::Win;
+    if (brick_grid.alive == 0) state = GameState::Win;
 }
 
 // Draw the full frame
 void ArkanoidImpl::draw(ImGuiIO& io, ImDrawList& draw_list) {
-    draw_world(draw_list);
+    PerfTimer timer;
+    if (world_layer.active()) {
+        world_layer.governor.add_frame(perf.frame_ms);
+        ImDrawList& layer = world_layer.begin(io.DisplaySize, io.DisplayFramebufferScale, io.Fonts->TexID);
+        Vect k = world_layer.scale_from_display();
+        draw_world(layer, Vect(screen_scale.x * k.x, screen_scale.y * k.y), Vect(screen_offset.x * k.x, screen_offset.y * k.y));
+        world_layer.composite(draw_list);
+    }
+    else draw_world(draw_list, screen_scale, screen_offset);
+    draw_world_labels(draw_list);
     draw_ui(io, draw_list);
 
     // Show end-game modal if needed
@@ -248,11 +799,43 @@ void ArkanoidImpl::draw(ImGuiIO& io, ImDrawList& draw_list) {
         draw_centered_modal(io, draw_list, "YOU LOSE", "Try again!\nPress R to restart", IM_COL32(240, 120, 120, 255));
 
     draw_main_debug_menu(io);
+    editor.draw(*this, io, draw_list);
+
+    // Feed the quality governor with this frame's cost (overlay itself excluded)
+    perf.draw_ms = timer.lap_ms();
+    ARK_PROBE3(frame_end, perf.frames, perf.update_ms * 1e6f, perf.draw_ms * 1e6f);
+    perf.end_frame();
+    quality.add_frame(perf.update_ms + perf.draw_ms);
+    if (GameMetrics* m = metrics_sink()) publish_metrics(*m);
+
+    if (show_perf_overlay) draw_perf_overlay(io);
 }
 
 
 
 
+// Report this frame to the metrics endpoint
+void ArkanoidImpl::publish_metrics(GameMetrics& m) const {
+    MetricsFrame f;
+    f.frame_ms = perf.frame_ms;
+    f.update_ms = perf.update_ms;
+    f.draw_ms = perf.draw_ms;
+    for (int i = 0; i < (int)PerfPhase::Count; ++i) f.phase_ms[i] = perf.phase_ms[i];
+    f.bricks_alive = brick_grid.alive;
+    f.bricks_total = (int)bricks.size();
+    f.bonuses = (int)bonuses.size();
+    f.particles = (int)particles.size() + debris.size();
+    f.score = score;
+    f.lives = lives;
+    f.balance = balance;
+    f.total_money = total_money;
+    f.quality_level = quality.level();
+    f.won = state == GameState::Win;
+    m.record_frame(f);
+}
+
+
+
 // ----------------- Controls / Cheats -----------------
 void ArkanoidImpl::handle_cheats_and_controls(ImGuiIO& io, float dt) {
     // Paddle movement
@@ -285,9 +868,12 @@ void ArkanoidImpl::handle_cheats_and_controls(ImGuiIO& io, float dt) {
         for (auto& b : bricks) {
             if (!b.alive) continue;
             if (ball_pos.y >= b.rect_world.pos.y && ball_pos.y <= b.rect_world.pos.y + b.rect_world.size.y) {
-                b.alive = false;
+                set_brick_alive((int)(&b - bricks.data()), false);
+                brick_scripts.stop((int)(&b - bricks.data()));
                 score += b.score * score_mult_value;
+                log_brick_event(GameEventType::BrickDestroy, (int)(&b - bricks.data()), b.score * score_mult_value);
                 destroyed_bricks_count++;
+                ARK_PROBE3(brick_destroy, &b - bricks.data(), score, destroyed_bricks_count);
                 if (destroyed_bricks_count % bricks_to_speedup == 0)
                     ball_speed_target = clampf(ball_speed_target * speedup_factor, ball_min_speed, ball_max_speed);
             }
@@ -311,10 +897,14 @@ void ArkanoidImpl::handle_cheats_and_controls(ImGuiIO& io, float dt) {
     if (pierce_mode) { pierce_timer -= dt; if (pierce_timer <= 0) { pierce_mode = false; pierce_timer = 0; } }
 
     // Combo
-    if (combo_timer > 0) { combo_timer -= dt; if (combo_timer <= 0) { combo_mult = 1; combo_timer = 0; } }
+    if (combo_timer > 0) { combo_timer -= dt; if (combo_timer <= 0) { combo_mult = 1; combo_timer = 0; end_combo_chain(); } }
 
     // Ball trail
-    if (trail_mode) { ball_trail.push_back(ball_pos); if (ball_trail.size() > 16) ball_trail.erase(ball_trail.begin()); }
+    if (trail_mode) {
+        ball_trail.push_back(ball_pos);
+        size_t max_len = (size_t)quality.current().trail_length;
+        if (ball_trail.size() > max_len) ball_trail.erase(ball_trail.begin(), ball_trail.end() - max_len);
+    }
     else if (!ball_trail.empty()) ball_trail.clear();
 
     // Shop message timer
@@ -333,8 +923,6 @@ void ArkanoidImpl::clamp_carriage() {
 void ArkanoidImpl::launch_ball_if_needed() { /* Placeholder for sticky launch */ }
 
 void ArkanoidImpl::integrate_ball(float dt) {
-    static float freeze_timer = 0.0f;
-
     if (cheat_freeze_ball) { if (freeze_timer <= 0.0f) freeze_timer = 5.0f; cheat_freeze_ball = false; }
     if (freeze_timer > 0.0f) { freeze_timer -= dt; ball_speed_cur = std::max(ball_min_speed, ball_speed_target * 0.2f); }
     else ball_speed_cur = ball_speed_target;
@@ -353,7 +941,18 @@ void ArkanoidImpl::integrate_ball(float dt) {
 
     // Bottom: lose life unless invincible
     if (ball_pos.y > world_size.y + ball_radius) {
-        if (!cheat_invincible) lives--;
+        if (!cheat_invincible) {
+            lives--;
+            ARK_PROBE2(life_lost, lives, score);
+            if (event_sink()) {
+                GameEvent e;
+                e.type = (uint8_t)GameEventType::LifeLost;
+                e.score = score;
+                e.value = lives;
+                log_event(e);
+            }
+        }
+        end_combo_chain();
         combo_mult = 1; combo_timer = 0; pierce_mode = false; pierce_timer = 0;
 
         if (lives <= 0) state = GameState::Lose;
@@ -422,7 +1021,7 @@ void ArkanoidImpl::reflect_ball(const Vect& normal)
     // Prevent too-flat trajectories by enforcing minimum velocity components
     float min_comp = 0.15f * ball_speed_cur;
     if (std::abs(reflected.x) < min_comp)
-        reflected.x = sgn(reflected.x == 0 ? ((rand() % 2) * 2 - 1) : reflected.x) * min_comp;
+        reflected.x = sgn(reflected.x == 0 ? (float)((rng() % 2) * 2 - 1) : reflected.x) * min_comp;
     if (std::abs(reflected.y) < min_comp)
         reflected.y = sgn(reflected.y == 0 ? -1.f : reflected.y) * min_comp;
 
@@ -465,8 +1064,18 @@ void ArkanoidImpl::handle_collisions(ArkanoidDebugData& debug_data)
     }
 
     // ----- Brick collisions -----
-    for (auto& b : bricks) {
-        if (!b.alive) continue;  // Skip destroyed bricks
+    // Only the cells under the ball's bounds are visited, in index order like a full scan
+    int c0, c1, r0, r1;
+    Vect reach(ball_radius, ball_radius);
+    if (!brick_grid.query(ball_pos - reach, ball_pos + reach, c0, c1, r0, r1)) return;
+
+    int span = c1 - c0 + 1;
+    for (int k = 0, cells = span * (r1 - r0 + 1); k < cells; ++k) {
+        int row = r0 + k / span;
+        if (brick_grid.row_alive[row] == 0) continue;  // Skip empty rows
+        int index = row * bricks_cols + c0 + k % span;
+        Brick& b = bricks[index];
+        if (!b.alive || b.hidden) continue;  // Skip destroyed and phased-out bricks
 
         Vect n, hit_pos;
         float t;
@@ -474,29 +1083,17 @@ void ArkanoidImpl::handle_collisions(ArkanoidDebugData& debug_data)
         // Check collision with current brick
         if (collide_ball_with_rect(b.rect_world, n, hit_pos, t)) {
             if (!pierce_mode) reflect_ball(n); // Reflect ball if not piercing
+            mark_brick_dirty(index);
 
             if (b.hit_points > 1) {
                 // ----- Partial damage brick -----
                 b.hit_points -= 1;
-                score += (b.score / 3) * score_mult_value;
+                int gained = (b.score / 3) * score_mult_value;
+                score += gained;
 
                 // Modify brick color to indicate damage visually
-                int r = (b.base_color >> IM_COL32_R_SHIFT) & 255;
-                int g = (b.base_color >> IM_COL32_G_SHIFT) & 255;
-                int bl = (b.base_color >> IM_COL32_B_SHIFT) & 255;
-
-                if (b.hit_points == 2) {
-                    r = std::min(255, r + 30);
-                    g = std::max(60, g - 20);
-                    bl = std::max(30, bl - 60);
-                }
-                else if (b.hit_points == 1) {
-                    r = std::min(255, r + 60);
-                    g = std::max(40, g - 40);
-                    bl = std::max(20, bl - 100);
-                }
-
-                b.color = IM_COL32(r, g, bl, 255);
+                b.color = damaged_brick_color(b.base_color, b.hit_points);
+                brick_scripts.signal(index);
 
                 // Spawn small particles at collision for visual effect
                 spawn_particles(rect_center(b.rect_world), b.color, 6);
@@ -504,6 +1101,8 @@ void ArkanoidImpl::handle_collisions(ArkanoidDebugData& debug_data)
                 // Update combo counter
                 combo_mult = std::min(9, combo_mult + 1);
                 combo_timer = combo_window;
+                combo_chain++;
+                log_brick_event(GameEventType::BrickHit, index, gained);
 
                 add_debug_hit(debug_data, hit_pos, n);
 
@@ -511,12 +1110,16 @@ void ArkanoidImpl::handle_collisions(ArkanoidDebugData& debug_data)
             }
             else {
                 // ----- Destroy brick -----
-                b.alive = false;
-                score += b.score * combo_mult * score_mult_value;
+                set_brick_alive(index, false);
+                brick_scripts.stop(index);
+                int gained = b.score * combo_mult * score_mult_value;
+                score += gained;
 
                 // Update combo
                 combo_mult = std::min(9, combo_mult + 1);
                 combo_timer = combo_window;
+                combo_chain++;
+                log_brick_event(GameEventType::BrickDestroy, index, gained);
 
                 // Spawn larger particle effect
                 spawn_particles(rect_center(b.rect_world), b.color, 14);
@@ -524,8 +1127,8 @@ void ArkanoidImpl::handle_collisions(ArkanoidDebugData& debug_data)
                 // Spawn bonus if brick has one
                 if (b.bonus) {
                     Vect center = rect_center(b.rect_world);
-                    std::mt19937 rng((uint32_t)(center.x * 1000 + center.y));
-                    int choice = std::uniform_int_distribution<int>(0, 6)(rng);
+                    std::mt19937 bonus_rng((uint32_t)(center.x * 1000 + center.y));
+                    int choice = std::uniform_int_distribution<int>(0, 6)(bonus_rng);
                     switch (choice) {
                     case 0: spawn_bonus_at(center, BonusType::SpeedUp); break;
                     case 1: spawn_bonus_at(center, BonusType::EnlargePaddle); break;
@@ -542,6 +1145,7 @@ void ArkanoidImpl::handle_collisions(ArkanoidDebugData& debug_data)
 
                 // Increment destroyed bricks counter
                 destroyed_bricks_count++;
+                ARK_PROBE3(brick_destroy, &b - bricks.data(), score, destroyed_bricks_count);
 
                 // Speed up ball every N destroyed bricks
                 if (destroyed_bricks_count % bricks_to_speedup == 0)
@@ -558,7 +1162,7 @@ void ArkanoidImpl::add_debug_hit(ArkanoidDebugData& debug_data, const Vect& worl
 {
     ArkanoidDebugData::Hit h;
     // Convert world coordinates to screen coordinates for debug rendering
-    h.screen_pos = Vect(world_pos.x * screen_scale.x, world_pos.y * screen_scale.y);
+    h.screen_pos = world_to_screen(world_pos);
     h.normal = normal;
     debug_data.hits.push_back(std::move(h));
 }
@@ -593,6 +1197,14 @@ void ArkanoidImpl::spawn_bonus_at(const Vect& world_pos, BonusType type)
     default: b.color = IM_COL32(255, 255, 255, 255); break;
     }
 
+    ARK_PROBE3(bonus_spawn, (int)type, world_pos.x, world_pos.y);
+    if (event_sink()) {
+        GameEvent e;
+        e.type = (uint8_t)GameEventType::BonusSpawn;
+        e.bonus = (uint8_t)type;
+        e.score = score;
+        log_event(e);
+    }
     bonuses.push_back(std::move(b));
 }
 
@@ -637,6 +1249,8 @@ void ArkanoidImpl::integrate_bonuses(float dt)
 
 void ArkanoidImpl::apply_bonus(Bonus& b)
 {
+    ARK_PROBE2(bonus_apply, (int)b.type, score);
+
     // Apply bonus effect
     switch (b.type) {
     case BonusType::SpeedUp: ball_speed_target = std::min(ball_speed_target * 1.15f + 10.0f, ball_max_speed); break;
@@ -652,9 +1266,18 @@ void ArkanoidImpl::apply_bonus(Bonus& b)
     case BonusType::SlowMo: slowmo_mode = true; slowmo_timer = 5.0f; ball_speed_target *= 0.4f; break;
     case BonusType::Points: score += b.points * score_mult_value; break;
     case BonusType::Magnet: magnet_active = true; magnet_timer = magnet_duration; break;
-    case BonusType::ScoreMult: score_mult_active = true; score_mult_timer = score_mult_duration; score_mult_value = (rand() % 2) ? 2 : 3; break;
+    case BonusType::ScoreMult: score_mult_active = true; score_mult_timer = score_mult_duration; score_mult_value = (rng() % 2) ? 2 : 3; break;
     default: break;
     }
+
+    if (event_sink()) {
+        GameEvent e;
+        e.type = (uint8_t)GameEventType::BonusPickup;
+        e.bonus = (uint8_t)b.type;
+        e.score = score;
+        e.value = b.type == BonusType::Points ? b.points * score_mult_value : 0;
+        log_event(e);
+    }
 }
 
 
@@ -665,8 +1288,14 @@ void ArkanoidImpl::apply_bonus(Bonus& b)
 // Spawn visual particles at a given world position
 void ArkanoidImpl::spawn_particles(const Vect& world_pos, ImU32 color, int count)
 {
+    // Visual budget from the quality governor
+    const QualityLevel& q = quality.current();
+    count = std::min(count, q.particles_per_spawn);
+    if (!debris_mode) count = std::min(count, q.particles_max - (int)particles.size());
+    if (count <= 0) return;
+
     // Seed random generator based on position to get reproducible particle patterns
-    std::mt19937 rng((uint32_t)(world_pos.x * 1000 + world_pos.y));
+    std::mt19937 particle_rng((uint32_t)(world_pos.x * 1000 + world_pos.y));
 
     // Random distributions for particle angle, speed, and size
     std::uniform_real_distribution<float> ang(-3.14159f, 3.14159f); // Full circle in radians
@@ -677,25 +1306,26 @@ void ArkanoidImpl::spawn_particles(const Vect& world_pos, ImU32 color, int count
         Particle p;
 
         // Randomize movement direction
-        float a = ang(rng);
+        float a = ang(particle_rng);
 
         // Set initial position to the world position passed in
         p.pos = world_pos;
 
         // Velocity in the direction 'a' scaled by random speed
-        p.vel = Vect(std::cos(a), std::sin(a)) * spd(rng);
+        p.vel = Vect(std::cos(a), std::sin(a)) * spd(particle_rng);
 
         // Particle lifetime: random small variation around 0.6 seconds
-        p.life = 0.6f + (rng() % 100) * 0.002f;
+        p.life = 0.6f + (particle_rng() % 100) * 0.002f;
 
         // Random size for visual variation
-        p.size = sz(rng);
+        p.size = sz(particle_rng);
 
         // Set color as passed in (usually same as brick hit)
         p.color = color;
 
-        // Add particle to global particle list for rendering/updating
-        particles.push_back(std::move(p));
+        // Add particle to global particle list for rendering/updating; debris lives longer
+        if (debris_mode) debris.spawn(p.pos, p.vel, p.life * 4.0f, p.size, p.color);
+        else particles.push_back(std::move(p));
     }
 }
 
@@ -710,13 +1340,21 @@ void ArkanoidImpl::integrate_particles(float dt)
     }
 
     particles.erase(std::remove_if(particles.begin(), particles.end(), [](const Particle& p) { return p.life <= 0.0f; }), particles.end());
+
+    if (debris.size() > 0) {
+        DebrisWorld w;
+        w.size = world_size;
+        w.paddle = carriage_world;
+        w.grid = &brick_grid;
+        w.brick_size = brick_size;
+        debris.update(dt, w);
+    }
 }
 
 void ArkanoidImpl::draw_particles(ImDrawList& dl)
 {
+    int segments = std::max(4, quality.current().circle_segments / 4);
     for (const auto& p : particles) {
-        ImVec2 pos(p.pos.x * screen_scale.x, p.pos.y * screen_scale.y);
-        float s = p.size * screen_scale.x;
         float alpha = clampf(p.life / 0.8f, 0.0f, 1.0f);
         ImU32 col = ImColor(
             (int)((p.color >> IM_COL32_R_SHIFT) & 255),
@@ -724,7 +1362,50 @@ void ArkanoidImpl::draw_particles(ImDrawList& dl)
             (int)((p.color >> IM_COL32_B_SHIFT) & 255),
             (int)(255.0f * alpha)
         );
-        dl.AddCircleFilled(pos, s, col, 8);
+        add_world_circle(dl, p.pos, p.size, col, segments);
+    }
+    debris.draw(dl);
+}
+
+// Brick corner radii and outline width in world units: 8, 6 and 1 px at the default 1280x720
+// window. They scale with the window like the bricks themselves, so the cache survives a resize.
+static const float brick_rounding_strong = 5.0f;   // 3+ hit points
+static const float brick_rounding = 3.75f;
+static const float brick_outline = 0.625f;
+
+// Emitters are the ball (brighter and redder in pierce mode) and the falling bonuses. Each live
+// brick is brightened towards its own colour scaled by the light at its centre; bricks left in
+// the dark add nothing to the draw list.
+void ArkanoidImpl::draw_brick_light(ImDrawList& dl)
+{
+    light_map.clear_emitters();
+    if (pierce_mode) light_map.add({ ball_pos, ball_radius * 16.0f, 1.0f, 0.3f, 0.25f });
+    else light_map.add({ ball_pos, ball_radius * 10.0f, 0.6f, 0.3f, 0.5f });
+    for (const auto& b : bonuses) {
+        if (!b.alive) continue;
+        float pulse = 0.35f + 0.15f * std::sin(b.glow);
+        light_map.add({ rect_center(b.rect_world), 70.0f,
+            pulse * ((b.color >> IM_COL32_R_SHIFT) & 255) / 255.0f,
+            pulse * ((b.color >> IM_COL32_G_SHIFT) & 255) / 255.0f,
+            pulse * ((b.color >> IM_COL32_B_SHIFT) & 255) / 255.0f });
+    }
+    light_map.build();
+
+    for (const auto& b : bricks) {
+        if (!b.alive || b.hidden) continue;
+        float light[3];
+        light_map.sample(rect_center(b.rect_world), light);
+        float peak = std::max(light[0], std::max(light[1], light[2]));
+        if (peak < 0.02f) continue;
+        static const int shift[3] = { IM_COL32_R_SHIFT, IM_COL32_G_SHIFT, IM_COL32_B_SHIFT };
+        int lit[3];
+        for (int k = 0; k < 3; ++k) {
+            int c = (int)((b.color >> shift[k]) & 255);
+            lit[k] = std::min(255, (int)(c * (1.0f + 0.5f * light[k]) + 50.0f * light[k]));
+        }
+        int alpha = (int)(200.0f * clampf(peak, 0.0f, 1.0f));
+        float rounding = (b.hit_points >= 3) ? brick_rounding_strong : brick_rounding;
+        dl.AddRectFilled(b.rect_world.pos, b.rect_world.pos + b.rect_world.size, IM_COL32(lit[0], lit[1], lit[2], alpha), rounding);
     }
 }
 
@@ -733,88 +1414,168 @@ void ArkanoidImpl::draw_particles(ImDrawList& dl)
 
 /* ----------------- Drawing World & UI ----------------- */
 
-void ArkanoidImpl::draw_world(ImDrawList& dl)
+// Circle in world units that stays round on screen despite the non-uniform world scale.
+// thickness > 0 draws an outline of that many screen pixels.
+void ArkanoidImpl::add_world_circle(ImDrawList& dl, const Vect& center, float radius, ImU32 col, int segments, float thickness)
 {
-    // Draw particles under everything
-    draw_particles(dl);
+    if ((col & IM_COL32_A_MASK) == 0 || radius <= 0.0f) return;
+    segments = std::max(3, segments);
+
+    const float a_max = 6.28318531f * ((float)segments - 1.0f) / (float)segments;
+    dl.PathArcTo(center, radius, 0.0f, a_max, segments - 1);
 
-    // Draw bricks
+    const float ky = screen_scale.x / screen_scale.y;
+    for (ImVec2& p : dl._Path) p.y = center.y + (p.y - center.y) * ky;
+
+    if (thickness > 0.0f) dl.PathStroke(col, ImDrawFlags_Closed, thickness / screen_scale.x);
+    else dl.PathFillConvex(col);
+}
+
+// Rounded rect in world units whose corners stay round and rounding_px screen pixels wide at the
+// current scale, the same way. Only for geometry recorded every frame: the brick cache would have
+// to be rebuilt on every resize.
+void ArkanoidImpl::add_world_rect(ImDrawList& dl, const ImVec2& p0, const ImVec2& p1, ImU32 col, float rounding_px, float thickness_px)
+{
+    if ((col & IM_COL32_A_MASK) == 0) return;
+
+    // Build the path with y stretched to the x scale, then squash it back
+    const float ky = screen_scale.x / screen_scale.y;
+    dl.PathRect(p0, ImVec2(p1.x, p0.y + (p1.y - p0.y) / ky), rounding_px / screen_scale.x);
+    for (ImVec2& p : dl._Path) p.y = p0.y + (p.y - p0.y) * ky;
+
+    if (thickness_px > 0.0f) dl.PathStroke(col, ImDrawFlags_Closed, thickness_px / screen_scale.x);
+    else dl.PathFillConvex(col);
+}
+
+// Record brick geometry (world units) into the cache, one batch per brick
+void ArkanoidImpl::rebuild_brick_geometry(const ImDrawList& target)
+{
+    const QualityLevel& q = quality.current();
+    brick_geometry.clear();
+
+    // One batch per brick (empty for dead ones) so batch i always belongs to brick i
     for (const auto& b : bricks) {
-        if (!b.alive) continue;
+        ImDrawList& dl = brick_geometry.begin_batch(target);
+        emit_brick_geometry(b, dl, q.brick_detail);
+        brick_geometry.end_batch();
+    }
+
+    brick_geometry_dirty = false;
+    brick_geometry_detail = q.brick_detail;
+    dirty_bricks.clear();
+}
 
-        ImVec2 p0 = ImVec2(b.rect_world.pos.x * screen_scale.x, b.rect_world.pos.y * screen_scale.y);
-        ImVec2 p1 = ImVec2((b.rect_world.pos.x + b.rect_world.size.x) * screen_scale.x,
-            (b.rect_world.pos.y + b.rect_world.size.y) * screen_scale.y);
-        float rounding = (b.hit_points >= 3) ? 8.0f : 6.0f;
+void ArkanoidImpl::emit_brick_geometry(const Brick& b, ImDrawList& dl, bool detail) const
+{
+    if (!b.alive) return;
+
+    ImVec2 p0 = b.rect_world.pos;
+    ImVec2 p1 = b.rect_world.pos + b.rect_world.size;
+    float rounding = (b.hit_points >= 3) ? brick_rounding_strong : brick_rounding;
+    float outline = brick_outline;
 
-        // Base brick
-        dl.AddRectFilled(p0, p1, b.color, rounding);
-        dl.AddRect(p0, p1, IM_COL32(0, 0, 0, 80), rounding);
+    // Phased out by its script: faint outline only
+    if (b.hidden) {
+        dl.AddRect(p0, p1, (b.color & ~IM_COL32_A_MASK) | (70u << IM_COL32_A_SHIFT), rounding, ImDrawFlags_None, outline);
+        return;
+    }
 
-        // Top highlight
+    // Base brick
+    dl.AddRectFilled(p0, p1, b.color, rounding);
+
+    // Outline and top highlight (dropped at low quality)
+    if (detail) {
+        dl.AddRect(p0, p1, IM_COL32(0, 0, 0, 80), rounding, ImDrawFlags_None, outline);
         ImVec2 t0 = p0;
         ImVec2 t1 = ImVec2(p1.x, p0.y + (p1.y - p0.y) * 0.18f);
         dl.AddRectFilled(t0, t1, IM_COL32(255, 255, 255, 20), rounding);
+    }
+}
 
-        // HP marker
-        if (b.hit_points > 1) {
-            char buf[8];
-            snprintf(buf, sizeof(buf), "x%d", b.hit_points);
-            dl.AddText(ImVec2(p0.x + 6, p0.y + 6), IM_COL32(30, 30, 30, 200), buf);
-        }
+// World layer: everything is emitted in world units into one vertex range of the
+// draw list and moved to screen space by a single transform pass at the end.
+// Text is the only exception and is drawn in screen space afterwards.
+void ArkanoidImpl::draw_world(ImDrawList& dl, const Vect& scale, const Vect& offset)
+{
+    const QualityLevel& q = quality.current();
+    const int world_vtx_begin = dl.VtxBuffer.Size;
+
+    // Draw particles under everything
+    draw_particles(dl);
+
+    // Draw bricks from the cached geometry, re-recording only the bricks that changed
+    if (brick_geometry_dirty || brick_geometry_detail != q.brick_detail) rebuild_brick_geometry(dl);
+    for (int index : dirty_bricks) {
+        ImDrawList& batch = brick_geometry.begin_batch(dl);
+        emit_brick_geometry(bricks[index], batch, q.brick_detail);
+        brick_geometry.end_batch_replace(index);
     }
+    dirty_bricks.clear();
+    brick_geometry.append_to(dl);
+    if (light_mode) draw_brick_light(dl);
 
     // Draw bonuses and paddle
     draw_bonuses(dl);
 
-    ImVec2 p0 = ImVec2(carriage_world.pos.x * screen_scale.x, carriage_world.pos.y * screen_scale.y);
-    ImVec2 p1 = ImVec2((carriage_world.pos.x + carriage_world.size.x) * screen_scale.x,
-        (carriage_world.pos.y + carriage_world.size.y) * screen_scale.y);
-    dl.AddRectFilled(p0, p1, IM_COL32(200, 230, 255, 255), 8.0f);
-    dl.AddRect(p0, p1, IM_COL32(0, 0, 0, 120), 8.0f);
+    ImVec2 p0 = carriage_world.pos;
+    ImVec2 p1 = carriage_world.pos + carriage_world.size;
+    add_world_rect(dl, p0, p1, IM_COL32(200, 230, 255, 255), 8.0f);
+    add_world_rect(dl, p0, p1, IM_COL32(0, 0, 0, 120), 8.0f, 1.0f);
 
     // Paddle highlight
     ImVec2 c0 = ImVec2((p0.x + p1.x) * 0.4f, p0.y);
     ImVec2 c1 = ImVec2((p0.x + p1.x) * 0.6f, p1.y);
-    dl.AddRectFilled(c0, c1, IM_COL32(255, 255, 255, 30), 6.0f);
+    add_world_rect(dl, c0, c1, IM_COL32(255, 255, 255, 30), 6.0f);
 
     // Magnet indicator
     if (magnet_active) {
-        ImVec2 center = ImVec2((p0.x + p1.x) * 0.5f, (p0.y + p1.y) * 0.5f);
-        float radius = (p1.x - p0.x) * 0.9f;
-        dl.AddCircle(center, radius, IM_COL32(160, 255, 200, 90), 48, 2.5f);
+        Vect center = rect_center(carriage_world);
+        float radius = carriage_world.size.x * 0.9f;
+        add_world_circle(dl, center, radius, IM_COL32(160, 255, 200, 90), q.circle_segments * 3 / 2, 2.5f);
     }
 
     // Ball trail
     if (trail_mode && !ball_trail.empty()) {
         float alpha = 40.0f;
         for (int i = 0; i < (int)ball_trail.size(); ++i) {
-            ImVec2 sp = ImVec2(ball_trail[i].x * screen_scale.x, ball_trail[i].y * screen_scale.y);
-            float sr = ball_radius * screen_scale.x * (0.6f * (1.0f - float(i) / ball_trail.size()) + 0.2f);
+            float r = ball_radius * (0.6f * (1.0f - float(i) / ball_trail.size()) + 0.2f);
             ImU32 col = IM_COL32(120, 70, 100, int(alpha * (1.0f - float(i) / ball_trail.size())));
-            dl.AddCircleFilled(sp, sr, col, 16);
+            add_world_circle(dl, ball_trail[i], r, col, q.circle_segments / 2);
         }
     }
 
     // Ball
-    ImVec2 sp = ImVec2(ball_pos.x * screen_scale.x, ball_pos.y * screen_scale.y);
-    float sr = ball_radius * screen_scale.x;
     ImU32 col = pierce_mode ? IM_COL32(255, 120, 120, 255) : IM_COL32(220, 70, 170, 255);
-    dl.AddCircleFilled(sp, sr, col, 32);
-    dl.AddCircle(sp, sr, IM_COL32(0, 0, 0, 130), 32, 1.5f);
+    add_world_circle(dl, ball_pos, ball_radius, col, q.circle_segments);
+    add_world_circle(dl, ball_pos, ball_radius, IM_COL32(0, 0, 0, 130), q.circle_segments, 1.5f);
 
     if (cheat_freeze_ball)
-        dl.AddCircle(sp, sr + 6.0f, IM_COL32(180, 220, 255, 80), 32, 3.0f);
+        add_world_circle(dl, ball_pos, ball_radius + 6.0f / screen_scale.x, IM_COL32(180, 220, 255, 80), q.circle_segments, 3.0f);
+
+    // World units -> screen (or world layer) pixels
+    transform_draw_list_range(dl, world_vtx_begin, scale, offset);
+}
+
+// Screen space labels: brick HP markers and bonus letters. Drawn into the frame rather than the
+// world layer, so text stays sharp at any internal resolution.
+void ArkanoidImpl::draw_world_labels(ImDrawList& dl)
+{
+    for (const auto& b : bricks) {
+        if (!b.alive || b.hidden || b.hit_points <= 1) continue;
+        ImVec2 p = world_to_screen(b.rect_world.pos);
+        char buf[8];
+        snprintf(buf, sizeof(buf), "x%d", b.hit_points);
+        dl.AddText(ImVec2(p.x + 6, p.y + 6), IM_COL32(30, 30, 30, 200), buf);
+    }
+    draw_bonus_labels(dl);
 }
 
 // ----------------- Draw Bonuses -----------------
 void ArkanoidImpl::draw_bonuses(ImDrawList& dl)
 {
     for (const auto& b : bonuses) {
-        // Convert world coordinates to screen coordinates
-        ImVec2 p0 = ImVec2(b.rect_world.pos.x * screen_scale.x, b.rect_world.pos.y * screen_scale.y);
-        ImVec2 p1 = ImVec2((b.rect_world.pos.x + b.rect_world.size.x) * screen_scale.x,
-            (b.rect_world.pos.y + b.rect_world.size.y) * screen_scale.y);
+        ImVec2 p0 = b.rect_world.pos;
+        ImVec2 p1 = b.rect_world.pos + b.rect_world.size;
 
         // Draw glow around the bonus with a pulsing alpha
         float pulse = 0.5f + 0.5f * std::sin(b.glow);
@@ -824,12 +1585,18 @@ void ArkanoidImpl::draw_bonuses(ImDrawList& dl)
             (b.color >> IM_COL32_B_SHIFT) & 255,
             int(80.0f * pulse)
         );
-        dl.AddRectFilled(ImVec2(p0.x - 3.0f, p0.y - 3.0f), ImVec2(p1.x + 3.0f, p1.y + 3.0f), glowcol, 8.0f);
+        ImVec2 glow(3.0f / screen_scale.x, 3.0f / screen_scale.y);
+        add_world_rect(dl, ImVec2(p0.x - glow.x, p0.y - glow.y), ImVec2(p1.x + glow.x, p1.y + glow.y), glowcol, 8.0f);
 
         // Draw bonus rectangle
-        dl.AddRectFilled(p0, p1, b.color, 6.0f);
-        dl.AddRect(p0, p1, IM_COL32(0, 0, 0, 100), 6.0f);
+        add_world_rect(dl, p0, p1, b.color, 6.0f);
+        add_world_rect(dl, p0, p1, IM_COL32(0, 0, 0, 100), 6.0f, 1.0f);
+    }
+}
 
+void ArkanoidImpl::draw_bonus_labels(ImDrawList& dl)
+{
+    for (const auto& b : bonuses) {
         // Draw label representing the bonus type
         const char* label = "?";
         switch (b.type) {
@@ -845,12 +1612,11 @@ void ArkanoidImpl::draw_bonuses(ImDrawList& dl)
         }
 
         // Center text in the bonus rectangle
-        ImVec2 mid = ImVec2((p0.x + p1.x) * 0.5f - 6.0f, (p0.y + p1.y) * 0.5f - 6.0f);
-        dl.AddText(mid, IM_COL32(24, 24, 24, 240), label);
+        ImVec2 mid = world_to_screen(rect_center(b.rect_world));
+        dl.AddText(ImVec2(mid.x - 6.0f, mid.y - 6.0f), IM_COL32(24, 24, 24, 240), label);
     }
 }
 
-
 // ----------------- Draw Game UI -----------------
 void ArkanoidImpl::draw_ui(ImGuiIO& io, ImDrawList& dl)
 {
@@ -940,7 +1706,7 @@ void ArkanoidImpl::draw_cheats_panel(ImGuiIO& io)
             "Buy +1 Life (E) - $20");
         try_buy(10, [&]() { magnet_active = true; magnet_timer = magnet_duration; shop_message = "Purchased Magnet!"; shop_message_timer = shop_message_duration; },
             "Buy Magnet (X) - $10");
-        try_buy(15, [&]() { score_mult_active = true; score_mult_timer = score_mult_duration; score_mult_value = (rand() % 2) ? 2 : 3; shop_message = "Purchased Score Multiplier!"; shop_message_timer = shop_message_duration; },
+        try_buy(15, [&]() { score_mult_active = true; score_mult_timer = score_mult_duration; score_mult_value = (rng() % 2) ? 2 : 3; shop_message = "Purchased Score Multiplier!"; shop_message_timer = shop_message_duration; },
             "Buy Multiplier (T) - $15");
         try_buy(60, [&]() { cheat_invincible = true; shop_message = "Purchased Invincibility!"; shop_message_timer = shop_message_duration; },
             "Buy Invincibility (Y) - $60");
@@ -1005,6 +1771,21 @@ void ArkanoidImpl::draw_main_debug_menu(ImGuiIO& io)
         if (ImGui::SliderFloat("Pad Y", &pady, ArkanoidSettings::bricks_rows_padding_min, ArkanoidSettings::bricks_rows_padding_max)) {
             settings.bricks_rows_padding = pady; rebuild = true;
         }
+
+        // Procedural generator
+        const char* gen_preview = level_generator(settings.level_generator).name();
+        if (ImGui::BeginCombo("Generator", gen_preview)) {
+            for (int i = 0; i < level_generator_count(); ++i) {
+                if (ImGui::Selectable(level_generator(i).name(), i == settings.level_generator)) {
+                    settings.level_generator = i; rebuild = true;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        int seed = (int)settings.seed;
+        if (ImGui::InputInt("Seed", &seed)) { settings.seed = (unsigned int)seed; rebuild = true; }
+        if (ImGui::SliderFloat("Density", &settings.level_density, 0.1f, 1.0f)) rebuild = true;
+        if (ImGui::SliderFloat("Difficulty", &settings.level_difficulty, 0.0f, 1.0f)) rebuild = true;
         if (rebuild) build_level(settings);
 
         ImGui::Separator();
@@ -1026,6 +1807,24 @@ void ArkanoidImpl::draw_main_debug_menu(ImGuiIO& io)
         // Physics debug
         ImGui::SliderFloat("Ball target speed", &ball_speed_target, ball_min_speed, ball_max_speed);
         ImGui::Checkbox("Show Trail", &trail_mode);
+        ImGui::SameLine();
+        ImGui::Checkbox("Level Editor", &editor.open);
+        ImGui::Checkbox("Physical Debris", &debris_mode);
+        if (debris_mode) {
+            ImGui::SliderFloat("Debris budget (us)", &debris.budget_us, 20.0f, 2000.0f);
+            ImGui::SliderFloat("Restitution", &debris.restitution, 0.0f, 1.0f);
+            ImGui::SliderInt("Max debris", &debris.max_count, 256, 16384);
+        }
+        ImGui::Checkbox("Brick Lighting", &light_mode);
+        ImGui::Checkbox("Dynamic Resolution", &world_layer.enabled);
+        if (world_layer.enabled) {
+            ImGui::SliderFloat("Min render scale", &world_layer.governor.min_scale, 0.25f, 1.0f);
+            ImGui::Checkbox("Adaptive", &world_layer.governor.enabled);
+            if (!world_layer.governor.enabled) {
+                float s = world_layer.governor.scale();
+                if (ImGui::SliderFloat("Render scale", &s, world_layer.governor.min_scale, 1.0f)) world_layer.governor.set_scale(s);
+            }
+        }
 
         ImGui::Separator();
 
@@ -1033,6 +1832,18 @@ void ArkanoidImpl::draw_main_debug_menu(ImGuiIO& io)
         ImGui::Text("Destroyed bricks: %d", destroyed_bricks_count);
         ImGui::Text("Next speedup in: %d", bricks_to_speedup - (destroyed_bricks_count % bricks_to_speedup));
 
+        ImGui::Separator();
+
+        // Performance
+        ImGui::Checkbox("Perf Overlay", &show_perf_overlay);
+        ImGui::SameLine();
+        ImGui::Checkbox("Adaptive Quality", &quality.enabled);
+        ImGui::SliderFloat("Frame budget (ms)", &quality.budget_ms, 1.0f, 33.0f);
+        if (!quality.enabled) {
+            int level = quality.level();
+            if (ImGui::SliderInt("Quality level", &level, 0, QualityGovernor::level_count - 1)) quality.set_level(level);
+        }
+
         ImGui::EndPopup();
     }
 
@@ -1040,6 +1851,50 @@ void ArkanoidImpl::draw_main_debug_menu(ImGuiIO& io)
 }
 
 
+/* ----------------- Perf Overlay ----------------- */
+void ArkanoidImpl::draw_perf_overlay(ImGuiIO& io)
+{
+    ImGui::SetNextWindowPos(ImVec2(12.0f, io.DisplaySize.y - 12.0f), ImGuiCond_Always, ImVec2(0.0f, 1.0f));
+    ImGui::SetNextWindowBgAlpha(0.55f);
+
+    ImGui::Begin("##perf_overlay", nullptr,
+        ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+        ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoFocusOnAppearing);
+
+    ImGui::Text("Frame %.2f ms (%.0f FPS)", perf.avg_frame_ms, perf.avg_frame_ms > 0.0f ? 1000.0f / perf.avg_frame_ms : 0.0f);
+    ImGui::Text("Work  %.2f ms  update %.3f  draw %.3f", perf.avg_work_ms, perf.update_ms, perf.draw_ms);
+    ImGui::PlotLines("##work", perf.work_history, PerfStats::history_size, perf.history_pos,
+        nullptr, 0.0f, quality.budget_ms * 2.0f, ImVec2(260.0f, 40.0f));
+
+    for (int i = 0; i < (int)PerfPhase::Count; ++i)
+        ImGui::Text("  %-10s %.3f ms", perf_phase_name((PerfPhase)i), perf.avg_phase_ms[i]);
+
+    ImGui::Text("Bricks %d/%d  Bonuses %d  Particles %d", brick_grid.alive, (int)bricks.size(), (int)bonuses.size(), (int)particles.size());
+    if (debris.size() > 0) {
+        const DebrisStats& d = debris.stats();
+        ImGui::Text("Debris %d (%d asleep)  collided %d  deferred %d  %.0f us", d.active, d.sleeping, d.collided, d.deferred, d.collide_us);
+    }
+    if (world_layer.active())
+        ImGui::Text("World layer %dx%d (%.0f%%)%s", world_layer.width(), world_layer.height(), world_layer.governor.scale() * 100.0f,
+            world_layer.governor.enabled ? "" : " [fixed]");
+    if (!brick_scripts.empty()) {
+        const BrickScriptStats& st = brick_scripts.stats();
+        ImGui::Text("Brick scripts %d (%d waiting)  resumed %d  %.0f us", st.running, st.queued, st.resumed, st.step_us);
+    }
+    if (light_mode)
+        ImGui::Text("Light map %dx%d  %d emitters  %.0f us", light_map.cols(), light_map.rows(), light_map.emitter_count(), light_map.build_us());
+    ImGui::Text("Level arena %.1f/%.1f KB in %d chunk(s)%s", level_arena.used() / 1024.0, level_arena.capacity() / 1024.0,
+        level_arena.chunk_count(), level_arena.huge_pages() ? ", huge pages" : "");
+
+    const QualityLevel& q = quality.current();
+    ImGui::Text("Quality: %s (%d)%s  budget %.1f ms", q.name, quality.level(), quality.enabled ? "" : " [fixed]", quality.budget_ms);
+    ImGui::Text("  particles %d/%d  trail %d  segments %d  detail %s",
+        q.particles_per_spawn, q.particles_max, q.trail_length, q.circle_segments, q.brick_detail ? "on" : "off");
+
+    ImGui::End();
+}
+
+
 /* ----------------- Centered Modal ----------------- */
 void ArkanoidImpl::draw_centered_modal(ImGuiIO& io, ImDrawList& dl, const char* title, const char* msg, ImU32 color)
 {
@@ -1,20 +1,121 @@
 ﻿#pragma once
 
 #include "arkanoid.h"
+#include "brick_grid.h"
+#include "brick_script.h"
+#include "debris.h"
+#include "light_map.h"
+#include "draw_geometry.h"
+#include "event_log.h"
+#include "level_arena.h"
+#include "level_editor.h"
+#include "levelgen.h"
+#include "perf.h"
+#include "quality.h"
+#include "world_layer.h"
 #include <vector>
 #include <string>
+#include <random>
+#include <cstdint>
 #include <imgui.h>
 
 #define USE_ARKANOID_IMPL
 
+class GameMetrics;
+
+// Compact per-frame view of the simulation state, used by golden replays.
+// Floats are stored bit-exact so that any gameplay change shows up in hash().
+struct ArkanoidStateDigest
+{
+    enum Field {
+        State, Score, Lives, Balance, TotalMoney, ComboMult, DestroyedBricks,
+        AliveBricks, BricksHash, BonusCount, BonusHash,
+        BallPosX, BallPosY, BallVelX, BallVelY, BallSpeedCur, BallSpeedTarget,
+        CarriageX, CarriageW, Flags,
+        Count
+    };
+
+    uint32_t fields[Count] = {};
+
+    void set_int(Field f, int v) { fields[f] = (uint32_t)v; }
+    void set_float(Field f, float v);
+    uint64_t hash() const;
+
+    static const char* field_name(int f);
+    static bool field_is_float(int f);
+    // Human readable value of a field ("120", "412.503")
+    static std::string format_field(int f, uint32_t value);
+};
+
 class ArkanoidImpl : public Arkanoid
 {
+    friend class ArkanoidMicroBench;   // drives the private hot routines (microbench.cpp)
+    friend class GoldenScenes;         // scripts the golden image scenes (golden.cpp)
+    friend class ScenarioRunner;       // forces scripted powerups, reads phase timings (scenario.cpp)
+    friend class PerfFuzzProbe;        // reads entity counts and powerups for fuzzer coverage (perf_fuzz.cpp)
+
 public:
     // Public API (overrides)
     void reset(const ArkanoidSettings& settings) override;
     void update(ImGuiIO& io, ArkanoidDebugData& debug_data, float elapsed) override;
     void draw(ImGuiIO& io, ImDrawList& draw_list) override;
 
+    // Fill a digest of the gameplay state (excludes purely visual state like particles)
+    void capture_digest(ArkanoidStateDigest& out) const;
+
+    // Read-only view of what a player sees, for tools (autopilot, analysis)
+    struct Observation {
+        Vect ball_pos, ball_vel;
+        float ball_radius;
+        Rect carriage;
+        Vect world_size;
+        bool playing, won;
+        int score, lives, balance, total_money, destroyed_bricks;
+    };
+    void observe(Observation& o) const;
+
+    // Capacities of the containers that grow during play, for the soak monitor
+    struct ContainerStats { size_t bricks, bonuses, particles, ball_trail, shop_message; };
+    void container_stats(ContainerStats& c) const {
+        c = { bricks.capacity(), bonuses.capacity(), particles.capacity(), ball_trail.capacity(), shop_message.capacity() };
+    }
+
+    int brick_count() const { return (int)bricks.size(); }
+    int brick_columns() const { return bricks_cols; }
+    bool brick_alive(int index) const { return bricks[index].alive; }
+
+    // Replace the generated layout (e.g. with a level from a pack) / reseed gameplay randomness
+    void load_level(const LevelData& level, const ArkanoidSettings& s);
+    void reseed(uint32_t seed) { rng.seed(seed); }
+
+    // Level editing, O(1) per brick: broadphase counts, the brick's geometry batch and the win state follow
+    int brick_rows() const { return bricks_rows; }
+    Rect brick_rect(int index) const { return bricks[index].rect_world; }
+    int brick_at(const Vect& world_pos) const { return brick_grid.cell_at(world_pos); }   // -1 outside the layout
+    LevelCell brick_cell(int index) const;
+    void set_brick_cell(int index, const LevelCell& cell);
+    void level_snapshot(LevelData& out) const;       // current layout as a level pack entry
+    void keep_level_on_restart() { capture_pristine_level(settings); }   // R restarts this layout (e.g. one loaded from a pack)
+    const ArkanoidSettings& current_settings() const { return settings; }
+    bool is_paused() const { return paused; }
+    void set_paused(bool p) { paused = p; }
+
+    // World <-> screen mapping of the last frame; world geometry goes through transform_draw_vertices() instead
+    inline ImVec2 world_to_screen(const Vect& w) const {
+        return ImVec2(w.x * screen_scale.x + screen_offset.x, w.y * screen_scale.y + screen_offset.y);
+    }
+    inline Vect screen_to_world(const ImVec2& p) const {
+        return Vect((p.x - screen_offset.x) / screen_scale.x, (p.y - screen_offset.y) / screen_scale.y);
+    }
+
+    // Offscreen world layer at a dynamic internal resolution; the host provides its texture
+    // and renders it each frame (see world_layer.h)
+    WorldLayer& offscreen_world() { return world_layer; }
+
+    // Full gameplay state as bytes (same build only), for crash dumps and instant restarts
+    void save_state(std::vector<uint8_t>& out) const;
+    bool load_state(const uint8_t* data, size_t size);
+
 private:
     // Game states
     enum class GameState { Playing, Win, Lose };
@@ -23,6 +124,8 @@ private:
     struct Brick {
         Rect rect_world;   // in world coordinates
         bool alive = true;
+        bool hidden = false;   // phased out by its script: no collisions, drawn as a ghost
+        uint8_t script = 0;    // BrickScriptType it runs
         int  score = 10;   // base score when destroyed
         bool bonus = false;// flagged to spawn a bonus when destroyed
         ImU32 color = IM_COL32(180, 200, 230, 255);
@@ -55,8 +158,24 @@ private:
         ImU32 color;
     };
 
+    // A level exactly as reset() built it. Levels are a pure function of the settings (seed
+    // included), so a restart with the same settings copies this back instead of regenerating.
+    struct PristineLevel {
+        bool valid = false;
+        ArkanoidSettings settings{};
+        std::vector<Brick> bricks;
+        int cols = 0;
+        int rows = 0;
+        Vect brick_size = Vect(0.0f, 0.0f);
+        Vect bricks_origin = Vect(0.0f, 0.0f);
+        std::mt19937 rng;
+    };
+
     // Internal helpers (logic)
+    void update_game(ImGuiIO& io, ArkanoidDebugData& debug_data, float elapsed);
     void build_level(const ArkanoidSettings& s);
+    void capture_pristine_level(const ArkanoidSettings& s);
+    bool restore_pristine_level(const ArkanoidSettings& s);
     void clamp_carriage();
     void launch_ball_if_needed();
     void integrate_ball(float dt);
@@ -72,52 +191,95 @@ private:
     void handle_cheats_and_controls(ImGuiIO& io, float dt);
 
     // Rendering helpers
-    void draw_world(ImDrawList& dl);
+    void draw_world(ImDrawList& dl, const Vect& scale, const Vect& offset);   // world units -> dl pixels
+    void draw_world_labels(ImDrawList& dl);     // brick HP and bonus letters, screen space
+    void rebuild_brick_geometry(const ImDrawList& target);
+    void emit_brick_geometry(const Brick& b, ImDrawList& dl, bool detail) const;
+    void add_world_circle(ImDrawList& dl, const Vect& center, float radius, ImU32 col, int segments, float thickness = 0.0f);
+    void add_world_rect(ImDrawList& dl, const ImVec2& p0, const ImVec2& p1, ImU32 col, float rounding_px, float thickness_px = 0.0f);
     void draw_ui(ImGuiIO& io, ImDrawList& dl);
     void draw_cheats_panel(ImGuiIO& io);        // separate cheat/shop popup (right side)
     void draw_main_debug_menu(ImGuiIO& io);     // single combined Arkanoid (Debug) menu (center top, dropdown)
     void draw_centered_modal(ImGuiIO& io, ImDrawList& dl, const char* title, const char* msg, ImU32 color);
+    void draw_perf_overlay(ImGuiIO& io);        // frame timings, entity counts and quality level (bottom left)
+    void publish_metrics(GameMetrics& m) const;
 
     // Bonus lifecycle
     void spawn_bonus_at(const Vect& world_pos, BonusType t);
     void integrate_bonuses(float dt);
     void draw_bonuses(ImDrawList& dl);
+    void draw_bonus_labels(ImDrawList& dl);
     void apply_bonus(Bonus& b);
 
     // Particles
     void spawn_particles(const Vect& world_pos, ImU32 color, int count = 14);
     void integrate_particles(float dt);
     void draw_particles(ImDrawList& dl);
+    void draw_brick_light(ImDrawList& dl);      // builds the light map and tints lit bricks
 
     // Shop / money helpers
     bool try_purchase(int cost);             // attempt to buy from balance
     void grant_money_from_score();           // convert score -> money periodically
     void add_money(int amount);              // add immediate money to balance/total
 
+    // Event log (event_log.h); no-ops unless a log is attached
+    void log_purchase(GameEventType type, int cost) const;
+    void log_brick_event(GameEventType type, int index, int gained) const;
+    void end_combo_chain();                  // logs the finished chain's length
+
     // Coordinate conversion helpers
     inline Vect world_to_screen_scale(ImGuiIO& io) const {
         return Vect(io.DisplaySize.x / world_size.x, io.DisplaySize.y / world_size.y);
     }
-    inline ImVec2 to_screen(ImGuiIO& io, const Vect& w) const {
-        Vect s = Vect(w.x * screen_scale.x, w.y * screen_scale.y);
-        return ImVec2(s);
+
+    // Brick state changes that keep the broadphase counts and geometry batches in sync
+    void set_brick_alive(int index, bool alive);
+    void mark_brick_dirty(int index) {
+        if (brick_geometry_dirty) return;   // a full rebuild is pending anyway
+        if (dirty_bricks.size() >= bricks.size()) { brick_geometry_dirty = true; dirty_bricks.clear(); return; }
+        dirty_bricks.push_back(index);
     }
-    inline float to_screen_x(float wx) const { return wx * screen_scale.x; }
-    inline float to_screen_y(float wy) const { return wy * screen_scale.y; }
+    void rebuild_brick_grid();
+    void release_level_storage();
+
+    // Scripted bricks (brick_script.h): start what the bricks' cells ask for / resume the due scripts
+    class ScriptWorld;
+    void start_brick_scripts();
+    void step_brick_scripts(float dt);
 
 private:
     // Settings & computed parameters
     ArkanoidSettings settings{};
     Vect world_size = Vect(800.0f, 600.0f);
     Vect screen_scale = Vect(1.0f, 1.0f);
+    Vect screen_offset = Vect(0.0f, 0.0f);
+
+    // Level-lifetime storage: everything allocated from it is dropped at once on the next level
+    LevelArena level_arena;
+    LevelData level_scratch;   // generator output, reused between levels
+    PristineLevel pristine;    // outlives the arena: plain heap, capacity kept between captures
 
     // Bricks
-    std::vector<Brick> bricks;
+    std::pmr::vector<Brick> bricks{ &level_arena };
     int bricks_cols = 0;
     int bricks_rows = 0;
     Vect brick_size = Vect(0.0f, 0.0f);
     Vect bricks_origin = Vect(0.0f, 0.0f);
 
+    // Broadphase over the layout; alive counts are updated with every brick change
+    BrickGrid brick_grid{ &level_arena };
+
+    // Per-brick behaviour scripts, resumed from a wake-time run queue each step
+    BrickScripts brick_scripts{ &level_arena };
+
+    // Brick geometry in world units, one batch per brick. Changed bricks are re-recorded
+    // individually; the whole cache on layout or detail level changes. Corner radii and outlines
+    // are world units too, so a window resize only changes the transform.
+    DrawGeometryCache brick_geometry;
+    bool brick_geometry_dirty = true;
+    bool brick_geometry_detail = true;
+    std::pmr::vector<int> dirty_bricks{ &level_arena };
+
     // destroyed bricks counter -> used for speedup mechanic
     int destroyed_bricks_count = 0;
 
@@ -126,6 +288,12 @@ private:
 
     // Particles
     std::vector<Particle> particles;
+    DebrisSystem debris;        // physical debris (visual only, not saved)
+    bool debris_mode = false;   // spawn_particles() feeds debris instead of sparks
+
+    // Glow from the ball and bonuses onto bricks (visual only, not saved)
+    LightMap light_map;
+    bool light_mode = false;
 
     // Paddle
     Rect carriage_world = Rect(Vect(0, 0), Vect(100, 20));
@@ -140,6 +308,7 @@ private:
     float ball_speed_cur = 150.0f;
     float ball_min_speed = 60.0f;     // safety floor
     float ball_max_speed = 5000.0f;   // absolute cap
+    float freeze_timer = 0.0f;        // remaining slow-down time of the freeze cheat
 
     // Core game logic
     GameState state = GameState::Playing;
@@ -148,6 +317,7 @@ private:
     float combo_timer = 0.0f;
     float combo_window = 1.2f; // combo window seconds
     int combo_mult = 1;
+    int combo_chain = 0;       // hits in the running combo; event log only, not saved state
 
     // Effects / flags
     bool pierce_mode = false;
@@ -188,6 +358,9 @@ private:
     // Pause for testing
     bool paused = false;
 
+    // Gameplay randomness, seeded from settings on reset so sessions are reproducible
+    std::mt19937 rng{ 1337 };
+
     // Speedup policy: every N destroyed bricks multiply speed by factor
     int bricks_to_speedup = 10;
     float speedup_factor = 1.10f; // +10%
@@ -203,4 +376,12 @@ private:
     float shop_message_timer = 0.0f;
     float shop_message_duration = 2.5f; // seconds to display a message
 
+    // Performance overlay & adaptive visual quality
+    PerfStats perf;
+    QualityGovernor quality;
+    WorldLayer world_layer;
+    bool show_perf_overlay = false;
+
+    LevelEditor editor;
+
 };
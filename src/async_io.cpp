@@ -0,0 +1,478 @@
+#include "async_io.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define ARKANOID_POSIX_IO 1
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define ARKANOID_IO_URING 1
+#endif
+#endif
+#endif
+
+static bool async_io_threads_only = false;
+
+void set_async_io_threads_only(bool enabled) { async_io_threads_only = enabled; }
+
+static double now_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AsyncIoStats::print(FILE* f, const char* backend) const {
+    fprintf(f, "async io (%s): %llu writes, %.1f MB, %llu syncs, %llu submits, %llu stalls (%.2f s), %llu errors\n", backend,
+        (unsigned long long)writes, bytes / (1024.0 * 1024.0), (unsigned long long)syncs, (unsigned long long)submits,
+        (unsigned long long)stalls, stall_seconds, (unsigned long long)errors);
+}
+
+
+
+// ----------------- Files -----------------
+
+struct AsyncFile::Handle
+{
+#if ARKANOID_POSIX_IO
+    int fd = -1;
+#else
+    FILE* file = nullptr;
+#endif
+    int pending = 0;                  // requests queued or in flight, under the engine mutex
+    std::atomic<bool> failed{ false };
+};
+
+static bool open_now(const std::string& path, AsyncFile::Handle& h) {
+#if ARKANOID_POSIX_IO
+    h.fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    return h.fd >= 0;
+#else
+    h.file = fopen(path.c_str(), "wb");
+    return h.file != nullptr;
+#endif
+}
+
+// Bytes written, or -1
+static long write_now(AsyncFile::Handle& h, const uint8_t* data, size_t size, uint64_t offset) {
+    size_t done = 0;
+#if ARKANOID_POSIX_IO
+    while (done < size) {
+        ssize_t n = ::pwrite(h.fd, data + done, size - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        done += (size_t)n;
+    }
+#else
+    // One pool thread on this path, so seek + write can't interleave
+    if (fseek(h.file, (long)offset, SEEK_SET) != 0 || fwrite(data, 1, size, h.file) != size) return -1;
+    done = size;
+#endif
+    return (long)done;
+}
+
+static bool sync_now(AsyncFile::Handle& h) {
+#if defined(__linux__)
+    return fdatasync(h.fd) == 0;
+#elif ARKANOID_POSIX_IO
+    return fsync(h.fd) == 0;
+#else
+    return fflush(h.file) == 0;
+#endif
+}
+
+static bool close_now(AsyncFile::Handle& h) {
+#if ARKANOID_POSIX_IO
+    return ::close(h.fd) == 0;
+#else
+    return fclose(h.file) == 0;
+#endif
+}
+
+bool AsyncFile::open(const std::string& path) {
+    close();
+    Handle* h = new Handle;
+    if (!open_now(path, *h)) {
+        delete h;
+        return false;
+    }
+    handle = h;
+    io = &AsyncIo::shared();
+    buffer = -1;
+    fill = 0;
+    append_offset = 0;
+    return true;
+}
+
+bool AsyncFile::write(const void* data, size_t size) {
+    if (!handle) return false;
+    const uint8_t* p = (const uint8_t*)data;
+    while (size > 0) {
+        if (buffer < 0) {
+            buffer = io->acquire_buffer();
+            fill = 0;
+        }
+        size_t n = std::min(size, AsyncIo::buffer_size - fill);
+        memcpy(io->buffer_data(buffer) + fill, p, n);
+        fill += n;
+        p += n;
+        size -= n;
+        if (fill == AsyncIo::buffer_size) flush();
+    }
+    return !handle->failed.load(std::memory_order_relaxed);
+}
+
+void AsyncFile::flush() {
+    if (buffer < 0) return;
+    AsyncIo::Request r;
+    r.file = handle;
+    r.buffer = buffer;
+    r.size = fill;
+    r.offset = append_offset;
+    io->submit(r);
+    append_offset += fill;
+    buffer = -1;
+    fill = 0;
+}
+
+bool AsyncFile::write_at(const void* data, size_t size, uint64_t offset) {
+    if (!handle) return false;
+    flush();
+    const uint8_t* p = (const uint8_t*)data;
+    while (size > 0) {
+        AsyncIo::Request r;
+        r.drain = true;
+        r.file = handle;
+        r.buffer = io->acquire_buffer();
+        r.size = std::min(size, AsyncIo::buffer_size);
+        r.offset = offset;
+        memcpy(io->buffer_data(r.buffer), p, r.size);
+        io->submit(r);
+        p += r.size;
+        offset += r.size;
+        size -= r.size;
+    }
+    return !handle->failed.load(std::memory_order_relaxed);
+}
+
+void AsyncFile::sync() {
+    if (!handle) return;
+    flush();
+    AsyncIo::Request r;
+    r.op = AsyncIo::Op::Sync;
+    r.drain = true;
+    r.file = handle;
+    io->submit(r);
+}
+
+bool AsyncFile::close() {
+    if (!handle) return true;
+    flush();
+    io->wait_idle(handle);
+    bool ok = !handle->failed.load();
+    ok = close_now(*handle) && ok;
+    delete handle;
+    handle = nullptr;
+    return ok;
+}
+
+
+
+// ----------------- Engine -----------------
+
+AsyncIo& AsyncIo::shared() {
+    static AsyncIo io(!async_io_threads_only);
+    return io;
+}
+
+int AsyncIo::acquire_buffer() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (free_buffers.empty()) {
+        double t0 = now_seconds();
+        completed.wait(lock, [&]() { return !free_buffers.empty(); });
+        totals.stalls++;
+        totals.stall_seconds += now_seconds() - t0;
+    }
+    int b = free_buffers.back();
+    free_buffers.pop_back();
+    return b;
+}
+
+void AsyncIo::submit(const Request& r) {
+    std::lock_guard<std::mutex> lock(mutex);
+    r.file->pending++;
+    queue.push_back(r);
+    work_ready.notify_all();
+}
+
+void AsyncIo::wait_idle(AsyncFile::Handle* file) {
+    std::unique_lock<std::mutex> lock(mutex);
+    completed.wait(lock, [&]() { return file->pending == 0; });
+}
+
+AsyncIoStats AsyncIo::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totals;
+}
+
+// result: bytes this attempt wrote / 0 for a sync, negative on error. in_flight is already decremented.
+void AsyncIo::complete_locked(Request& r, long result) {
+    if (r.op == Op::Write && result > 0 && r.done + (size_t)result < r.size) {
+        // Short write: the rest goes again, ahead of anything queued since
+        r.done += (size_t)result;
+        queue.push_front(r);
+        work_ready.notify_all();
+        return;
+    }
+    if (result < 0 || (r.op == Op::Write && result == 0)) {
+        r.file->failed = true;
+        totals.errors++;
+    } else if (r.op == Op::Write) {
+        totals.writes++;
+        totals.bytes += r.size;
+    } else {
+        totals.syncs++;
+    }
+    if (r.buffer >= 0) free_buffers.push_back(r.buffer);
+    r.file->pending--;
+    completed.notify_all();
+}
+
+// Thread pool backend: positional writes, so requests for one file may run in parallel;
+// a drain request waits until the pool is idle.
+void AsyncIo::pool_worker() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        if (queue.empty() || (queue.front().drain && in_flight > 0)) {
+            if (stopping && queue.empty()) return;
+            work_ready.wait(lock);
+            continue;
+        }
+        Request r = queue.front();
+        queue.pop_front();
+        in_flight++;
+        totals.submits++;
+        lock.unlock();
+
+        long result;
+        if (r.op == Op::Write) result = write_now(*r.file, buffer_data(r.buffer) + r.done, r.size - r.done, r.offset + r.done);
+        else result = sync_now(*r.file) ? 0 : -1;
+
+        lock.lock();
+        in_flight--;
+        complete_locked(r, result);
+        work_ready.notify_all();   // a drain request may be waiting for the pool to go idle
+    }
+}
+
+const char* AsyncIo::backend_name() const {
+#if ARKANOID_IO_URING
+    if (ring) return fixed_buffers() ? "io_uring, registered buffers" : "io_uring";
+#endif
+    return "thread pool";
+}
+
+
+
+// ----------------- io_uring -----------------
+
+#if ARKANOID_IO_URING
+
+struct AsyncIo::Ring
+{
+    static constexpr unsigned entries = 64;
+
+    int fd = -1;
+    bool fixed = false;               // buffers registered: IORING_OP_WRITE_FIXED
+
+    void* sq_map = nullptr;
+    void* cq_map = nullptr;
+    size_t sq_map_size = 0, cq_map_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned cq_mask = 0;
+
+    Request slots[entries];           // requests the kernel owns; user_data is the index
+    std::vector<unsigned> free_slots;
+    iovec iov[entries];               // unregistered path: IORING_OP_WRITEV
+};
+
+static void destroy_ring(AsyncIo::Ring* r);
+
+static AsyncIo::Ring* create_ring(uint8_t* buffers) {
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = (int)syscall(__NR_io_uring_setup, AsyncIo::Ring::entries, &p);
+    if (fd < 0) return nullptr;
+
+    AsyncIo::Ring* r = new AsyncIo::Ring;
+    r->fd = fd;
+    r->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) r->sq_map_size = r->cq_map_size = std::max(r->sq_map_size, r->cq_map_size);
+
+    r->sq_map = mmap(nullptr, r->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (r->sq_map == MAP_FAILED) { r->sq_map = nullptr; destroy_ring(r); return nullptr; }
+    r->cq_map = single ? r->sq_map : mmap(nullptr, r->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (r->cq_map == MAP_FAILED) { r->cq_map = nullptr; destroy_ring(r); return nullptr; }
+    r->sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) { destroy_ring(r); return nullptr; }
+    r->sqes = (io_uring_sqe*)sqes;
+
+    uint8_t* sq = (uint8_t*)r->sq_map;
+    uint8_t* cq = (uint8_t*)r->cq_map;
+    r->sq_head = (unsigned*)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    r->sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned*)(sq + p.sq_off.array);
+    r->cq_head = (unsigned*)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    r->cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+    r->cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+
+    // Registration pins the buffers once instead of on every write; it can fail on a low
+    // RLIMIT_MEMLOCK, then plain writev requests are used
+    iovec regs[AsyncIo::buffer_count];
+    for (int i = 0; i < AsyncIo::buffer_count; ++i) regs[i] = { buffers + (size_t)i * AsyncIo::buffer_size, AsyncIo::buffer_size };
+    r->fixed = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, regs, AsyncIo::buffer_count) == 0;
+
+    for (unsigned i = AsyncIo::Ring::entries; i-- > 0;) r->free_slots.push_back(i);
+    return r;
+}
+
+static void destroy_ring(AsyncIo::Ring* r) {
+    if (r->sqes) munmap(r->sqes, r->sqes_size);
+    if (r->cq_map && r->cq_map != r->sq_map) munmap(r->cq_map, r->cq_map_size);
+    if (r->sq_map) munmap(r->sq_map, r->sq_map_size);
+    close(r->fd);
+    delete r;
+}
+
+bool AsyncIo::fixed_buffers() const { return ring && ring->fixed; }
+
+// The one thread that owns the ring: moves queued requests into SQEs, submits them with one
+// io_uring_enter that also waits for at least one completion, then reaps every completion
+// there is. Requests queued meanwhile go with the next batch.
+void AsyncIo::ring_loop() {
+    Ring& r = *ring;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        while (queue.empty() && in_flight == 0 && !stopping) work_ready.wait(lock);
+        if (queue.empty() && in_flight == 0) return;   // stopping and drained
+
+        unsigned tail = *r.sq_tail;
+        unsigned to_submit = 0;
+        while (!queue.empty() && !r.free_slots.empty()) {
+            unsigned slot = r.free_slots.back();
+            r.free_slots.pop_back();
+            Request& q = r.slots[slot];
+            q = queue.front();
+            queue.pop_front();
+
+            unsigned index = tail & r.sq_mask;
+            io_uring_sqe& sqe = r.sqes[index];
+            memset(&sqe, 0, sizeof(sqe));
+            sqe.fd = q.file->fd;
+            sqe.flags = q.drain ? IOSQE_IO_DRAIN : 0;
+            sqe.user_data = slot;
+            if (q.op == Op::Sync) {
+                sqe.opcode = IORING_OP_FSYNC;
+                sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+            } else if (r.fixed) {
+                sqe.opcode = IORING_OP_WRITE_FIXED;
+                sqe.addr = (uint64_t)(uintptr_t)(buffer_data(q.buffer) + q.done);
+                sqe.len = (uint32_t)(q.size - q.done);
+                sqe.off = q.offset + q.done;
+                sqe.buf_index = (uint16_t)q.buffer;
+            } else {
+                r.iov[slot] = { buffer_data(q.buffer) + q.done, q.size - q.done };
+                sqe.opcode = IORING_OP_WRITEV;
+                sqe.addr = (uint64_t)(uintptr_t)&r.iov[slot];
+                sqe.len = 1;
+                sqe.off = q.offset + q.done;
+            }
+            r.sq_array[index] = index;
+            tail++;
+            to_submit++;
+        }
+        in_flight += (int)to_submit;
+        if (to_submit > 0) {
+            __atomic_store_n(r.sq_tail, tail, __ATOMIC_RELEASE);
+            totals.submits++;
+        }
+        lock.unlock();
+
+        long ret;
+        do ret = syscall(__NR_io_uring_enter, r.fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        while (ret < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY));
+
+        lock.lock();
+        unsigned head = *r.cq_head;
+        unsigned cq_tail = __atomic_load_n(r.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != cq_tail; ++head) {
+            const io_uring_cqe& cqe = r.cqes[head & r.cq_mask];
+            unsigned slot = (unsigned)cqe.user_data;
+            Request q = r.slots[slot];
+            r.free_slots.push_back(slot);
+            in_flight--;
+            complete_locked(q, cqe.res);
+        }
+        __atomic_store_n(r.cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+
+#else
+
+struct AsyncIo::Ring {};
+static AsyncIo::Ring* create_ring(uint8_t*) { return nullptr; }
+static void destroy_ring(AsyncIo::Ring* r) { delete r; }
+bool AsyncIo::fixed_buffers() const { return false; }
+void AsyncIo::ring_loop() {}
+
+#endif
+
+AsyncIo::AsyncIo(bool allow_io_uring) {
+    buffers = new uint8_t[buffer_size * buffer_count];
+    for (int i = buffer_count; i-- > 0;) free_buffers.push_back(i);
+    if (allow_io_uring) ring = create_ring(buffers);
+    if (ring) {
+        threads.emplace_back(&AsyncIo::ring_loop, this);
+    } else {
+#if ARKANOID_POSIX_IO
+        unsigned pool = 2;
+#else
+        unsigned pool = 1;
+#endif
+        for (unsigned i = 0; i < pool; ++i) threads.emplace_back(&AsyncIo::pool_worker, this);
+    }
+}
+
+AsyncIo::~AsyncIo() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (auto& t : threads) t.join();
+    if (ring) destroy_ring(ring);
+    delete[] buffers;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Asynchronous file output shared by every writer that runs during gameplay (event log, video
+// and draw captures). Writers copy their bytes into the engine's fixed buffers and go on; one
+// background thread submits full buffers in batches to an io_uring (raw syscalls, buffers
+// registered with the kernel once) and reaps the completions. Where io_uring is unavailable
+// (old kernel, seccomp, other OS) a small thread pool does plain positional writes instead.
+//
+// Back-pressure comes from the buffer pool: when every buffer is in flight, write() waits for a
+// completion (counted as a stall), so memory stays bounded whatever the disk does.
+
+struct AsyncIoStats
+{
+    uint64_t writes = 0;          // write requests completed
+    uint64_t bytes = 0;
+    uint64_t syncs = 0;
+    uint64_t submits = 0;         // io_uring_enter calls (or pool wake-ups) that submitted work
+    uint64_t stalls = 0;          // write() calls that waited for a free buffer
+    double stall_seconds = 0.0;
+    uint64_t errors = 0;
+
+    void print(FILE* f, const char* backend) const;
+};
+
+class AsyncIo;
+
+// A file written through the engine. write() appends; write_at() patches bytes already written
+// (headers) and runs after everything queued before it, like sync().
+class AsyncFile
+{
+public:
+    AsyncFile() = default;
+    AsyncFile(const AsyncFile&) = delete;
+    AsyncFile& operator=(const AsyncFile&) = delete;
+    ~AsyncFile() { close(); }
+
+    struct Handle;                // platform file, defined in async_io.cpp
+
+    bool open(const std::string& path);
+    bool is_open() const { return handle != nullptr; }
+
+    // Copies the bytes; false once any write to this file has failed
+    bool write(const void* data, size_t size);
+    bool write_at(const void* data, size_t size, uint64_t offset);
+    void sync();                  // flush to the device (fdatasync) after everything queued so far
+
+    uint64_t size() const { return append_offset + fill; }
+
+    // Waits for this file's requests and closes it; false if anything failed
+    bool close();
+
+private:
+    friend class AsyncIo;
+
+    void flush();                 // queue the buffer being filled
+
+    Handle* handle = nullptr;
+    AsyncIo* io = nullptr;
+    int buffer = -1;              // buffer being filled, -1 = none
+    size_t fill = 0;
+    uint64_t append_offset = 0;   // file offset of the buffer being filled
+};
+
+class AsyncIo
+{
+public:
+    static constexpr size_t buffer_size = 256 << 10;
+    static constexpr int buffer_count = 32;
+
+    enum class Backend { IoUring, ThreadPool };
+
+    // The engine every writer shares, started on first use
+    static AsyncIo& shared();
+
+    struct Ring;                  // io_uring state, defined in async_io.cpp
+
+    explicit AsyncIo(bool allow_io_uring);
+    AsyncIo(const AsyncIo&) = delete;
+    AsyncIo& operator=(const AsyncIo&) = delete;
+    ~AsyncIo();
+
+    Backend backend() const { return ring ? Backend::IoUring : Backend::ThreadPool; }
+    const char* backend_name() const;
+    AsyncIoStats stats();
+
+private:
+    friend class AsyncFile;
+
+    enum class Op : uint8_t { Write, Sync };
+    struct Request
+    {
+        Op op = Op::Write;
+        bool drain = false;       // start only after everything submitted before has completed
+        AsyncFile::Handle* file = nullptr;
+        int buffer = -1;
+        size_t size = 0;          // bytes in the buffer
+        size_t done = 0;          // already written (short writes are resubmitted)
+        uint64_t offset = 0;
+    };
+
+    int acquire_buffer();
+    uint8_t* buffer_data(int buffer) { return buffers + (size_t)buffer * buffer_size; }
+    void submit(const Request& r);
+    void wait_idle(AsyncFile::Handle* file);
+    void complete_locked(Request& r, long result);
+
+    bool fixed_buffers() const;
+    void ring_loop();
+    void pool_worker();
+
+    uint8_t* buffers = nullptr;
+    std::vector<int> free_buffers;
+    Ring* ring = nullptr;
+
+    std::mutex mutex;
+    std::condition_variable work_ready;   // a request was queued (or stopping)
+    std::condition_variable completed;    // a request finished: buffers and files to wake
+    std::deque<Request> queue;
+    int in_flight = 0;
+    bool stopping = false;
+    AsyncIoStats totals;
+    std::vector<std::thread> threads;
+};
+
+// Use the thread pool even where io_uring works (--no-io-uring); set before the first file opens
+void set_async_io_threads_only(bool enabled);
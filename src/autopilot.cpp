@@ -0,0 +1,43 @@
+#include "autopilot.h"
+#include "headless.h"
+#include <cmath>
+
+Autopilot::Autopilot(uint32_t seed) : rng(seed) {}
+
+// Fold x into [lo, hi] as if reflected by the side walls
+static float fold_between_walls(float x, float lo, float hi) {
+    float w = hi - lo;
+    if (w <= 0.0f) return lo;
+    float t = std::fmod(x - lo, 2.0f * w);
+    if (t < 0.0f) t += 2.0f * w;
+    return lo + (t <= w ? t : 2.0f * w - t);
+}
+
+uint32_t Autopilot::keys(const ArkanoidImpl::Observation& o) {
+    if (!o.playing) return 0;
+
+    float paddle_center = o.carriage.pos.x + o.carriage.size.x * 0.5f;
+    float target = o.ball_pos.x;
+
+    if (o.ball_vel.y > 1e-3f) {
+        float line_y = o.carriage.pos.y - o.ball_radius;
+        float t = std::max(0.0f, (line_y - o.ball_pos.y) / o.ball_vel.y);
+        float travel = o.ball_vel.x * t;
+
+        // New descent: pick where on the paddle to take the ball and how wrong the read is
+        if (!descending) {
+            std::uniform_real_distribution<float> d(-aim_spread, aim_spread);
+            std::normal_distribution<float> miss(0.0f, prediction_error);
+            aim_offset = d(rng) * o.carriage.size.x + miss(rng) * std::abs(travel);
+        }
+        descending = true;
+
+        target = fold_between_walls(o.ball_pos.x + travel, o.ball_radius, o.world_size.x - o.ball_radius);
+        target += aim_offset;
+    }
+    else descending = false;
+
+    if (target < paddle_center - dead_zone) return GameKey_Left;
+    if (target > paddle_center + dead_zone) return GameKey_Right;
+    return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "arkanoid_impl.h"
+#include <cstdint>
+#include <random>
+
+// Simple computer player: predicts where the ball crosses the paddle line and steers there.
+// The aim point under the ball is jittered per bounce (from its own seed), so games with
+// different seeds hit bricks from different angles. The prediction is made imperfect on
+// purpose, so long diagonal shots are sometimes missed like a human would.
+class Autopilot
+{
+public:
+    explicit Autopilot(uint32_t seed = 1);
+
+    uint32_t keys(const ArkanoidImpl::Observation& o);   // GameKeyBit mask for this frame
+
+    float aim_spread = 0.35f;   // max aim offset, as a fraction of the paddle width
+    float dead_zone = 4.0f;     // world units
+    float prediction_error = 0.1f;    // std dev of the misread, relative to the horizontal travel left
+
+private:
+    std::mt19937 rng;
+    float aim_offset = 0.0f;
+    bool descending = false;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "base.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Broadphase over the brick layout. Bricks sit on a regular grid, so the cells a circle can
+// touch follow directly from its bounds. Alive counts per row and in total are kept
+// incrementally (O(1) per brick change): empty rows are skipped and the win check is O(1).
+struct BrickGrid
+{
+    int cols = 0, rows = 0;
+    Vect origin = Vect(0.0f, 0.0f);
+    Vect pitch = Vect(1.0f, 1.0f);   // brick size + padding
+    std::pmr::vector<int> row_alive;
+    std::pmr::vector<uint8_t> cell_alive;   // 1 per live brick, for lookups that don't touch the bricks
+    int alive = 0;
+
+    explicit BrickGrid(std::pmr::memory_resource* r = std::pmr::get_default_resource()) : row_alive(r), cell_alive(r) {}
+
+    void reset(int c, int r, const Vect& grid_origin, const Vect& cell_pitch) {
+        cols = c;
+        rows = r;
+        origin = grid_origin;
+        pitch = cell_pitch;
+        row_alive.assign((size_t)rows, 0);
+        cell_alive.assign((size_t)cols * rows, 0);
+        alive = 0;
+    }
+
+    // Drop the row storage (before its memory resource is released)
+    void release() {
+        row_alive = std::pmr::vector<int>(row_alive.get_allocator());
+        cell_alive = std::pmr::vector<uint8_t>(cell_alive.get_allocator());
+        cols = rows = alive = 0;
+    }
+
+    void set_alive(int index, bool now_alive) {
+        int d = now_alive ? 1 : -1;
+        row_alive[index / cols] += d;
+        cell_alive[index] = now_alive ? 1 : 0;
+        alive += d;
+    }
+
+    // Cell whose pitch area contains p, or -1
+    int cell_at(const Vect& p) const {
+        int c = (int)std::floor((p.x - origin.x) / pitch.x);
+        int r = (int)std::floor((p.y - origin.y) / pitch.y);
+        return (c >= 0 && c < cols && r >= 0 && r < rows) ? r * cols + c : -1;
+    }
+
+    // Inclusive cell range overlapped by the box [lo, hi] (grown by a unit so touching
+    // contacts are never missed); false when the box misses the grid entirely
+    bool query(const Vect& lo, const Vect& hi, int& c0, int& c1, int& r0, int& r1) const {
+        if (cols == 0 || rows == 0) return false;
+        c0 = std::max(0, (int)std::floor((lo.x - 1.0f - origin.x) / pitch.x));
+        c1 = std::min(cols - 1, (int)std::floor((hi.x + 1.0f - origin.x) / pitch.x));
+        r0 = std::max(0, (int)std::floor((lo.y - 1.0f - origin.y) / pitch.y));
+        r1 = std::min(rows - 1, (int)std::floor((hi.y + 1.0f - origin.y) / pitch.y));
+        return c0 <= c1 && r0 <= r1;
+    }
+};
@@ -0,0 +1,263 @@
+#include "brick_script.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+
+const char* brick_script_name(int type) {
+    static const char* names[(int)BrickScriptType::Count] = { "none", "blink", "regenerate", "reinforce", "patrol" };
+    return (type >= 0 && type < (int)BrickScriptType::Count) ? names[type] : "?";
+}
+
+
+
+// ----------------- Coroutines -----------------
+
+// A script body is one switch over the frame's resume point; every wait stores its label and
+// returns the delay to the scheduler. Labels are saved with the game state, so they are fixed
+// numbers (unique within a script, never reused for another wait) rather than __LINE__: editing a
+// script must not change where a saved frame resumes. Changing what a label means bumps
+// brick_script_abi. Locals don't survive a wait (keep those in
+// the frame), and a local must not be alive across a wait: the switch would jump over its
+// initialisation.
+static const float park = -1.0f;     // wait for a hit
+static const float done = -2.0f;     // finished
+
+#define SCRIPT_BEGIN(f)                switch ((f).point) { case 0:
+#define SCRIPT_WAIT(f, label, seconds) do { (f).point = (label); return (seconds); case (label):; } while (0)
+#define SCRIPT_WAIT_HIT(f, label)      do { (f).point = (label); return park; case (label):; } while (0)
+#define SCRIPT_END(f)           } return done
+
+static const float blink_visible = 1.6f;
+static const float blink_hidden = 0.7f;
+static const float regenerate_delay = 3.0f;   // after the last hit, per hit point
+static const float reinforce_delay = 4.0f;
+static const int reinforce_max = 3;
+static const float patrol_step = 0.8f;
+static const int8_t patrol_path[] = { 1, 1, -1, -1, -1, -1, 1, 1 };   // column steps, back where it started
+
+// Visible, then intangible for a moment, forever. Neighbours are out of step.
+static float run_blink(BrickScriptFrame& f, BrickScriptWorld& w) {
+    SCRIPT_BEGIN(f);
+    SCRIPT_WAIT(f, 1, 0.2f * (f.brick % 8));
+    for (;;) {
+        SCRIPT_WAIT(f, 2, blink_visible);
+        w.set_hidden(f.brick, true);
+        SCRIPT_WAIT(f, 3, blink_hidden);
+        w.set_hidden(f.brick, false);
+    }
+    SCRIPT_END(f);
+}
+
+// Gets a hit point back every few seconds without a hit, up to what it started with
+static float run_regenerate(BrickScriptFrame& f, BrickScriptWorld& w) {
+    SCRIPT_BEGIN(f);
+    f.arg = (uint8_t)w.hit_points(f.brick);
+    for (;;) {
+        if (w.hit_points(f.brick) >= f.arg) SCRIPT_WAIT_HIT(f, 1);
+        f.flags &= (uint8_t)~BrickScriptFrame::Signalled;
+        SCRIPT_WAIT(f, 2, regenerate_delay);
+        if (f.flags & BrickScriptFrame::Signalled) continue;   // hit again meanwhile: the delay starts over
+        {
+            int hp = w.hit_points(f.brick) + 1;
+            w.set_hit_points(f.brick, hp, hp >= f.arg);
+        }
+    }
+    SCRIPT_END(f);
+}
+
+// Fills an empty neighbouring cell with a new brick now and then, a few times
+static float run_reinforce(BrickScriptFrame& f, BrickScriptWorld& w) {
+    SCRIPT_BEGIN(f);
+    SCRIPT_WAIT(f, 1, reinforce_delay + 0.5f * (f.brick % 4));
+    while (f.count < reinforce_max) {
+        {
+            static const int dc[4] = { 1, 0, -1, 0 }, dr[4] = { 0, 1, 0, -1 };
+            int cols = w.columns(), c = f.brick % cols, r = f.brick / cols;
+            for (int k = 0; k < 4; ++k) {
+                int d = (f.brick + f.count + k) & 3;
+                int nc = c + dc[d], nr = r + dr[d];
+                if (nc < 0 || nc >= cols || nr < 0 || nr >= w.rows()) continue;
+                int to = nr * cols + nc;
+                if (w.hit_points(to) == 0 && w.spawn(f.brick, to)) break;
+            }
+        }
+        f.count++;
+        SCRIPT_WAIT(f, 2, reinforce_delay);
+    }
+    SCRIPT_END(f);
+}
+
+// Walks along its row following patrol_path; a step into an occupied cell or a wall is skipped
+static float run_patrol(BrickScriptFrame& f, BrickScriptWorld& w) {
+    SCRIPT_BEGIN(f);
+    SCRIPT_WAIT(f, 1, 0.1f * (f.brick % 8));
+    for (;;) {
+        for (f.count = 0; f.count < (int)sizeof(patrol_path); ++f.count) {
+            SCRIPT_WAIT(f, 2, patrol_step);
+            {
+                int cols = w.columns(), c = f.brick % cols + patrol_path[f.count];
+                int to = f.brick + patrol_path[f.count];
+                if (c >= 0 && c < cols && w.hit_points(to) == 0 && w.move(f.brick, to)) f.brick = to;
+            }
+        }
+    }
+    SCRIPT_END(f);
+}
+
+#undef SCRIPT_BEGIN
+#undef SCRIPT_WAIT
+#undef SCRIPT_WAIT_HIT
+#undef SCRIPT_END
+
+float BrickScripts::resume(BrickScriptFrame& f, BrickScriptWorld& world) {
+    switch ((BrickScriptType)f.type) {
+    case BrickScriptType::Blink: return run_blink(f, world);
+    case BrickScriptType::Regenerate: return run_regenerate(f, world);
+    case BrickScriptType::Reinforce: return run_reinforce(f, world);
+    case BrickScriptType::Patrol: return run_patrol(f, world);
+    default: return done;
+    }
+}
+
+
+
+// ----------------- Scheduler -----------------
+
+void BrickScripts::reset(int cells) {
+    clock = 0.0f;
+    frames.clear();
+    queue.clear();
+    frame_of.assign((size_t)cells, -1);
+    free_frames.clear();
+    running = 0;
+    last = BrickScriptStats();
+}
+
+void BrickScripts::release() {
+    frames = std::pmr::vector<BrickScriptFrame>(frames.get_allocator());
+    queue = std::pmr::vector<int32_t>(queue.get_allocator());
+    frame_of = std::pmr::vector<int32_t>(frame_of.get_allocator());
+    free_frames = std::pmr::vector<int32_t>(free_frames.get_allocator());
+    clock = 0.0f;
+    running = 0;
+    last = BrickScriptStats();
+}
+
+void BrickScripts::start(int brick, BrickScriptType type) {
+    stop(brick);
+    if (type == BrickScriptType::None || type >= BrickScriptType::Count || (size_t)brick >= frame_of.size()) return;
+
+    // A stopped frame can't be reused while the heap still holds it: it becomes free when popped.
+    // The lowest free index is reused first.
+    int index = (int)frames.size();
+    if (!free_frames.empty()) {
+        std::pop_heap(free_frames.begin(), free_frames.end(), std::greater<int32_t>());
+        index = free_frames.back();
+        free_frames.pop_back();
+    } else {
+        // Levels start all their scripts at once: one allocation for the lot
+        if (frames.capacity() == frames.size()) frames.reserve(std::max(frame_of.size(), frames.size() * 2));
+        frames.emplace_back();
+    }
+
+    BrickScriptFrame& f = frames[index];
+    f = BrickScriptFrame();
+    f.brick = brick;
+    f.type = (uint8_t)type;
+    f.wake = clock;
+    frame_of[brick] = index;
+    running++;
+    push(index);
+}
+
+void BrickScripts::stop(int brick) {
+    if ((size_t)brick >= frame_of.size() || frame_of[brick] < 0) return;
+    int frame = frame_of[brick];
+    frames[frame].point = BrickScriptFrame::finished;
+    frame_of[brick] = -1;
+    running--;
+    if (!(frames[frame].flags & BrickScriptFrame::Queued)) release_frame(frame);
+}
+
+void BrickScripts::wake_on_signal(int frame) {
+    BrickScriptFrame& f = frames[frame];
+    f.flags |= BrickScriptFrame::Signalled;
+    if (f.flags & BrickScriptFrame::Queued) return;   // in a timed wait: it sees the flag when it wakes
+    f.wake = clock;
+    push(frame);
+}
+
+void BrickScripts::push(int frame) {
+    frames[frame].flags |= BrickScriptFrame::Queued;
+    queue.push_back(frame);
+    std::push_heap(queue.begin(), queue.end(), [this](int a, int b) { return before(b, a); });
+}
+
+void BrickScripts::release_frame(int frame) {
+    free_frames.push_back(frame);
+    std::push_heap(free_frames.begin(), free_frames.end(), std::greater<int32_t>());
+}
+
+int BrickScripts::pop() {
+    std::pop_heap(queue.begin(), queue.end(), [this](int a, int b) { return before(b, a); });
+    int frame = queue.back();
+    queue.pop_back();
+    frames[frame].flags &= (uint8_t)~BrickScriptFrame::Queued;
+    return frame;
+}
+
+int BrickScripts::step(float dt, BrickScriptWorld& world) {
+    auto t0 = std::chrono::steady_clock::now();
+    clock += dt;
+    int resumed = 0;
+
+    while (!queue.empty() && frames[queue.front()].wake <= clock) {
+        int index = pop();
+        BrickScriptFrame& f = frames[index];
+        if (f.point == BrickScriptFrame::finished) {   // stopped while waiting
+            release_frame(index);
+            continue;
+        }
+
+        int brick = f.brick;
+        float delay = resume(f, world);
+        resumed++;
+        if (f.brick != brick) {
+            frame_of[brick] = -1;
+            frame_of[f.brick] = index;
+        }
+
+        if (delay == done) {
+            f.point = BrickScriptFrame::finished;
+            frame_of[f.brick] = -1;
+            running--;
+            release_frame(index);
+        } else if (delay >= 0.0f) {
+            // Even a zero wait lets the other due scripts run first: it resumes in the next step
+            f.wake = std::max(clock + delay, std::nextafter(clock, INFINITY));
+            push(index);
+        }
+        // park: off the queue until signal()
+    }
+
+    last.running = running;
+    last.queued = (int)queue.size();
+    last.resumed = resumed;
+    last.step_us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    return resumed;
+}
+
+void BrickScripts::rebuild_index(int cells) {
+    frame_of.assign((size_t)cells, -1);
+    free_frames.clear();
+    running = 0;
+    for (int i = 0; i < (int)frames.size(); ++i) {
+        const BrickScriptFrame& f = frames[i];
+        if (f.point == BrickScriptFrame::finished && !(f.flags & BrickScriptFrame::Queued)) release_frame(i);
+        if (f.point == BrickScriptFrame::finished || (size_t)f.brick >= frame_of.size()) continue;
+        frame_of[f.brick] = i;
+        running++;
+    }
+    last = BrickScriptStats();
+}
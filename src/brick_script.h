@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Scripted brick behaviours (blinking, regenerating, reinforcing, patrolling bricks) as stackless
+// coroutines. A script is a plain function resumed at the point it last waited: the resume point
+// and the few locals that must survive a wait live in a 16-byte frame, so thousands of scripts
+// cost one flat array and nothing is allocated per brick. The scripts a level starts with come
+// from its cells (LevelCell::script), so generators, level packs and the editor all carry them.
+//
+// Waiting scripts sit in a run queue ordered by wake time (a binary heap); a step pops only the
+// scripts that are due, so a level full of sleeping bricks costs nothing per frame. Scripts that
+// wait for their brick to be hit are not queued at all until signal() wakes them.
+//
+// Time is the simulation's (slow motion and pause apply), and no randomness is drawn, so scripted
+// levels replay exactly.
+
+enum class BrickScriptType : uint8_t { None, Blink, Regenerate, Reinforce, Patrol, Count };
+
+const char* brick_script_name(int type);
+
+// What scripts may do to the level; the game implements it over its bricks
+class BrickScriptWorld
+{
+public:
+    virtual ~BrickScriptWorld() = default;
+
+    virtual int columns() const = 0;
+    virtual int rows() const = 0;
+    virtual int hit_points(int brick) const = 0;                  // 0 = dead or empty cell
+    virtual void set_hit_points(int brick, int hp, bool full) = 0; // full: back to the undamaged look
+    virtual void set_hidden(int brick, bool hidden) = 0;          // intangible, drawn as a ghost
+    virtual bool spawn(int from, int to) = 0;                     // new 1 HP brick in a dead cell, looking like 'from'
+    virtual bool move(int from, int to) = 0;                      // live brick into a dead cell
+};
+
+// Coroutine frame of one running script
+struct BrickScriptFrame
+{
+    static constexpr uint16_t finished = 0xffff;
+
+    float wake = 0.0f;        // clock time of the timed wait
+    int32_t brick = -1;       // cell driven by the script (follows the brick when it moves)
+    uint16_t point = 0;       // resume point: 0 = start, else the label of the wait, 'finished' = done
+    uint8_t type = 0;         // BrickScriptType
+    uint8_t flags = 0;        // Queued, Signalled
+    uint8_t count = 0;        // loop counter
+    uint8_t arg = 0;          // per-script value (hit points to regenerate to)
+    uint16_t reserved = 0;
+
+    enum Flag : uint8_t { Queued = 1, Signalled = 2 };
+};
+
+static_assert(sizeof(BrickScriptFrame) == 16, "frames are saved with the game state as is");
+
+// Version of the saved resume points: bump when a script's wait labels change meaning, so older
+// snapshots are refused instead of resuming at the wrong wait
+static constexpr uint32_t brick_script_abi = 1;
+
+struct BrickScriptStats
+{
+    int running = 0;          // started and not finished
+    int queued = 0;           // in a timed wait
+    int resumed = 0;          // during the last step
+    float step_us = 0.0f;
+};
+
+class BrickScripts
+{
+public:
+    explicit BrickScripts(std::pmr::memory_resource* r = std::pmr::get_default_resource())
+        : frames(r), queue(r), frame_of(r), free_frames(r) {}
+
+    // Forget every script and size the tables for a layout of 'cells' (before the level's scripts start)
+    void reset(int cells);
+    // Drop the storage (before its memory resource is released)
+    void release();
+
+    // Start a script on a brick, replacing the one it runs; None just stops it
+    void start(int brick, BrickScriptType type);
+    void stop(int brick);             // also when the brick is destroyed
+
+    // The brick was hit: a script waiting for that runs in the next step
+    void signal(int brick) {
+        if ((size_t)brick >= frame_of.size() || frame_of[brick] < 0) return;
+        wake_on_signal(frame_of[brick]);
+    }
+
+    // Advance the clock by dt and resume every script whose wait has expired
+    int step(float dt, BrickScriptWorld& world);
+
+    bool empty() const { return running == 0; }
+    const BrickScriptStats& stats() const { return last; }
+
+    // Rebuild the brick -> frame index, free frames and counts after the tables were restored from a saved state
+    void rebuild_index(int cells);
+
+    // Saved with the game state
+    float clock = 0.0f;
+    std::pmr::vector<BrickScriptFrame> frames;
+    std::pmr::vector<int32_t> queue;     // frame indices, min-heap on (wake, index)
+
+private:
+    float resume(BrickScriptFrame& f, BrickScriptWorld& world);
+    void wake_on_signal(int frame);
+    void push(int frame);
+    int pop();
+    void release_frame(int frame);
+    bool before(int a, int b) const {
+        const BrickScriptFrame& fa = frames[a];
+        const BrickScriptFrame& fb = frames[b];
+        return fa.wake < fb.wake || (fa.wake == fb.wake && a < b);
+    }
+
+    std::pmr::vector<int32_t> frame_of;  // per cell, -1 = no script
+    std::pmr::vector<int32_t> free_frames;   // finished and off the queue, min-heap: start() reuses the lowest
+    int running = 0;
+    BrickScriptStats last;
+};
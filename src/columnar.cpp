@@ -0,0 +1,788 @@
+#include "columnar.h"
+#include "event_log.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// .arkcol layout (little-endian):
+//   "ARKC", version, column count, block rows, u64 total rows, block count
+//   per column: u8 name length + name, u16 label count + (i32 value, u8 length + text) per label
+//   per block: u32 rows, then per column a chunk:
+//     u8 encoding, u8 width, u16 dictionary size, i32 min, i32 max, u32 payload bytes, payload
+//   Payloads start 4-byte aligned (chunk headers are 16 bytes and payloads are padded).
+
+static const uint32_t columnar_version = 1;
+
+enum class ColumnEncoding : uint8_t { Plain, Constant, FrameOfReference, Dictionary, Delta };
+
+static const char* encoding_name(int e) {
+    static const char* names[] = { "plain", "const", "for", "dict", "delta" };
+    return e >= 0 && e < 5 ? names[e] : "?";
+}
+
+struct EventColumn
+{
+    const char* name;
+    int32_t (*get)(const GameEvent& e);
+    const char* (*label)(int value);   // enum columns
+    int label_count;
+};
+
+static const EventColumn event_columns[] = {
+    { "frame",      [](const GameEvent& e) { return (int32_t)e.frame; },      nullptr, 0 },
+    { "game",       [](const GameEvent& e) { return (int32_t)e.game; },       nullptr, 0 },
+    { "type",       [](const GameEvent& e) { return (int32_t)e.type; },       game_event_type_name, (int)GameEventType::Count },
+    { "bonus",      [](const GameEvent& e) { return (int32_t)e.bonus; },      game_event_bonus_name, 9 },
+    { "row",        [](const GameEvent& e) { return (int32_t)e.row; },        nullptr, 0 },
+    { "col",        [](const GameEvent& e) { return (int32_t)e.col; },        nullptr, 0 },
+    { "combo",      [](const GameEvent& e) { return (int32_t)e.combo; },      nullptr, 0 },
+    { "hit_points", [](const GameEvent& e) { return (int32_t)e.hit_points; }, nullptr, 0 },
+    { "score",      [](const GameEvent& e) { return e.score; },               nullptr, 0 },
+    { "value",      [](const GameEvent& e) { return e.value; },               nullptr, 0 },
+    { "money",      [](const GameEvent& e) { return e.money; },               nullptr, 0 },
+};
+static const int event_column_count = (int)(sizeof(event_columns) / sizeof(event_columns[0]));
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+
+
+// ----------------- Encoding -----------------
+
+struct ByteWriter
+{
+    std::vector<uint8_t> bytes;
+
+    void raw(const void* p, size_t n) { bytes.insert(bytes.end(), (const uint8_t*)p, (const uint8_t*)p + n); }
+    template <typename T> void put(T v) { raw(&v, sizeof(v)); }
+    void text(const char* s) { size_t n = std::min<size_t>(strlen(s), 255); put((uint8_t)n); raw(s, n); }
+    void align4() { while (bytes.size() % 4) bytes.push_back(0); }
+};
+
+static int width_for_range(int64_t range) { return range < 256 ? 1 : range < 65536 ? 2 : 0; }
+static int width_for_step(int64_t lo, int64_t hi) {
+    if (lo >= INT8_MIN && hi <= INT8_MAX) return 1;
+    if (lo >= INT16_MIN && hi <= INT16_MAX) return 2;
+    return 4;
+}
+
+// Picks the smallest encoding for one column of one block and appends the chunk
+static void encode_chunk(const int32_t* v, size_t n, ByteWriter& out, std::vector<int32_t>& scratch) {
+    int32_t lo = *std::min_element(v, v + n), hi = *std::max_element(v, v + n);
+
+    scratch.assign(v, v + n);
+    std::sort(scratch.begin(), scratch.end());
+    scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+    size_t distinct = scratch.size();
+
+    int64_t step_lo = 0, step_hi = 0;
+    for (size_t i = 1; i < n; ++i) {
+        int64_t d = (int64_t)v[i] - v[i - 1];
+        step_lo = std::min(step_lo, d);
+        step_hi = std::max(step_hi, d);
+    }
+
+    ColumnEncoding enc = ColumnEncoding::Plain;
+    size_t best = n * 4;
+    int width = 4;
+    auto consider = [&](ColumnEncoding e, size_t bytes, int w) {
+        if (bytes < best) { enc = e; best = bytes; width = w; }
+    };
+    if (lo == hi) consider(ColumnEncoding::Constant, 0, 0);
+    if (int w = width_for_range((int64_t)hi - lo)) consider(ColumnEncoding::FrameOfReference, n * w, w);
+    if (distinct <= 256) consider(ColumnEncoding::Dictionary, distinct * 4 + n, 1);
+    if (step_hi - step_lo <= UINT32_MAX) {
+        int w = width_for_step(step_lo, step_hi);
+        consider(ColumnEncoding::Delta, 4 + (n - 1) * w, w);
+    }
+
+    out.put((uint8_t)enc);
+    out.put((uint8_t)width);
+    out.put((uint16_t)(enc == ColumnEncoding::Dictionary ? distinct : 0));
+    out.put(lo);
+    out.put(hi);
+    size_t size_at = out.bytes.size();
+    out.put((uint32_t)0);
+    size_t start = out.bytes.size();
+
+    switch (enc) {
+    case ColumnEncoding::Constant: break;
+    case ColumnEncoding::Plain: out.raw(v, n * 4); break;
+    case ColumnEncoding::FrameOfReference:
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t d = (uint32_t)((int64_t)v[i] - lo);
+            if (width == 1) out.put((uint8_t)d); else out.put((uint16_t)d);
+        }
+        break;
+    case ColumnEncoding::Dictionary:
+        out.raw(scratch.data(), distinct * 4);
+        for (size_t i = 0; i < n; ++i)
+            out.put((uint8_t)(std::lower_bound(scratch.begin(), scratch.end(), v[i]) - scratch.begin()));
+        break;
+    case ColumnEncoding::Delta:
+        out.put(v[0]);
+        for (size_t i = 1; i < n; ++i) {
+            int32_t d = (int32_t)((int64_t)v[i] - v[i - 1]);
+            if (width == 1) out.put((int8_t)d); else if (width == 2) out.put((int16_t)d); else out.put(d);
+        }
+        break;
+    }
+    out.align4();
+    uint32_t payload = (uint32_t)(out.bytes.size() - start);
+    memcpy(out.bytes.data() + size_at, &payload, 4);
+}
+
+int run_events_convert_tool(int argc, char** argv) {
+    const char* in_path = nullptr;
+    const char* out_path = nullptr;
+    uint32_t block_rows = 65536;
+    bool usage = false;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--block-rows") == 0 && i + 1 < argc) block_rows = (uint32_t)atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !in_path) in_path = argv[i];
+        else if (argv[i][0] != '-' && !out_path) out_path = argv[i];
+        else usage = true;
+    }
+    if (usage || !out_path || block_rows == 0) {
+        fprintf(stderr, "usage: --events-convert <in.arkev> <out.arkcol> [--block-rows N]\n");
+        return 2;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<GameEvent> events;
+    if (!GameEventLog::load(in_path, events)) {
+        fprintf(stderr, "cannot read event log %s\n", in_path);
+        return 1;
+    }
+
+    uint32_t blocks = (uint32_t)((events.size() + block_rows - 1) / block_rows);
+    ByteWriter out;
+    out.raw("ARKC", 4);
+    out.put(columnar_version);
+    out.put((uint32_t)event_column_count);
+    out.put(block_rows);
+    out.put((uint64_t)events.size());
+    out.put(blocks);
+    for (const EventColumn& c : event_columns) {
+        out.text(c.name);
+        std::vector<int> values;
+        for (int v = 0; v < c.label_count; ++v) values.push_back(v);
+        if (c.label == game_event_bonus_name) values.push_back(GameEvent::no_bonus);
+        out.put((uint16_t)values.size());
+        for (int v : values) {
+            out.put((int32_t)v);
+            out.text(c.label(v));
+        }
+    }
+    out.align4();
+
+    std::vector<int32_t> column(block_rows), scratch;
+    size_t column_bytes[event_column_count] = {};
+    for (uint32_t b = 0; b < blocks; ++b) {
+        size_t first = (size_t)b * block_rows;
+        size_t n = std::min<size_t>(block_rows, events.size() - first);
+        out.put((uint32_t)n);
+        for (int c = 0; c < event_column_count; ++c) {
+            for (size_t i = 0; i < n; ++i) column[i] = event_columns[c].get(events[first + i]);
+            size_t before = out.bytes.size();
+            encode_chunk(column.data(), n, out, scratch);
+            column_bytes[c] += out.bytes.size() - before;
+        }
+    }
+
+    FILE* f = fopen(out_path, "wb");
+    bool ok = f && fwrite(out.bytes.data(), 1, out.bytes.size(), f) == out.bytes.size();
+    if (f) ok &= fclose(f) == 0;
+    if (!ok) {
+        fprintf(stderr, "cannot write %s\n", out_path);
+        return 1;
+    }
+
+    size_t raw = events.size() * sizeof(GameEvent);
+    printf("%zu events in %u blocks: %zu -> %zu bytes (%.1fx) in %.1f ms\n", events.size(), blocks, raw, out.bytes.size(),
+        out.bytes.size() ? (double)raw / out.bytes.size() : 0.0, elapsed_ms(t0));
+    for (int c = 0; c < event_column_count; ++c)
+        printf("  %-10s %10zu bytes\n", event_columns[c].name, column_bytes[c]);
+    return 0;
+}
+
+
+
+// ----------------- Reading -----------------
+
+struct ColumnChunk
+{
+    ColumnEncoding encoding;
+    int width;
+    uint32_t dict_size;
+    int32_t min, max;
+    const uint8_t* payload;
+    uint32_t bytes;
+};
+
+struct ColumnarFile
+{
+    struct Column {
+        std::string name;
+        std::vector<std::pair<int32_t, std::string>> labels;
+    };
+
+    std::vector<uint8_t> data;
+    uint32_t block_rows = 0;
+    uint64_t rows = 0;
+    std::vector<Column> columns;
+    std::vector<uint32_t> block_sizes;
+    std::vector<ColumnChunk> chunks;   // block * columns + column
+
+    const ColumnChunk& chunk(size_t block, int column) const { return chunks[block * columns.size() + column]; }
+    int find(const std::string& name) const {
+        for (size_t i = 0; i < columns.size(); ++i) if (columns[i].name == name) return (int)i;
+        return -1;
+    }
+
+    bool load(const char* path);
+};
+
+struct ByteReader
+{
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    template <typename T> T get() {
+        T v{};
+        if (end - p < (ptrdiff_t)sizeof(T)) { ok = false; return v; }
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+    std::string text() {
+        uint8_t n = get<uint8_t>();
+        if (end - p < n) { ok = false; return std::string(); }
+        std::string s((const char*)p, n);
+        p += n;
+        return s;
+    }
+    void align4(const uint8_t* base) { while ((p - base) % 4 && p < end) ++p; }
+};
+
+bool ColumnarFile::load(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data.resize(size > 0 ? (size_t)size : 0);
+    bool ok = size > 0 && fread(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    if (!ok) return false;
+
+    ByteReader r{ data.data(), data.data() + data.size() };
+    char magic[4] = {};
+    memcpy(magic, r.p, std::min<size_t>(4, data.size()));
+    r.p += 4;
+    if (memcmp(magic, "ARKC", 4) != 0 || r.get<uint32_t>() != columnar_version) return false;
+    uint32_t column_count = r.get<uint32_t>();
+    block_rows = r.get<uint32_t>();
+    rows = r.get<uint64_t>();
+    uint32_t blocks = r.get<uint32_t>();
+    for (uint32_t c = 0; c < column_count && r.ok; ++c) {
+        Column col;
+        col.name = r.text();
+        uint16_t labels = r.get<uint16_t>();
+        for (uint16_t l = 0; l < labels && r.ok; ++l) {
+            int32_t v = r.get<int32_t>();
+            col.labels.emplace_back(v, r.text());
+        }
+        columns.push_back(std::move(col));
+    }
+    r.align4(data.data());
+
+    for (uint32_t b = 0; b < blocks && r.ok; ++b) {
+        uint32_t n = r.get<uint32_t>();
+        block_sizes.push_back(n);
+        for (uint32_t c = 0; c < column_count && r.ok; ++c) {
+            ColumnChunk ch;
+            ch.encoding = (ColumnEncoding)r.get<uint8_t>();
+            ch.width = r.get<uint8_t>();
+            ch.dict_size = r.get<uint16_t>();
+            ch.min = r.get<int32_t>();
+            ch.max = r.get<int32_t>();
+            ch.bytes = r.get<uint32_t>();
+            ch.payload = r.p;
+            if ((size_t)(r.end - r.p) < ch.bytes || n > block_rows) r.ok = false;
+            else r.p += ch.bytes;
+            chunks.push_back(ch);
+        }
+    }
+    return r.ok && block_sizes.size() == blocks;
+}
+
+// Chunk -> int32 values. Payloads are 4-byte aligned, so the typed loads below are aligned
+// and every loop except the delta prefix sum vectorizes.
+static void decode_chunk(const ColumnChunk& ch, uint32_t n, int32_t* out) {
+    const int32_t base = ch.min;
+    switch (ch.encoding) {
+    case ColumnEncoding::Constant:
+        std::fill(out, out + n, base);
+        break;
+    case ColumnEncoding::Plain:
+        memcpy(out, ch.payload, (size_t)n * 4);
+        break;
+    case ColumnEncoding::FrameOfReference:
+        if (ch.width == 1) {
+            const uint8_t* p = ch.payload;
+            for (uint32_t i = 0; i < n; ++i) out[i] = base + p[i];
+        } else {
+            const uint16_t* p = (const uint16_t*)ch.payload;
+            for (uint32_t i = 0; i < n; ++i) out[i] = base + p[i];
+        }
+        break;
+    case ColumnEncoding::Dictionary: {
+        const int32_t* dict = (const int32_t*)ch.payload;
+        const uint8_t* codes = ch.payload + ch.dict_size * 4;
+        for (uint32_t i = 0; i < n; ++i) out[i] = dict[codes[i]];
+        break;
+    }
+    case ColumnEncoding::Delta: {
+        int32_t v;
+        memcpy(&v, ch.payload, 4);
+        out[0] = v;
+        const uint8_t* steps = ch.payload + 4;
+        if (ch.width == 1) for (uint32_t i = 1; i < n; ++i) out[i] = v += ((const int8_t*)steps)[i - 1];
+        else if (ch.width == 2) for (uint32_t i = 1; i < n; ++i) { int16_t d; memcpy(&d, steps + (i - 1) * 2, 2); out[i] = v += d; }
+        else for (uint32_t i = 1; i < n; ++i) { int32_t d; memcpy(&d, steps + (i - 1) * 4, 4); out[i] = v += d; }
+        break;
+    }
+    }
+}
+
+
+
+// ----------------- Query -----------------
+
+enum class FilterOp { In, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+struct Filter
+{
+    int column;
+    FilterOp op;
+    std::vector<int32_t> values;   // several only for In
+
+    // Zone map test: can any / every row of a chunk with this min/max pass?
+    bool may_match(int32_t lo, int32_t hi) const {
+        int32_t v = values[0];
+        switch (op) {
+        case FilterOp::In:
+            for (int32_t x : values) if (x >= lo && x <= hi) return true;
+            return false;
+        case FilterOp::NotEqual: return !(lo == v && hi == v);
+        case FilterOp::Less: return lo < v;
+        case FilterOp::LessEqual: return lo <= v;
+        case FilterOp::Greater: return hi > v;
+        case FilterOp::GreaterEqual: return hi >= v;
+        }
+        return true;
+    }
+    bool always_matches(int32_t lo, int32_t hi) const {
+        int32_t v = values[0];
+        switch (op) {
+        case FilterOp::In:
+            for (int32_t x : values) if (lo == x && hi == x) return true;
+            return false;
+        case FilterOp::NotEqual: return v < lo || v > hi;
+        case FilterOp::Less: return hi < v;
+        case FilterOp::LessEqual: return hi <= v;
+        case FilterOp::Greater: return lo > v;
+        case FilterOp::GreaterEqual: return lo >= v;
+        }
+        return false;
+    }
+
+    // sel[i] &= row passes; branch-free so each loop vectorizes
+    void apply(const int32_t* col, uint32_t n, uint8_t* sel) const {
+        int32_t v = values[0];
+        switch (op) {
+        case FilterOp::In:
+            if (values.size() == 1) { for (uint32_t i = 0; i < n; ++i) sel[i] &= col[i] == v; break; }
+            for (uint32_t i = 0; i < n; ++i) {
+                uint8_t any = 0;
+                for (int32_t x : values) any |= col[i] == x;
+                sel[i] &= any;
+            }
+            break;
+        case FilterOp::NotEqual:     for (uint32_t i = 0; i < n; ++i) sel[i] &= col[i] != v; break;
+        case FilterOp::Less:         for (uint32_t i = 0; i < n; ++i) sel[i] &= col[i] < v; break;
+        case FilterOp::LessEqual:    for (uint32_t i = 0; i < n; ++i) sel[i] &= col[i] <= v; break;
+        case FilterOp::Greater:      for (uint32_t i = 0; i < n; ++i) sel[i] &= col[i] > v; break;
+        case FilterOp::GreaterEqual: for (uint32_t i = 0; i < n; ++i) sel[i] &= col[i] >= v; break;
+        }
+    }
+};
+
+enum class AggKind { Count, Sum, Avg, Min, Max, CountIf, Ratio };
+
+struct Aggregate
+{
+    AggKind kind;
+    int column = -1;
+    int32_t a = 0, b = 0;   // CountIf: a; Ratio: a per b
+    std::string title;
+};
+
+struct GroupKey
+{
+    int32_t v[4] = {};
+    bool operator==(const GroupKey& o) const { return memcmp(v, o.v, sizeof(v)) == 0; }
+};
+
+struct GroupKeyHash
+{
+    size_t operator()(const GroupKey& k) const {
+        uint64_t h = 1469598103934665603ull;
+        for (int32_t x : k.v) h = (h ^ (uint32_t)x) * 1099511628211ull;
+        return (size_t)h;
+    }
+};
+
+// Per group: a row count plus two accumulators per aggregate
+struct GroupTable
+{
+    int aggs = 0;
+    std::vector<GroupKey> keys;
+    std::vector<int64_t> counts;
+    std::vector<int64_t> acc;   // group * aggs * 2
+    std::unordered_map<GroupKey, int, GroupKeyHash> index;
+
+    int find(const GroupKey& k, const std::vector<Aggregate>& spec) {
+        auto it = index.find(k);
+        if (it != index.end()) return it->second;
+        int g = (int)keys.size();
+        index.emplace(k, g);
+        keys.push_back(k);
+        counts.push_back(0);
+        for (const Aggregate& a : spec) {
+            acc.push_back(a.kind == AggKind::Min ? INT64_MAX : a.kind == AggKind::Max ? INT64_MIN : 0);
+            acc.push_back(0);
+        }
+        return g;
+    }
+};
+
+static void accumulate(AggKind kind, int64_t* acc, int32_t v, const Aggregate& a) {
+    switch (kind) {
+    case AggKind::Count: break;
+    case AggKind::Sum: case AggKind::Avg: acc[0] += v; break;
+    case AggKind::Min: acc[0] = std::min<int64_t>(acc[0], v); break;
+    case AggKind::Max: acc[0] = std::max<int64_t>(acc[0], v); break;
+    case AggKind::CountIf: acc[0] += v == a.a; break;
+    case AggKind::Ratio: acc[0] += v == a.a; acc[1] += v == a.b; break;
+    }
+}
+
+static void merge(AggKind kind, int64_t* into, const int64_t* from) {
+    switch (kind) {
+    case AggKind::Min: into[0] = std::min(into[0], from[0]); break;
+    case AggKind::Max: into[0] = std::max(into[0], from[0]); break;
+    default: into[0] += from[0]; into[1] += from[1]; break;
+    }
+}
+
+static bool parse_value(const ColumnarFile::Column& col, const std::string& text, int32_t& out) {
+    for (const auto& l : col.labels) if (l.second == text) { out = l.first; return true; }
+    char* end = nullptr;
+    long v = strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end) return false;
+    out = (int32_t)v;
+    return true;
+}
+
+static std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    for (size_t i = 0; i <= s.size(); ++i) {
+        if (i == s.size() || s[i] == sep) { out.push_back(s.substr(start, i - start)); start = i + 1; }
+    }
+    return out;
+}
+
+static bool parse_filter(const ColumnarFile& file, const std::string& expr, Filter& f) {
+    static const struct { const char* text; FilterOp op; } ops[] = {
+        { "!=", FilterOp::NotEqual }, { "<=", FilterOp::LessEqual }, { ">=", FilterOp::GreaterEqual },
+        { "=", FilterOp::In }, { "<", FilterOp::Less }, { ">", FilterOp::Greater },
+    };
+    for (const auto& o : ops) {
+        size_t at = expr.find(o.text);
+        if (at == std::string::npos) continue;
+        f.column = file.find(expr.substr(0, at));
+        f.op = o.op;
+        if (f.column < 0) return false;
+        std::string rest = expr.substr(at + strlen(o.text));
+        for (const std::string& v : o.op == FilterOp::In ? split(rest, ',') : std::vector<std::string>{ rest }) {
+            f.values.emplace_back();
+            if (!parse_value(file.columns[f.column], v, f.values.back())) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool parse_aggregate(const ColumnarFile& file, const std::string& text, Aggregate& a) {
+    a.title = text;
+    if (text == "count") { a.kind = AggKind::Count; return true; }
+    size_t colon = text.find(':');
+    if (colon == std::string::npos) return false;
+    std::string fn = text.substr(0, colon), arg = text.substr(colon + 1);
+
+    if (fn == "count" || fn == "ratio") {
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos || (a.column = file.find(arg.substr(0, eq))) < 0) return false;
+        const ColumnarFile::Column& col = file.columns[a.column];
+        std::vector<std::string> values = split(arg.substr(eq + 1), '/');
+        a.kind = fn == "count" ? AggKind::CountIf : AggKind::Ratio;
+        if (values.size() != (a.kind == AggKind::Ratio ? 2u : 1u)) return false;
+        return parse_value(col, values[0], a.a) && (a.kind != AggKind::Ratio || parse_value(col, values[1], a.b));
+    }
+    if (fn == "sum") a.kind = AggKind::Sum;
+    else if (fn == "avg") a.kind = AggKind::Avg;
+    else if (fn == "min") a.kind = AggKind::Min;
+    else if (fn == "max") a.kind = AggKind::Max;
+    else return false;
+    a.column = file.find(arg);
+    return a.column >= 0;
+}
+
+static void describe(const ColumnarFile& file) {
+    printf("%llu rows in %zu blocks of %u\n", (unsigned long long)file.rows, file.block_sizes.size(), file.block_rows);
+    printf("%-10s %12s %7s  %s\n", "column", "bytes", "ratio", "encodings (blocks)");
+    for (size_t c = 0; c < file.columns.size(); ++c) {
+        size_t bytes = 0;
+        int used[5] = {};
+        for (size_t b = 0; b < file.block_sizes.size(); ++b) {
+            const ColumnChunk& ch = file.chunk(b, (int)c);
+            bytes += 16 + ch.bytes;
+            if ((int)ch.encoding < 5) used[(int)ch.encoding]++;
+        }
+        std::string encodings;
+        for (int e = 0; e < 5; ++e)
+            if (used[e]) encodings += std::string(encodings.empty() ? "" : ", ") + encoding_name(e) + " " + std::to_string(used[e]);
+        printf("%-10s %12zu %6.1fx  %s\n", file.columns[c].name.c_str(), bytes,
+            bytes ? (double)file.rows * 4 / bytes : 0.0, encodings.c_str());
+    }
+}
+
+static std::string format_key_value(const ColumnarFile::Column& col, int32_t v) {
+    for (const auto& l : col.labels) if (l.first == v) return l.second;
+    return std::to_string(v);
+}
+
+int run_events_query_tool(int argc, char** argv) {
+    const char* path = nullptr;
+    std::vector<std::string> wheres, group_names, agg_names;
+    std::string sort_by;
+    long limit = -1;
+    bool show_description = false, usage = false;
+    for (int i = 0; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--where") == 0 && has_value) wheres.push_back(argv[++i]);
+        else if (strcmp(argv[i], "--group-by") == 0 && has_value) group_names = split(argv[++i], ',');
+        else if (strcmp(argv[i], "--agg") == 0 && has_value) agg_names = split(argv[++i], ',');
+        else if (strcmp(argv[i], "--sort") == 0 && has_value) sort_by = argv[++i];
+        else if (strcmp(argv[i], "--limit") == 0 && has_value) limit = atol(argv[++i]);
+        else if (strcmp(argv[i], "--describe") == 0) show_description = true;
+        else if (argv[i][0] != '-' && !path) path = argv[i];
+        else usage = true;
+    }
+    if (usage || !path) {
+        fprintf(stderr, "usage: --events-query <file.arkcol> [--where EXPR]... [--group-by c1,c2] [--agg A1,A2] [--sort AGG] [--limit N] [--describe]\n");
+        return 2;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    ColumnarFile file;
+    if (!file.load(path)) {
+        fprintf(stderr, "cannot read columnar file %s\n", path);
+        return 1;
+    }
+    if (show_description) { describe(file); return 0; }
+
+    std::vector<Filter> filters(wheres.size());
+    for (size_t i = 0; i < wheres.size(); ++i) {
+        if (!parse_filter(file, wheres[i], filters[i])) { fprintf(stderr, "bad filter '%s'\n", wheres[i].c_str()); return 2; }
+    }
+    std::vector<int> groups;
+    for (const std::string& name : group_names) {
+        groups.push_back(file.find(name));
+        if (groups.back() < 0) { fprintf(stderr, "no column '%s'\n", name.c_str()); return 2; }
+    }
+    if (groups.size() > 4) { fprintf(stderr, "at most 4 group-by columns\n"); return 2; }
+    if (agg_names.empty()) agg_names.push_back("count");
+    std::vector<Aggregate> aggs(agg_names.size());
+    for (size_t i = 0; i < agg_names.size(); ++i) {
+        if (!parse_aggregate(file, agg_names[i], aggs[i])) { fprintf(stderr, "bad aggregate '%s'\n", agg_names[i].c_str()); return 2; }
+    }
+    int sort_agg = -1;
+    for (size_t i = 0; i < aggs.size(); ++i) if (aggs[i].title == sort_by) sort_agg = (int)i;
+    if (!sort_by.empty() && sort_agg < 0) { fprintf(stderr, "--sort must name one of the aggregates\n"); return 2; }
+
+    const int A = (int)aggs.size();
+    GroupTable table;
+    table.aggs = A;
+
+    // Decoded columns of the current block, each decoded at most once
+    std::vector<std::vector<int32_t>> decoded(file.columns.size());
+    std::vector<int> decoded_block(file.columns.size(), -1);
+    std::vector<uint8_t> sel(file.block_rows);
+    std::vector<uint32_t> rows_idx(file.block_rows), cells(file.block_rows);
+    std::vector<int64_t> dense_counts, dense_acc;
+    uint64_t scanned = 0, matched = 0;
+    size_t skipped_blocks = 0;
+
+    for (size_t b = 0; b < file.block_sizes.size(); ++b) {
+        const uint32_t n = file.block_sizes[b];
+        auto column = [&](int c) -> const int32_t* {
+            if (decoded_block[c] != (int)b) {
+                decoded[c].resize(file.block_rows);
+                decode_chunk(file.chunk(b, c), n, decoded[c].data());
+                decoded_block[c] = (int)b;
+            }
+            return decoded[c].data();
+        };
+
+        // Zone maps: skip the block, or drop filters every row passes
+        bool skip = false;
+        std::vector<const Filter*> active;
+        for (const Filter& f : filters) {
+            const ColumnChunk& ch = file.chunk(b, f.column);
+            if (!f.may_match(ch.min, ch.max)) { skip = true; break; }
+            if (!f.always_matches(ch.min, ch.max)) active.push_back(&f);
+        }
+        if (skip) { skipped_blocks++; continue; }
+        scanned += n;
+
+        std::fill(sel.begin(), sel.begin() + n, 1);
+        for (const Filter* f : active) f->apply(column(f->column), n, sel.data());
+
+        uint32_t selected = 0;
+        for (uint32_t i = 0; i < n; ++i) { rows_idx[selected] = i; selected += sel[i]; }
+        if (selected == 0) continue;
+        matched += selected;
+
+        // Dense grouping when the block's group key space is small: cell = mixed-radix key
+        int64_t space = 1;
+        for (int g : groups) space = std::min<int64_t>(space * ((int64_t)file.chunk(b, g).max - file.chunk(b, g).min + 1), INT32_MAX);
+        if (space <= 65536) {
+            std::fill(cells.begin(), cells.begin() + n, 0);
+            int64_t stride = 1;
+            for (int g : groups) {
+                const int32_t* v = column(g);
+                int32_t lo = file.chunk(b, g).min;
+                uint32_t s = (uint32_t)stride;
+                for (uint32_t i = 0; i < n; ++i) cells[i] += (uint32_t)(v[i] - lo) * s;
+                stride *= (int64_t)file.chunk(b, g).max - lo + 1;
+            }
+
+            dense_counts.assign((size_t)space, 0);
+            dense_acc.assign((size_t)space * A * 2, 0);
+            for (int a = 0; a < A; ++a) {
+                int64_t init = aggs[a].kind == AggKind::Min ? INT64_MAX : aggs[a].kind == AggKind::Max ? INT64_MIN : 0;
+                for (int64_t c = 0; c < space; ++c) dense_acc[(c * A + a) * 2] = init;
+            }
+            for (uint32_t k = 0; k < selected; ++k) dense_counts[cells[rows_idx[k]]]++;
+            for (int a = 0; a < A; ++a) {
+                if (aggs[a].kind == AggKind::Count) continue;
+                const int32_t* v = column(aggs[a].column);
+                if (space == 1 && (aggs[a].kind == AggKind::Sum || aggs[a].kind == AggKind::Avg)) {
+                    int64_t sum = 0;
+                    for (uint32_t i = 0; i < n; ++i) sum += sel[i] * (int64_t)v[i];
+                    dense_acc[a * 2] = sum;
+                    continue;
+                }
+                for (uint32_t k = 0; k < selected; ++k) {
+                    uint32_t i = rows_idx[k];
+                    accumulate(aggs[a].kind, &dense_acc[((size_t)cells[i] * A + a) * 2], v[i], aggs[a]);
+                }
+            }
+
+            for (int64_t c = 0; c < space; ++c) {
+                if (!dense_counts[c]) continue;
+                GroupKey key;
+                int64_t rest = c;
+                for (size_t g = 0; g < groups.size(); ++g) {
+                    const ColumnChunk& ch = file.chunk(b, groups[g]);
+                    int64_t range = (int64_t)ch.max - ch.min + 1;
+                    key.v[g] = (int32_t)(ch.min + rest % range);
+                    rest /= range;
+                }
+                int gi = table.find(key, aggs);
+                table.counts[gi] += dense_counts[c];
+                for (int a = 0; a < A; ++a) merge(aggs[a].kind, &table.acc[((size_t)gi * A + a) * 2], &dense_acc[((size_t)c * A + a) * 2]);
+            }
+            continue;
+        }
+
+        // Wide keys: hash every selected row
+        std::vector<const int32_t*> group_cols, agg_cols;
+        for (int g : groups) group_cols.push_back(column(g));
+        for (const Aggregate& a : aggs) agg_cols.push_back(a.column >= 0 ? column(a.column) : nullptr);
+        for (uint32_t k = 0; k < selected; ++k) {
+            uint32_t i = rows_idx[k];
+            GroupKey key;
+            for (size_t g = 0; g < groups.size(); ++g) key.v[g] = group_cols[g][i];
+            int gi = table.find(key, aggs);
+            table.counts[gi]++;
+            for (int a = 0; a < A; ++a)
+                if (agg_cols[a]) accumulate(aggs[a].kind, &table.acc[((size_t)gi * A + a) * 2], agg_cols[a][i], aggs[a]);
+        }
+    }
+
+    auto value_of = [&](int g, int a) -> double {
+        const int64_t* acc = &table.acc[((size_t)g * A + a) * 2];
+        switch (aggs[a].kind) {
+        case AggKind::Count: return (double)table.counts[g];
+        case AggKind::Avg: return (double)acc[0] / table.counts[g];
+        case AggKind::Ratio: return acc[1] ? (double)acc[0] / acc[1] : 0.0;
+        default: return (double)acc[0];
+        }
+    };
+
+    std::vector<int> order(table.keys.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = (int)i;
+    std::sort(order.begin(), order.end(), [&](int x, int y) {
+        if (sort_agg >= 0) {
+            double vx = value_of(x, sort_agg), vy = value_of(y, sort_agg);
+            if (vx != vy) return vx > vy;
+        }
+        return std::lexicographical_compare(table.keys[x].v, table.keys[x].v + 4, table.keys[y].v, table.keys[y].v + 4);
+    });
+    if (limit >= 0 && (size_t)limit < order.size()) order.resize((size_t)limit);
+
+    std::vector<int> widths;
+    for (const Aggregate& a : aggs) widths.push_back(std::max(16, (int)a.title.size() + 2));
+    for (int g : groups) printf("%-16s", file.columns[g].name.c_str());
+    for (int a = 0; a < A; ++a) printf("%*s", widths[a], aggs[a].title.c_str());
+    printf("\n");
+    for (int g : order) {
+        for (size_t k = 0; k < groups.size(); ++k)
+            printf("%-16s", format_key_value(file.columns[groups[k]], table.keys[g].v[k]).c_str());
+        for (int a = 0; a < A; ++a) {
+            AggKind kind = aggs[a].kind;
+            if (kind == AggKind::Avg || kind == AggKind::Ratio) printf("%*.3f", widths[a], value_of(g, a));
+            else printf("%*lld", widths[a], (long long)value_of(g, a));
+        }
+        printf("\n");
+    }
+    printf("%zu groups; %llu of %llu rows matched, %llu scanned, %zu of %zu blocks skipped in %.1f ms\n", order.size(),
+        (unsigned long long)matched, (unsigned long long)file.rows, (unsigned long long)scanned, skipped_blocks,
+        file.block_sizes.size(), elapsed_ms(t0));
+    return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// Columnar storage of the gameplay event log (event_log.h) for offline analysis.
+//
+// --events-convert <in.arkev> <out.arkcol> [--block-rows N]
+// Splits the log into blocks of N rows (default 65536) and stores every field as its own int32
+// column. Each column chunk picks the smallest of: constant, frame-of-reference (u8/u16 offsets
+// from the block minimum), dictionary (<= 256 distinct values, u8 codes), delta (u8/u16/i32
+// steps) and plain, and records its min/max. Enum columns (type, bonus) carry their labels.
+//
+// --events-query <file.arkcol> [--where EXPR]... [--group-by c1,c2,...] [--agg A1,A2,...]
+//                [--sort AGG] [--limit N] [--describe]
+// EXPR is col=v[,v...], col!=v, col<v, col<=v, col>v or col>=v; values of enum columns may be
+// labels. Aggregates: count, sum:col, avg:col, min:col, max:col, count:col=v (rows matching) and
+// ratio:col=a/b (rows matching a per row matching b). Blocks whose min/max rule out a filter are
+// skipped without decoding; the rest are decoded a column at a time and filtered with branch-free
+// loops. Output is sorted by group key, or descending by --sort.
+//
+//   --events-query s.arkcol --where type=brick_destroy --group-by row --agg sum:money --sort sum:money
+//   --events-query s.arkcol --where type=combo_end --group-by combo --agg count
+//   --events-query s.arkcol --group-by bonus --agg ratio:type=bonus_pickup/bonus_spawn --where bonus!=-
+int run_events_convert_tool(int argc, char** argv);
+int run_events_query_tool(int argc, char** argv);
@@ -0,0 +1,237 @@
+#include "crash_handler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#define ARKANOID_CRASH_HANDLER 1
+#if defined(__has_include)
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define ARKANOID_BACKTRACE 1
+#endif
+#endif
+#endif
+
+static_assert(sizeof(ReplayFrame) == 8, "ring entries are written to the replay file as is");
+
+// ----------------- Snapshots -----------------
+
+void CrashRecorder::take_snapshot(const ArkanoidImpl& game, const ArkanoidSettings& settings, Vect display_size) {
+    int next = published.load(std::memory_order_relaxed) == 0 ? 1 : 0;
+    Snapshot& s = snapshots[next];
+
+    game.save_state(state_scratch);
+    replay_scratch.settings = settings;
+    replay_scratch.display_size = display_size;
+    replay_scratch.initial_state.swap(state_scratch);
+    encode_replay_prefix(replay_scratch, s.prefix);
+    replay_scratch.initial_state.swap(state_scratch);
+
+    s.first_frame = frame_count;
+    s.settings = settings;
+    published.store(next, std::memory_order_release);
+    since_snapshot = 0.0f;
+}
+
+
+
+#if ARKANOID_CRASH_HANDLER
+
+// ----------------- Signal-safe output -----------------
+
+struct SafeWriter
+{
+    int fd;
+    char buf[1024];
+    size_t len = 0;
+
+    explicit SafeWriter(int fd) : fd(fd) {}
+    ~SafeWriter() { flush(); }
+
+    void flush() {
+        size_t off = 0;
+        while (off < len) {
+            ssize_t n = ::write(fd, buf + off, len - off);
+            if (n <= 0) break;
+            off += (size_t)n;
+        }
+        len = 0;
+    }
+    void raw(const void* data, size_t n) {
+        flush();
+        const char* p = (const char*)data;
+        while (n > 0) {
+            ssize_t w = ::write(fd, p, n);
+            if (w <= 0) break;
+            p += w;
+            n -= (size_t)w;
+        }
+    }
+    SafeWriter& str(const char* s) {
+        while (*s) {
+            if (len == sizeof(buf)) flush();
+            buf[len++] = *s++;
+        }
+        return *this;
+    }
+    SafeWriter& num(int64_t v) {
+        char tmp[24];
+        int i = 0;
+        uint64_t u = v < 0 ? (uint64_t)(-(v + 1)) + 1 : (uint64_t)v;
+        do { tmp[i++] = (char)('0' + u % 10); u /= 10; } while (u);
+        if (v < 0) tmp[i++] = '-';
+        char out[24];
+        for (int k = 0; k < i; ++k) out[k] = tmp[i - 1 - k];
+        out[i] = 0;
+        return str(out);
+    }
+    SafeWriter& hex(uint64_t v) {
+        char out[19] = "0x";
+        for (int k = 0; k < 16; ++k) out[2 + k] = "0123456789abcdef"[(v >> (60 - 4 * k)) & 15];
+        out[18] = 0;
+        return str(out);
+    }
+    // Fixed point with 3 decimals, enough for settings
+    SafeWriter& fixed(float v) {
+        int64_t m = (int64_t)(v * 1000.0f + (v < 0 ? -0.5f : 0.5f));
+        if (m < 0) { str("-"); m = -m; }
+        num(m / 1000).str(".");
+        int64_t frac = m % 1000;
+        if (frac < 100) str("0");
+        if (frac < 10) str("0");
+        return num(frac);
+    }
+};
+
+static const char* signal_name(int sig) {
+    switch (sig) {
+    case SIGSEGV: return "SIGSEGV";
+    case SIGABRT: return "SIGABRT";
+    case SIGFPE: return "SIGFPE";
+    default: return "signal";
+    }
+}
+
+
+
+// ----------------- Dump -----------------
+
+void CrashRecorder::write_dump(int sig, const void* fault_address) {
+    int idx = published.load(std::memory_order_acquire);
+    uint64_t end = frame_count;
+
+    // Replay: prebuilt prefix, frame count, then the ring entries since the snapshot
+    uint64_t replay_frames = 0;
+    if (idx >= 0) {
+        const Snapshot& s = snapshots[idx];
+        replay_frames = end - s.first_frame;
+        int fd = open(replay_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            SafeWriter w(fd);
+            w.raw(s.prefix.data(), s.prefix.size());
+            uint32_t count = (uint32_t)replay_frames;
+            w.raw(&count, sizeof(count));
+            for (uint64_t f = s.first_frame; f < end;) {
+                size_t at = (size_t)(f % ring_frames);
+                size_t n = (size_t)std::min<uint64_t>(end - f, ring_frames - at);
+                w.raw(&ring[at], n * sizeof(ReplayFrame));
+                f += n;
+            }
+            close(fd);
+        }
+    }
+
+    int fd = open(report_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        SafeWriter w(fd);
+        w.str("Arkanoid crash report\n");
+        w.str("signal: ").str(signal_name(sig)).str(" (").num(sig).str(")\n");
+        if (sig != SIGABRT) w.str("fault address: ").hex((uint64_t)(uintptr_t)fault_address).str("\n");
+        w.str("frames played: ").num((int64_t)end).str("\n");
+        if (idx >= 0) {
+            const ArkanoidSettings& st = snapshots[idx].settings;
+            w.str("replay: ").str(replay_path).str(" (").num((int64_t)replay_frames).str(" frames from the last snapshot)\n");
+            w.str("reproduce: Arkanoid --replay-verify --run ").str(replay_path).str("\n");
+            w.str("seed: ").num(st.seed).str("\n");
+            w.str("settings: generator ").num(st.level_generator)
+                .str(", bricks ").num(st.bricks_columns_count).str("x").num(st.bricks_rows_count)
+                .str(", density ").fixed(st.level_density).str(", difficulty ").fixed(st.level_difficulty)
+                .str(", ball radius ").fixed(st.ball_radius).str(", ball speed ").fixed(st.ball_speed)
+                .str(", carriage width ").fixed(st.carriage_width)
+                .str(", world ").fixed(st.world_size.x).str("x").fixed(st.world_size.y).str("\n");
+        }
+        else {
+            w.str("replay: none (crashed before the first snapshot)\n");
+        }
+#if ARKANOID_BACKTRACE
+        w.str("backtrace:\n");
+        w.flush();
+        void* frames[64];
+        int n = backtrace(frames, 64);
+        backtrace_symbols_fd(frames, n, fd);
+#endif
+        w.flush();
+        close(fd);
+    }
+
+    SafeWriter err(2);
+    err.str("Crash dump written to ").str(report_path).str("\n");
+}
+
+
+
+// ----------------- Signal handlers -----------------
+
+static CrashRecorder* g_recorder = nullptr;
+static volatile sig_atomic_t g_in_handler = 0;
+static char g_alt_stack[64 * 1024];   // so stack overflows can still be reported
+
+static void crash_signal_handler(int sig, siginfo_t* info, void*) {
+    if (g_in_handler) _exit(128 + sig);   // crashed while dumping
+    g_in_handler = 1;
+    if (g_recorder) g_recorder->write_dump(sig, info ? info->si_addr : nullptr);
+    raise(sig);   // handler was reset to the default action: terminate / core dump as usual
+}
+
+bool CrashRecorder::install(const char* dump_dir) {
+    if (g_recorder) return g_recorder == this;
+
+    snprintf(replay_path, sizeof(replay_path), "%s/crash-%d.arkrep", dump_dir, (int)getpid());
+    snprintf(report_path, sizeof(report_path), "%s/crash-%d.txt", dump_dir, (int)getpid());
+    ring.resize(ring_frames);
+    snapshots[0].prefix.reserve(64 * 1024);
+    snapshots[1].prefix.reserve(64 * 1024);
+
+#if ARKANOID_BACKTRACE
+    // The first backtrace() call may load libgcc; do it now rather than inside the handler
+    void* frames[4];
+    backtrace(frames, 4);
+#endif
+
+    stack_t ss = {};
+    ss.ss_sp = g_alt_stack;
+    ss.ss_size = sizeof(g_alt_stack);
+    sigaltstack(&ss, nullptr);
+
+    struct sigaction sa = {};
+    sa.sa_sigaction = crash_signal_handler;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    for (int sig : { SIGSEGV, SIGABRT, SIGFPE })
+        if (sigaction(sig, &sa, nullptr) != 0) return false;
+
+    g_recorder = this;
+    installed = true;
+    return true;
+}
+
+#else
+
+void CrashRecorder::write_dump(int, const void*) {}
+bool CrashRecorder::install(const char*) { return false; }
+
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "arkanoid_impl.h"
+#include "replay.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Black box recorder for crashes. The game thread logs each frame's input into a ring and
+// snapshots the full state every few seconds; on SIGSEGV / SIGABRT / SIGFPE the handler writes
+//   <dir>/crash-<pid>.arkrep   replay starting at the last snapshot (--replay-verify --run reproduces it)
+//   <dir>/crash-<pid>.txt      signal, seed, settings and a backtrace
+// The handler only uses buffers prepared on the game thread and async-signal-safe calls. POSIX only.
+class CrashRecorder
+{
+public:
+    static constexpr size_t ring_frames = 16384;   // input history, ~4.5 minutes at 60 FPS
+
+    float snapshot_interval = 5.0f;                // seconds between state snapshots
+
+    // Installs the signal handlers; one recorder per process
+    bool install(const char* dump_dir);
+
+    // Game thread, once per frame before update()
+    void record_frame(const ArkanoidImpl& game, const ArkanoidSettings& settings, Vect display_size, float dt, uint32_t keys) {
+        if (!installed) return;
+        if (published.load(std::memory_order_relaxed) < 0 || since_snapshot >= snapshot_interval ||
+            frame_count - first_frame() >= ring_frames / 2)
+            take_snapshot(game, settings, display_size);
+        ring[frame_count % ring_frames] = { dt, keys };
+        frame_count++;
+        since_snapshot += dt;
+    }
+
+    // Signal handler side: writes both dump files
+    void write_dump(int sig, const void* fault_address);
+
+private:
+    void take_snapshot(const ArkanoidImpl& game, const ArkanoidSettings& settings, Vect display_size);
+    uint64_t first_frame() const { int i = published.load(std::memory_order_relaxed); return i >= 0 ? snapshots[i].first_frame : 0; }
+
+    // Replay bytes up to the frame count plus what the text report needs; double buffered so a
+    // crash while a snapshot is being taken still finds a complete one
+    struct Snapshot {
+        std::vector<uint8_t> prefix;
+        uint64_t first_frame = 0;
+        ArkanoidSettings settings;
+    };
+
+    bool installed = false;
+    std::vector<ReplayFrame> ring;
+    uint64_t frame_count = 0;
+    float since_snapshot = 0.0f;
+    Snapshot snapshots[2];
+    std::atomic<int> published{ -1 };
+    std::vector<uint8_t> state_scratch;
+    Replay replay_scratch;
+
+    char replay_path[512] = {};
+    char report_path[512] = {};
+};
@@ -0,0 +1,207 @@
+#include "debris.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+void DebrisSystem::clear() {
+    for (auto* v : { &x, &y, &vx, &vy, &life, &radius, &awake }) v->clear();
+    color.clear();
+    rest_cell.clear();
+    rest_frames.clear();
+    cursor = 0;
+    last = DebrisStats();
+}
+
+void DebrisSystem::spawn(const Vect& pos, const Vect& vel, float piece_life, float piece_radius, ImU32 col) {
+    if ((int)x.size() >= max_count) return;
+    x.push_back(pos.x);
+    y.push_back(pos.y);
+    vx.push_back(vel.x);
+    vy.push_back(vel.y);
+    life.push_back(piece_life);
+    radius.push_back(piece_radius);
+    awake.push_back(1.0f);
+    color.push_back(col);
+    rest_cell.push_back(-1);
+    rest_frames.push_back(0);
+}
+
+void DebrisSystem::update(float dt, const DebrisWorld& world) {
+    const size_t n = x.size();
+    last.collided = last.deferred = 0;
+    last.collide_us = 0.0f;
+    if (n == 0) {
+        last.active = last.sleeping = 0;
+        return;
+    }
+
+    float* __restrict px = x.data();
+    float* __restrict py = y.data();
+    float* __restrict pvx = vx.data();
+    float* __restrict pvy = vy.data();
+    float* __restrict plife = life.data();
+    float* __restrict pawake = awake.data();
+    const float* __restrict prad = radius.data();
+
+    // Wake pieces whose brick is gone
+    const uint8_t* cell_alive = world.grid ? world.grid->cell_alive.data() : nullptr;
+    const int32_t cells = world.grid ? (int32_t)world.grid->cell_alive.size() : 0;
+    for (size_t i = 0; i < n; ++i) {
+        int32_t c = rest_cell[i];
+        if (c >= 0 && (c >= cells || !cell_alive[c])) { rest_cell[i] = -1; rest_frames[i] = 0; pawake[i] = 1.0f; }
+    }
+
+    // Integrate. Sleeping pieces have zero velocity and no gravity, so they stay put.
+    // Velocities decaying against a contact are snapped to zero before they turn denormal,
+    // which would make every pass over them several times slower.
+    const float g = gravity * dt, keep = std::max(0.0f, 1.0f - damping * dt);
+    for (size_t i = 0; i < n; ++i) {
+        pvy[i] += g * pawake[i];
+        pvx[i] = std::fabs(pvx[i]) < 1e-3f ? 0.0f : pvx[i] * keep;
+        pvy[i] = std::fabs(pvy[i]) < 1e-3f ? 0.0f : pvy[i] * keep;
+        px[i] += pvx[i] * dt;
+        py[i] += pvy[i] * dt;
+        plife[i] -= dt;
+    }
+
+    // Walls and the drop line, branch-free
+    const float e = restitution, right = world.size.x, drop = world.size.y + 20.0f;
+    for (size_t i = 0; i < n; ++i) {
+        float r = prad[i];
+        bool hit_l = px[i] < r, hit_r = px[i] > right - r, hit_t = py[i] < r;
+        px[i] = hit_l ? r : hit_r ? right - r : px[i];
+        pvx[i] = hit_l ? std::fabs(pvx[i]) * e : hit_r ? -std::fabs(pvx[i]) * e : pvx[i];
+        py[i] = hit_t ? r : py[i];
+        pvy[i] = hit_t ? std::fabs(pvy[i]) * e : pvy[i];
+        plife[i] = py[i] > drop ? 0.0f : plife[i];
+    }
+
+    // Paddle and bricks within the time budget, round-robin across frames
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+    if (cursor >= n) cursor = 0;
+    size_t done = 0;
+    const size_t step = (size_t)std::max(1, batch);
+    while (done < n) {
+        size_t begin = (cursor + done) % n;
+        size_t count = std::min(step, std::min(n - done, n - begin));
+        collide_batch(begin, begin + count, world);
+        done += count;
+        if (std::chrono::duration<float, std::micro>(clock::now() - t0).count() >= budget_us) break;
+    }
+    cursor = (cursor + done) % n;
+    last.collide_us = std::chrono::duration<float, std::micro>(clock::now() - t0).count();
+    last.collided = (int)done;
+    last.deferred = (int)(n - done);
+
+    remove_dead();
+    last.active = (int)x.size();
+    last.sleeping = 0;
+    for (int32_t c : rest_cell) last.sleeping += c >= 0;
+}
+
+void DebrisSystem::collide_batch(size_t begin, size_t end, const DebrisWorld& world) {
+    const size_t n = end - begin;
+    float* __restrict px = x.data() + begin;
+    float* __restrict py = y.data() + begin;
+    float* __restrict pvx = vx.data() + begin;
+    float* __restrict pvy = vy.data() + begin;
+    const float* __restrict prad = radius.data() + begin;
+    const float* __restrict pawake = awake.data() + begin;
+    const float e = restitution;
+
+    // Paddle: flag overlaps in a vector pass, push the few hits out of the top
+    cell.resize(n);
+    int32_t* __restrict pcell = cell.data();
+    const Rect& pad = world.paddle;
+    for (size_t i = 0; i < n; ++i) {
+        float r = prad[i];
+        pcell[i] = px[i] + r > pad.pos.x && px[i] - r < pad.pos.x + pad.size.x &&
+            py[i] + r > pad.pos.y && py[i] - r < pad.pos.y + pad.size.y;
+    }
+    hits.clear();
+    for (size_t i = 0; i < n; ++i)
+        if (pcell[i]) hits.push_back((uint32_t)i);
+    for (uint32_t i : hits) {
+        py[i] = pad.pos.y - prad[i];
+        pvy[i] = -std::fabs(pvy[i]) * e;
+        pvx[i] *= friction;
+    }
+
+    const BrickGrid* grid = world.grid;
+    if (!grid || grid->alive == 0) return;
+
+    // Bricks: cell index of every awake piece whose centre lies inside a brick rect (not the
+    // padding around it), -1 otherwise; plain arithmetic so the loop vectorizes
+    const float ox = grid->origin.x, oy = grid->origin.y;
+    const float inv_px = 1.0f / grid->pitch.x, inv_py = 1.0f / grid->pitch.y;
+    const float pitch_x = grid->pitch.x, pitch_y = grid->pitch.y;
+    const float bw = world.brick_size.x, bh = world.brick_size.y;
+    const int cols = grid->cols, rows = grid->rows;
+    for (size_t i = 0; i < n; ++i) {
+        // floor() without a libm call: truncation is a floor for the shifted, non-negative values
+        int c = (int)((px[i] - ox) * inv_px + 1.0f) - 1, r = (int)((py[i] - oy) * inv_py + 1.0f) - 1;
+        float lx = px[i] - ox - c * pitch_x, ly = py[i] - oy - r * pitch_y;
+        bool inside = c >= 0 && c < cols && r >= 0 && r < rows && lx < bw && ly < bh && pawake[i] > 0.0f;
+        pcell[i] = inside ? r * cols + c : -1;
+    }
+
+    // Gather the live cells, then resolve hits one by one: out along the shallowest side
+    hits.clear();
+    const uint8_t* cell_alive = grid->cell_alive.data();
+    for (size_t i = 0; i < n; ++i)
+        if (pcell[i] >= 0 && cell_alive[pcell[i]]) hits.push_back((uint32_t)i);
+
+    for (uint32_t i : hits) {
+        int c = pcell[i] % cols, r = pcell[i] / cols;
+        float left = ox + c * pitch_x, top = oy + r * pitch_y;
+        float d_left = px[i] - left, d_right = left + bw - px[i];
+        float d_top = py[i] - top, d_bottom = top + bh - py[i];
+        float m = std::min(std::min(d_left, d_right), std::min(d_top, d_bottom));
+        float rad = prad[i];
+
+        if (m == d_top) {
+            py[i] = top - rad;
+            pvy[i] = -std::fabs(pvy[i]) * e;
+            pvx[i] *= friction;
+            // Resting on the brick: sleep after a few slow contacts in a row
+            size_t k = begin + i;
+            bool slow = pvx[i] * pvx[i] + pvy[i] * pvy[i] < sleep_speed * sleep_speed;
+            rest_frames[k] = slow ? (uint8_t)std::min(255, rest_frames[k] + 1) : 0;
+            if (rest_frames[k] >= sleep_frames) {
+                rest_cell[k] = pcell[i];
+                awake[k] = 0.0f;
+                pvx[i] = pvy[i] = 0.0f;
+            }
+        }
+        else if (m == d_bottom) { py[i] = top + bh + rad; pvy[i] = std::fabs(pvy[i]) * e; pvx[i] *= friction; }
+        else if (m == d_left) { px[i] = left - rad; pvx[i] = -std::fabs(pvx[i]) * e; pvy[i] *= friction; }
+        else { px[i] = left + bw + rad; pvx[i] = std::fabs(pvx[i]) * e; pvy[i] *= friction; }
+    }
+}
+
+// Swap-remove expired pieces (order doesn't matter)
+void DebrisSystem::remove_dead() {
+    size_t n = x.size();
+    for (size_t i = 0; i < n;) {
+        if (life[i] > 0.0f) { ++i; continue; }
+        --n;
+        x[i] = x[n]; y[i] = y[n]; vx[i] = vx[n]; vy[i] = vy[n];
+        life[i] = life[n]; radius[i] = radius[n]; awake[i] = awake[n];
+        color[i] = color[n]; rest_cell[i] = rest_cell[n]; rest_frames[i] = rest_frames[n];
+    }
+    for (auto* v : { &x, &y, &vx, &vy, &life, &radius, &awake }) v->resize(n);
+    color.resize(n);
+    rest_cell.resize(n);
+    rest_frames.resize(n);
+    if (cursor > n) cursor = 0;
+}
+
+void DebrisSystem::draw(ImDrawList& dl) const {
+    for (size_t i = 0; i < x.size(); ++i) {
+        float alpha = std::min(1.0f, std::max(0.0f, life[i] / 0.8f));
+        ImU32 col = (color[i] & ~IM_COL32_A_MASK) | ((ImU32)(255.0f * alpha) << IM_COL32_A_SHIFT);
+        float r = radius[i];
+        dl.AddRectFilled(ImVec2(x[i] - r, y[i] - r), ImVec2(x[i] + r, y[i] + r), col);
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "base.h"
+#include "brick_grid.h"
+#include <cstdint>
+#include <vector>
+
+// What debris collides with this frame
+struct DebrisWorld
+{
+    Vect size;                         // walls at x = 0, x = size.x and y = 0; below size.y debris is dropped
+    Rect paddle;
+    const BrickGrid* grid = nullptr;   // live bricks, looked up by cell
+    Vect brick_size;                   // brick rect inside its grid cell (the rest is padding)
+};
+
+struct DebrisStats
+{
+    int active = 0, sleeping = 0;
+    int collided = 0;        // pieces that went through the collision pass this frame
+    int deferred = 0;        // pieces left for the next frames once the budget ran out
+    float collide_us = 0.0f;
+};
+
+// Physical debris: visual pieces that bounce off the walls, the paddle and live bricks with
+// restitution and friction, and fall asleep when they come to rest on a brick (they wake up
+// when it is destroyed). Pieces are kept as structure-of-arrays and every per-piece pass is a
+// branch-free loop over plain float arrays, so the compiler vectorizes it; only the few pieces
+// that actually touch something are resolved one by one.
+//
+// The collision pass runs in batches, round-robin from where the last frame stopped, until
+// budget_us is spent. Pieces skipped by a frame still move and hit the walls; they are pushed
+// out of bricks on their next turn.
+class DebrisSystem
+{
+public:
+    int max_count = 4096;
+    float gravity = 400.0f;
+    float damping = 0.6f;           // velocity lost per second
+    float restitution = 0.45f;      // normal velocity kept by a bounce
+    float friction = 0.8f;          // tangential velocity kept by a contact
+    float sleep_speed = 15.0f;      // world units per second
+    int sleep_frames = 6;           // consecutive resting contacts before sleeping
+    float budget_us = 300.0f;       // collision pass time per frame
+    int batch = 256;
+
+    void clear();
+    int size() const { return (int)x.size(); }
+    void spawn(const Vect& pos, const Vect& vel, float life, float radius, ImU32 col);
+
+    void update(float dt, const DebrisWorld& world);
+    void draw(ImDrawList& dl) const;   // world units
+
+    const DebrisStats& stats() const { return last; }
+
+private:
+    void collide_batch(size_t begin, size_t end, const DebrisWorld& world);
+    void remove_dead();
+
+    // One entry per piece
+    std::vector<float> x, y, vx, vy, life, radius;
+    std::vector<float> awake;          // 1 or 0, so gravity is a multiply instead of a branch
+    std::vector<ImU32> color;
+    std::vector<int32_t> rest_cell;    // brick cell a sleeping piece lies on, -1 when awake
+    std::vector<uint8_t> rest_frames;
+
+    // Collision scratch, one entry per piece of the batch
+    std::vector<int32_t> cell;
+    std::vector<uint32_t> hits;
+
+    size_t cursor = 0;
+    DebrisStats last;
+};
@@ -0,0 +1,487 @@
+#include "draw_capture.h"
+#include "soft_raster.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+static const char draw_magic[4] = { 'A', 'R', 'K', 'D' };
+static const uint32_t draw_version = 1;
+static const long draw_frame_count_offset = 16;
+
+// Command as stored: clip rect, DrawTexture, vertex / index offsets, element count
+struct StoredCmd
+{
+    float clip[4];
+    uint32_t texture, vtx_offset, idx_offset, elem_count;
+};
+
+static_assert(sizeof(StoredCmd) == 32, "StoredCmd is written to disk as is");
+
+const char* draw_layer_name(DrawLayer layer) {
+    static const char* names[(int)DrawLayer::Count] = { "world", "background", "windows", "foreground" };
+    return names[(int)layer];
+}
+
+template <typename T>
+static void put(std::vector<uint8_t>& out, const T& v) {
+    const uint8_t* p = (const uint8_t*)&v;
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+static void put_varint(std::vector<uint8_t>& out, size_t v) {
+    for (; v >= 0x80; v >>= 7) out.push_back((uint8_t)(v | 0x80));
+    out.push_back((uint8_t)v);
+}
+
+// Bounds-checked reads from a frame payload
+struct ByteReader
+{
+    const uint8_t* p;
+    const uint8_t* end;
+
+    template <typename T>
+    bool get(T& v) {
+        if ((size_t)(end - p) < sizeof(T)) return false;
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+
+    bool varint(size_t& v) {
+        v = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            uint8_t b = *p++;
+            v |= (size_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+};
+
+
+
+// ----------------- Zero-run coding -----------------
+
+// [varint zeros][varint literal count][literal bytes] until the end. Runs of fewer than 4 zeros
+// stay inside the literals, so scattered zero bytes don't cost two varints each.
+static void pack_zero_runs(const uint8_t* p, size_t n, std::vector<uint8_t>& out) {
+    size_t i = 0;
+    while (i < n) {
+        size_t z = i;
+        while (z < n && p[z] == 0) z++;
+        size_t l = z;
+        while (l < n) {
+            if (p[l] != 0) { l++; continue; }
+            size_t e = l;
+            while (e < n && p[e] == 0 && e - l < 4) e++;
+            if (e - l >= 4 || e == n) break;
+            l = e;
+        }
+        put_varint(out, z - i);
+        put_varint(out, l - z);
+        out.insert(out.end(), p + z, p + l);
+        i = l;
+    }
+}
+
+static bool unpack_zero_runs(ByteReader& in, uint8_t* out, size_t n) {
+    size_t i = 0;
+    while (i < n) {
+        size_t zeros, literals;
+        if (!in.varint(zeros) || !in.varint(literals)) return false;
+        if (zeros > n - i || literals > n - i - zeros || (size_t)(in.end - in.p) < literals) return false;
+        memset(out + i, 0, zeros);
+        i += zeros;
+        memcpy(out + i, in.p, literals);
+        in.p += literals;
+        i += literals;
+    }
+    return true;
+}
+
+static void xor_with(uint8_t* data, size_t n, const std::vector<uint8_t>& prev) {
+    size_t m = std::min(n, prev.size());
+    for (size_t i = 0; i < m; ++i) data[i] ^= prev[i];
+}
+
+
+
+// ----------------- Writer -----------------
+
+bool DrawCaptureWriter::open(const std::string& path) {
+    close();
+    if (!file.open(path)) return false;
+    uint32_t header[4] = { draw_version, (uint32_t)sizeof(ImDrawVert), (uint32_t)sizeof(ImDrawIdx), 0 };
+    failed = !file.write(draw_magic, 4) || !file.write(header, sizeof(header));
+    previous.clear();
+    frame_count = 0;
+    raw_total = written_total = 0;
+    return !failed;
+}
+
+bool DrawCaptureWriter::close() {
+    if (!file.is_open()) return !failed;
+    if (!file.write_at(&frame_count, 4, draw_frame_count_offset)) failed = true;
+    if (!file.close()) failed = true;
+    return !failed;
+}
+
+void DrawCaptureWriter::add_list(const ImDrawList& list, DrawLayer layer, size_t slot) {
+    raw.clear();
+    const uint8_t* vtx = (const uint8_t*)list.VtxBuffer.Data;
+    const uint8_t* idx = (const uint8_t*)list.IdxBuffer.Data;
+    raw.insert(raw.end(), vtx, vtx + list.VtxBuffer.Size * sizeof(ImDrawVert));
+    raw.insert(raw.end(), idx, idx + list.IdxBuffer.Size * sizeof(ImDrawIdx));
+    uint32_t cmds = 0;
+    for (const ImDrawCmd& c : list.CmdBuffer) {
+        if (c.UserCallback || c.ElemCount == 0) continue;   // callbacks can't be replayed
+        DrawTexture t = c.TextureId == nullptr ? DrawTexture::None : c.TextureId == font_texture ? DrawTexture::Font :
+            c.TextureId == layer_texture ? DrawTexture::WorldLayer : DrawTexture::Other;
+        StoredCmd s = { { c.ClipRect.x, c.ClipRect.y, c.ClipRect.z, c.ClipRect.w }, (uint32_t)t, c.VtxOffset, c.IdxOffset, c.ElemCount };
+        put(raw, s);
+        cmds++;
+    }
+
+    if (previous.size() <= slot) previous.resize(slot + 1);
+    std::vector<uint8_t>& prev = previous[slot];
+    raw_total += raw.size();
+
+    // Delta against this slot's previous bytes, then keep the new raw bytes for the next frame
+    packed.clear();
+    size_t raw_size = raw.size();
+    delta.assign(raw.begin(), raw.end());
+    xor_with(delta.data(), raw_size, prev);
+    pack_zero_runs(delta.data(), raw_size, packed);
+    prev.swap(raw);
+
+    const char* name = list._OwnerName ? list._OwnerName : "";
+    uint8_t name_len = (uint8_t)std::min<size_t>(255, strlen(name));
+    put(frame, (uint8_t)layer);
+    put(frame, name_len);
+    frame.insert(frame.end(), name, name + name_len);
+    put(frame, (uint32_t)list.VtxBuffer.Size);
+    put(frame, (uint32_t)list.IdxBuffer.Size);
+    put(frame, cmds);
+    put(frame, (uint32_t)packed.size());
+    frame.insert(frame.end(), packed.begin(), packed.end());
+}
+
+void DrawCaptureWriter::write_frame(const ImDrawData& data, const ImDrawData* world_layer) {
+    if (!file.is_open() || failed) return;
+    frame.clear();
+    put(frame, data.DisplayPos);
+    put(frame, data.DisplaySize);
+    put(frame, data.FramebufferScale);
+    put(frame, world_layer ? world_layer->DisplaySize : ImVec2(0.0f, 0.0f));
+    put(frame, (uint32_t)((world_layer ? world_layer->CmdListsCount : 0) + data.CmdListsCount));
+
+    size_t slot = 0;
+    if (world_layer)
+        for (int i = 0; i < world_layer->CmdListsCount; ++i) add_list(*world_layer->CmdLists[i], DrawLayer::World, slot++);
+    for (int i = 0; i < data.CmdListsCount; ++i) {
+        const ImDrawList& list = *data.CmdLists[i];
+        const char* name = list._OwnerName ? list._OwnerName : "";
+        DrawLayer layer = strcmp(name, "##Background") == 0 ? DrawLayer::Background :
+            strcmp(name, "##Foreground") == 0 ? DrawLayer::Foreground : DrawLayer::Window;
+        add_list(list, layer, slot++);
+    }
+
+    uint32_t size = (uint32_t)frame.size();
+    if (!file.write(&size, 4) || !file.write(frame.data(), frame.size())) failed = true;
+    written_total += 4 + frame.size();
+    frame_count++;
+}
+
+
+
+// ----------------- Reader -----------------
+
+DrawCaptureReader::~DrawCaptureReader() {
+    if (file) fclose(file);
+    for (ImDrawList* dl : pool) IM_DELETE(dl);
+}
+
+bool DrawCaptureReader::open(const std::string& path, std::string& error) {
+    if (file) fclose(file);
+    previous.clear();
+    file = fopen(path.c_str(), "rb");
+    if (!file) { error = "cannot open " + path; return false; }
+    char magic[4];
+    uint32_t header[4];
+    if (fread(magic, 4, 1, file) != 1 || memcmp(magic, draw_magic, 4) != 0 || fread(header, sizeof(header), 1, file) != 1) {
+        error = path + " is not a draw capture";
+        return false;
+    }
+    if (header[0] != draw_version || header[1] != sizeof(ImDrawVert) || header[2] != sizeof(ImDrawIdx)) {
+        error = path + ": version or vertex / index layout differs from this build";
+        return false;
+    }
+    frames = header[3];
+    return true;
+}
+
+bool DrawCaptureReader::read_frame(CapturedFrame& out, ImTextureID font, ImTextureID world_layer, ImTextureID other) {
+    uint32_t size = 0;
+    if (!file || fread(&size, 4, 1, file) != 1) return false;
+    frame.resize(size);
+    if (fread(frame.data(), 1, size, file) != size) return false;
+
+    ByteReader in{ frame.data(), frame.data() + frame.size() };
+    uint32_t count = 0;
+    if (!in.get(out.display_pos) || !in.get(out.display_size) || !in.get(out.framebuffer_scale) || !in.get(out.layer_size) || !in.get(count))
+        return false;
+
+    out.lists.resize(count);
+    if (previous.size() < count) previous.resize(count);
+    while (pool.size() < count) pool.push_back(IM_NEW(ImDrawList)(nullptr));
+
+    const ImTextureID textures[] = { nullptr, font, world_layer, other };
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        CapturedList& cl = out.lists[slot];
+        uint8_t layer = 0, name_len = 0;
+        uint32_t vtx = 0, idx = 0, cmds = 0, packed = 0;
+        if (!in.get(layer) || layer >= (uint8_t)DrawLayer::Count || !in.get(name_len) || (size_t)(in.end - in.p) < name_len) return false;
+        cl.layer = (DrawLayer)layer;
+        cl.name.assign((const char*)in.p, name_len);
+        in.p += name_len;
+        if (!in.get(vtx) || !in.get(idx) || !in.get(cmds) || !in.get(packed) || (size_t)(in.end - in.p) < packed) return false;
+
+        size_t vtx_bytes = (size_t)vtx * sizeof(ImDrawVert), idx_bytes = (size_t)idx * sizeof(ImDrawIdx);
+        raw.resize(vtx_bytes + idx_bytes + (size_t)cmds * sizeof(StoredCmd));
+        ByteReader list_in{ in.p, in.p + packed };
+        if (!unpack_zero_runs(list_in, raw.data(), raw.size())) return false;
+        in.p += packed;
+        xor_with(raw.data(), raw.size(), previous[slot]);
+        previous[slot].assign(raw.begin(), raw.end());
+
+        ImDrawList* dl = pool[slot];
+        dl->VtxBuffer.resize((int)vtx);
+        dl->IdxBuffer.resize((int)idx);
+        dl->CmdBuffer.resize((int)cmds);
+        if (vtx_bytes) memcpy(dl->VtxBuffer.Data, raw.data(), vtx_bytes);
+        if (idx_bytes) memcpy(dl->IdxBuffer.Data, raw.data() + vtx_bytes, idx_bytes);
+        for (uint32_t k = 0; k < cmds; ++k) {
+            StoredCmd s;
+            memcpy(&s, raw.data() + vtx_bytes + idx_bytes + k * sizeof(StoredCmd), sizeof(s));
+            if (s.texture > (uint32_t)DrawTexture::Other || (uint64_t)s.idx_offset + s.elem_count > idx || s.vtx_offset > vtx) return false;
+            // Every index the command draws must name a vertex of this list
+            const ImDrawIdx* elems = dl->IdxBuffer.Data + s.idx_offset;
+            for (uint32_t e = 0; e < s.elem_count; ++e)
+                if ((uint64_t)s.vtx_offset + elems[e] >= vtx) return false;
+            ImDrawCmd c;
+            c.ClipRect = ImVec4(s.clip[0], s.clip[1], s.clip[2], s.clip[3]);
+            c.TextureId = textures[s.texture];
+            c.VtxOffset = s.vtx_offset;
+            c.IdxOffset = s.idx_offset;
+            c.ElemCount = s.elem_count;
+            c.UserCallback = nullptr;
+            c.UserCallbackData = nullptr;
+            dl->CmdBuffer[(int)k] = c;
+        }
+        cl.list = dl;
+    }
+    return true;
+}
+
+
+
+// ----------------- Player -----------------
+
+namespace {
+
+// Renders with the CPU rasterizer; the font atlas is rebuilt the way ImGui builds the default one
+class CpuReplayTarget : public DrawReplayTarget
+{
+public:
+    CpuReplayTarget() {
+        atlas.GetTexDataAsRGBA32((unsigned char**)&font.rgba, &font.width, &font.height);
+        atlas.TexID = (ImTextureID)&font;
+    }
+
+    const char* name() const override { return "cpu rasterizer"; }
+    ImTextureID font_texture() override { return (ImTextureID)&font; }
+    ImTextureID layer_texture() override { return (ImTextureID)&layer; }
+
+    void render_layer(ImDrawData& data) override {
+        layer_image.resize((int)data.DisplaySize.x, (int)data.DisplaySize.y, clear);
+        rasterize_draw_lists(data.CmdLists, data.CmdListsCount, data.DisplayPos, layer_image);
+        // Captures come from the OpenGL build, whose composite quad samples the layer bottom-up
+        for (int y = 0, w = layer_image.width; y < layer_image.height / 2; ++y)
+            std::swap_ranges(&layer_image.at(0, y), &layer_image.at(0, y) + w, &layer_image.at(0, layer_image.height - 1 - y));
+        layer.rgba = (const unsigned char*)layer_image.pixels.data();
+        layer.width = layer_image.width;
+        layer.height = layer_image.height;
+    }
+
+    void render_frame(ImDrawData& data) override {
+        image.resize((int)data.DisplaySize.x, (int)data.DisplaySize.y, clear);
+        rasterize_draw_lists(data.CmdLists, data.CmdListsCount, data.DisplayPos, image);
+    }
+
+    void finish() override {}
+
+private:
+    static constexpr ImU32 clear = IM_COL32(13, 19, 26, 255);   // main.cpp clear colour
+    ImFontAtlas atlas;
+    RasterTexture font, layer;
+    RgbaImage image, layer_image;
+};
+
+struct LayerStats
+{
+    double lists = 0, cmds = 0, vertices = 0, triangles = 0;
+    double overdraw = 0;   // summed per frame: covered area / target area
+};
+
+struct FrameStats
+{
+    int vertices = 0, triangles = 0;
+    double overdraw = 0;   // frame lists only (the world layer has its own target)
+    float ms = 0.0f;
+};
+
+// Rasterized area of the list's triangles, each clipped to its command's rect by the share of its
+// bounding box inside the rect. An estimate: exact for axis-aligned quads, close for the rest.
+double covered_area(const ImDrawList& dl, const ImVec2& origin, const ImVec2& size) {
+    double total = 0.0;
+    for (const ImDrawCmd& c : dl.CmdBuffer) {
+        float cx0 = std::max(0.0f, c.ClipRect.x - origin.x), cy0 = std::max(0.0f, c.ClipRect.y - origin.y);
+        float cx1 = std::min(size.x, c.ClipRect.z - origin.x), cy1 = std::min(size.y, c.ClipRect.w - origin.y);
+        if (cx0 >= cx1 || cy0 >= cy1) continue;
+        for (unsigned i = 0; i + 2 < c.ElemCount; i += 3) {
+            const ImDrawIdx* idx = dl.IdxBuffer.Data + c.IdxOffset + i;
+            const ImVec2& a = dl.VtxBuffer[c.VtxOffset + idx[0]].pos;
+            const ImVec2& b = dl.VtxBuffer[c.VtxOffset + idx[1]].pos;
+            const ImVec2& d = dl.VtxBuffer[c.VtxOffset + idx[2]].pos;
+            float area = 0.5f * std::fabs((b.x - a.x) * (d.y - a.y) - (b.y - a.y) * (d.x - a.x));
+            if (area <= 0.0f) continue;
+            float bx0 = std::min(a.x, std::min(b.x, d.x)) - origin.x, bx1 = std::max(a.x, std::max(b.x, d.x)) - origin.x;
+            float by0 = std::min(a.y, std::min(b.y, d.y)) - origin.y, by1 = std::max(a.y, std::max(b.y, d.y)) - origin.y;
+            float ix = std::min(bx1, cx1) - std::max(bx0, cx0), iy = std::min(by1, cy1) - std::max(by0, cy0);
+            if (ix <= 0.0f || iy <= 0.0f) continue;
+            float box = (bx1 - bx0) * (by1 - by0);
+            total += box > 0.0f ? area * std::min(1.0f, ix * iy / box) : 0.0f;
+        }
+    }
+    return total;
+}
+
+ImDrawData make_draw_data(std::vector<ImDrawList*>& lists, const ImVec2& pos, const ImVec2& size, const ImVec2& scale) {
+    ImDrawData d;
+    d.Valid = true;
+    d.CmdLists = lists.data();
+    d.CmdListsCount = (int)lists.size();
+    for (ImDrawList* dl : lists) {
+        d.TotalVtxCount += dl->VtxBuffer.Size;
+        d.TotalIdxCount += dl->IdxBuffer.Size;
+    }
+    d.DisplayPos = pos;
+    d.DisplaySize = size;
+    d.FramebufferScale = scale;
+    return d;
+}
+
+} // namespace
+
+int run_draw_replay(int argc, char** argv, DrawReplayTarget* gpu_target) {
+    const char* path = nullptr;
+    int repeat = 1;
+    bool cpu = false, per_frame = false, usage = false;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--cpu") == 0) cpu = true;
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--per-frame") == 0) per_frame = true;
+        else if (argv[i][0] != '-' && !path) path = argv[i];
+        else usage = true;
+    }
+    if (usage || !path) {
+        fprintf(stderr, "usage: --draw-replay [--cpu] [--repeat N] [--per-frame] <file.arkd>\n");
+        return 2;
+    }
+
+    CpuReplayTarget cpu_target;
+    DrawReplayTarget& target = cpu || !gpu_target ? (DrawReplayTarget&)cpu_target : *gpu_target;
+
+    // Every pass decodes the file again; decoding is outside the timed part. Frame times are the
+    // fastest over the passes, the counts come from the first one.
+    std::vector<FrameStats> frames;
+    LayerStats layers[(int)DrawLayer::Count];
+    CapturedFrame cf;
+    std::vector<ImDrawList*> world_lists, frame_lists;
+    for (int pass = 0; pass < repeat; ++pass) {
+        DrawCaptureReader reader;
+        std::string error;
+        if (!reader.open(path, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        for (size_t f = 0; reader.read_frame(cf, target.font_texture(), target.layer_texture(), nullptr); ++f) {
+            world_lists.clear();
+            frame_lists.clear();
+            for (const CapturedList& cl : cf.lists) (cl.layer == DrawLayer::World ? world_lists : frame_lists).push_back(cl.list);
+
+            auto t0 = std::chrono::steady_clock::now();
+            if (!world_lists.empty()) {
+                ImDrawData layer = make_draw_data(world_lists, ImVec2(0.0f, 0.0f), cf.layer_size, ImVec2(1.0f, 1.0f));
+                target.render_layer(layer);
+            }
+            ImDrawData data = make_draw_data(frame_lists, cf.display_pos, cf.display_size, cf.framebuffer_scale);
+            target.render_frame(data);
+            target.finish();
+            float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+            if (pass > 0) {
+                if (f < frames.size()) frames[f].ms = std::min(frames[f].ms, ms);
+                continue;
+            }
+            FrameStats fs;
+            fs.ms = ms;
+            for (const CapturedList& cl : cf.lists) {
+                LayerStats& ls = layers[(int)cl.layer];
+                const ImDrawList& dl = *cl.list;
+                bool world = cl.layer == DrawLayer::World;
+                ImVec2 origin = world ? ImVec2(0.0f, 0.0f) : cf.display_pos;
+                ImVec2 size = world ? cf.layer_size : cf.display_size;
+                double area = covered_area(dl, origin, size) / std::max(1.0f, size.x * size.y);
+                ls.lists += 1;
+                ls.cmds += dl.CmdBuffer.Size;
+                ls.vertices += dl.VtxBuffer.Size;
+                ls.triangles += dl.IdxBuffer.Size / 3;
+                ls.overdraw += area;
+                fs.vertices += dl.VtxBuffer.Size;
+                fs.triangles += dl.IdxBuffer.Size / 3;
+                if (!world) fs.overdraw += area;
+            }
+            frames.push_back(fs);
+        }
+    }
+    if (frames.empty()) {
+        fprintf(stderr, "%s: no frames\n", path);
+        return 1;
+    }
+
+    if (per_frame)
+        for (size_t f = 0; f < frames.size(); ++f)
+            printf("frame %5zu  %7.3f ms  vtx %6d  tris %6d  overdraw %.2f\n", f, frames[f].ms, frames[f].vertices, frames[f].triangles, frames[f].overdraw);
+
+    std::vector<float> ms;
+    double total_ms = 0.0;
+    for (const FrameStats& fs : frames) { ms.push_back(fs.ms); total_ms += fs.ms; }
+    std::sort(ms.begin(), ms.end());
+    auto pct = [&](double p) { return ms[std::min(ms.size() - 1, (size_t)(p * (ms.size() - 1) + 0.5))]; };
+    double n = (double)frames.size();
+    printf("%s: %zu frames through the %s%s\n", path, frames.size(), target.name(), repeat > 1 ? " (fastest of the passes)" : "");
+    printf("  frame ms: mean %.3f  p50 %.3f  p95 %.3f  max %.3f  (%.0f frames/s)\n",
+        total_ms / n, pct(0.5), pct(0.95), ms.back(), n / (total_ms * 0.001));
+    printf("  %-11s %8s %10s %12s %12s %10s\n", "layer", "lists", "cmds", "vertices", "triangles", "overdraw");
+    for (int l = 0; l < (int)DrawLayer::Count; ++l) {
+        const LayerStats& ls = layers[l];
+        if (ls.lists == 0) continue;
+        printf("  %-11s %8.1f %10.1f %12.0f %12.0f %9.2fx\n", draw_layer_name((DrawLayer)l),
+            ls.lists / n, ls.cmds / n, ls.vertices / n, ls.triangles / n, ls.overdraw / n);
+    }
+    printf("  (per frame averages; world overdraw is relative to the world layer's size)\n");
+    return 0;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "base.h"
+#include "async_io.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Draw command capture: the ImDrawData of every frame (vertices, indices, commands with clip
+// rects and textures), plus the offscreen world layer when it is on, so rendering can be
+// profiled and A/B tested offline on identical input (--draw-replay).
+//
+// Each list is stored as its vertex, index and command bytes XORed with the same list of the
+// previous frame and zero-run coded: the cached brick geometry and the menus hardly change
+// between frames, so a typical frame shrinks to a few percent of its raw size.
+//
+// .arkd layout (little-endian): "ARKD", version, sizeof(ImDrawVert), sizeof(ImDrawIdx), frame
+// count (0 until closed), then per frame: u32 byte size, display pos/size, framebuffer scale,
+// world layer size, u32 list count and per list: layer, owner name, vertex / index / command
+// counts, u32 packed size + packed bytes.
+
+// Where a list is drawn, for the per-layer breakdown
+enum class DrawLayer : uint8_t { World, Background, Window, Foreground, Count };
+
+const char* draw_layer_name(DrawLayer layer);
+
+// Textures are stored as one of these and mapped back to the player's own textures
+enum class DrawTexture : uint32_t { None, Font, WorldLayer, Other };
+
+class DrawCaptureWriter
+{
+public:
+    DrawCaptureWriter() = default;
+    DrawCaptureWriter(const DrawCaptureWriter&) = delete;
+    DrawCaptureWriter& operator=(const DrawCaptureWriter&) = delete;
+    ~DrawCaptureWriter() { close(); }
+
+    bool open(const std::string& path);
+    bool is_open() const { return file.is_open(); }
+    bool close();
+
+    void set_textures(ImTextureID font, ImTextureID world_layer) { font_texture = font; layer_texture = world_layer; }
+
+    // The frame as rendered, plus the world layer it samples (null when the layer is off)
+    void write_frame(const ImDrawData& frame, const ImDrawData* world_layer);
+
+    uint32_t frames() const { return frame_count; }
+    uint64_t raw_bytes() const { return raw_total; }
+    uint64_t written_bytes() const { return written_total; }
+
+private:
+    void add_list(const ImDrawList& list, DrawLayer layer, size_t slot);
+
+    AsyncFile file;
+    ImTextureID font_texture = nullptr;
+    ImTextureID layer_texture = nullptr;
+    std::vector<std::vector<uint8_t>> previous;   // raw bytes per list slot of the last frame
+    std::vector<uint8_t> raw, delta, packed, frame;   // scratch, reused between lists and frames
+    uint32_t frame_count = 0;
+    uint64_t raw_total = 0, written_total = 0;
+    bool failed = false;
+};
+
+// One decoded list; the draw list only has its buffers filled (no shared data), enough to render it
+struct CapturedList
+{
+    DrawLayer layer = DrawLayer::Window;
+    std::string name;
+    ImDrawList* list = nullptr;
+};
+
+struct CapturedFrame
+{
+    ImVec2 display_pos, display_size, framebuffer_scale;
+    ImVec2 layer_size;                  // 0 when the world layer was off
+    std::vector<CapturedList> lists;    // world layer lists first, then the frame's in draw order
+};
+
+class DrawCaptureReader
+{
+public:
+    DrawCaptureReader() = default;
+    DrawCaptureReader(const DrawCaptureReader&) = delete;
+    DrawCaptureReader& operator=(const DrawCaptureReader&) = delete;
+    ~DrawCaptureReader();
+
+    bool open(const std::string& path, std::string& error);
+    uint32_t frame_count() const { return frames; }
+
+    // Next frame; texture ids are the player's (font, world layer, anything else)
+    bool read_frame(CapturedFrame& out, ImTextureID font, ImTextureID world_layer, ImTextureID other);
+
+private:
+    FILE* file = nullptr;
+    uint32_t frames = 0;
+    std::vector<std::vector<uint8_t>> previous;
+    std::vector<ImDrawList*> pool;      // one per list slot, reused between frames
+    std::vector<uint8_t> frame, raw;
+};
+
+// Renders captured frames for --draw-replay. Frames arrive in order; the world layer (if any) is
+// rendered before the frame that samples it.
+class DrawReplayTarget
+{
+public:
+    virtual ~DrawReplayTarget() = default;
+    virtual const char* name() const = 0;
+    virtual ImTextureID font_texture() = 0;
+    virtual ImTextureID layer_texture() = 0;
+    virtual void render_layer(ImDrawData& data) = 0;
+    virtual void render_frame(ImDrawData& data) = 0;
+    virtual void finish() = 0;   // wait until the frame is really drawn
+};
+
+// --draw-replay [--cpu] [--repeat N] [--per-frame] <file.arkd>
+// Re-submits every captured frame as fast as possible through the given target (the OpenGL
+// backend; --cpu or no target: the CPU rasterizer) and reports frame times, vertex counts per
+// layer and the estimated overdraw (rasterized triangle area over the target's area).
+int run_draw_replay(int argc, char** argv, DrawReplayTarget* gpu_target);
@@ -0,0 +1,134 @@
+#include "draw_geometry.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARKANOID_DRAW_SSE2
+#include <emmintrin.h>
+#endif
+
+// ----------------- Vertex Transform -----------------
+
+void transform_draw_vertices(ImDrawVert* vtx, int count, const Vect& scale, const Vect& offset)
+{
+    int i = 0;
+#ifdef ARKANOID_DRAW_SSE2
+    // ImDrawVert is {pos, uv, col}: gather the positions of two vertices into one register
+    const __m128 s = _mm_setr_ps(scale.x, scale.y, scale.x, scale.y);
+    const __m128 o = _mm_setr_ps(offset.x, offset.y, offset.x, offset.y);
+    for (; i + 2 <= count; i += 2) {
+        __m64* p0 = (__m64*)&vtx[i].pos;
+        __m64* p1 = (__m64*)&vtx[i + 1].pos;
+        __m128 v = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), p0), p1);
+        v = _mm_add_ps(_mm_mul_ps(v, s), o);
+        _mm_storel_pi(p0, v);
+        _mm_storeh_pi(p1, v);
+    }
+#endif
+    for (; i < count; ++i) {
+        vtx[i].pos.x = vtx[i].pos.x * scale.x + offset.x;
+        vtx[i].pos.y = vtx[i].pos.y * scale.y + offset.y;
+    }
+}
+
+
+
+// ----------------- Geometry Cache -----------------
+
+DrawGeometryCache::~DrawGeometryCache()
+{
+    IM_DELETE(scratch);
+}
+
+void DrawGeometryCache::clear()
+{
+    vtx.resize(0);
+    idx.resize(0);
+    batches.resize(0);
+    garbage_vtx = 0;
+}
+
+ImDrawList& DrawGeometryCache::begin_batch(const ImDrawList& target)
+{
+    if (!scratch || scratch->_Data != target._Data) {
+        IM_DELETE(scratch);
+        scratch = IM_NEW(ImDrawList)(target._Data);
+    }
+    scratch->_ResetForNewFrame();
+    scratch->Flags = target.Flags & ~ImDrawListFlags_AllowVtxOffset;
+    return *scratch;
+}
+
+void DrawGeometryCache::end_batch()
+{
+    Batch b = { vtx.Size, 0, 0, idx.Size, 0, 0 };
+    store(b);
+    batches.push_back(b);
+}
+
+void DrawGeometryCache::end_batch_replace(int index)
+{
+    store(batches[index]);
+    if (garbage_vtx > vtx.Size / 2) compact();
+}
+
+// Copy the scratch list into the batch's range, moving it to the end when it no longer fits
+void DrawGeometryCache::store(Batch& b)
+{
+    int vtx_count = scratch->VtxBuffer.Size;
+    int idx_count = scratch->IdxBuffer.Size;
+    if (vtx_count > b.vtx_capacity || idx_count > b.idx_capacity) {
+        garbage_vtx += b.vtx_capacity;
+        b.vtx_begin = vtx.Size;
+        b.idx_begin = idx.Size;
+        b.vtx_capacity = vtx_count;
+        b.idx_capacity = idx_count;
+        vtx.resize(vtx.Size + vtx_count);
+        idx.resize(idx.Size + idx_count);
+    }
+    b.vtx_count = vtx_count;
+    b.idx_count = idx_count;
+    memcpy(vtx.Data + b.vtx_begin, scratch->VtxBuffer.Data, vtx_count * sizeof(ImDrawVert));
+    memcpy(idx.Data + b.idx_begin, scratch->IdxBuffer.Data, idx_count * sizeof(ImDrawIdx));
+}
+
+void DrawGeometryCache::compact()
+{
+    ImVector<ImDrawVert> new_vtx;
+    ImVector<ImDrawIdx> new_idx;
+    new_vtx.resize(vtx.Size - garbage_vtx);
+    new_idx.resize(idx.Size);
+    int vtx_size = 0, idx_size = 0;
+    for (Batch& b : batches) {
+        memcpy(new_vtx.Data + vtx_size, vtx.Data + b.vtx_begin, b.vtx_count * sizeof(ImDrawVert));
+        memcpy(new_idx.Data + idx_size, idx.Data + b.idx_begin, b.idx_count * sizeof(ImDrawIdx));
+        b.vtx_begin = vtx_size;
+        b.idx_begin = idx_size;
+        b.vtx_capacity = b.vtx_count;
+        b.idx_capacity = b.idx_count;
+        vtx_size += b.vtx_count;
+        idx_size += b.idx_count;
+    }
+    new_vtx.resize(vtx_size);
+    new_idx.resize(idx_size);
+    vtx.swap(new_vtx);
+    idx.swap(new_idx);
+    garbage_vtx = 0;
+}
+
+void DrawGeometryCache::append_to(ImDrawList& dl) const
+{
+    for (const Batch& b : batches) {
+        if (b.idx_count == 0) continue;
+        dl.PrimReserve(b.idx_count, b.vtx_count);
+        memcpy(dl._VtxWritePtr, vtx.Data + b.vtx_begin, b.vtx_count * sizeof(ImDrawVert));
+
+        // Batch indices are relative to the batch, rebase onto the draw list
+        ImDrawIdx base = (ImDrawIdx)dl._VtxCurrentIdx;
+        const ImDrawIdx* src = idx.Data + b.idx_begin;
+        for (int i = 0; i < b.idx_count; ++i) dl._IdxWritePtr[i] = (ImDrawIdx)(src[i] + base);
+
+        dl._VtxWritePtr += b.vtx_count;
+        dl._IdxWritePtr += b.idx_count;
+        dl._VtxCurrentIdx += b.vtx_count;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "base.h"
+
+// Scale + translate the positions of vtx[0..count) in place.
+// Used to move geometry emitted in world units into screen space in a single pass.
+void transform_draw_vertices(ImDrawVert* vtx, int count, const Vect& scale, const Vect& offset);
+
+// Transform every vertex appended to dl since vtx_begin (a VtxBuffer index)
+inline void transform_draw_list_range(ImDrawList& dl, int vtx_begin, const Vect& scale, const Vect& offset) {
+    transform_draw_vertices(dl.VtxBuffer.Data + vtx_begin, dl.VtxBuffer.Size - vtx_begin, scale, offset);
+}
+
+// Draw list geometry recorded once (in world units) and re-appended every frame.
+// Stored as small independent batches, so appending never overflows 16-bit indices
+// and a single batch can be re-recorded without touching the others.
+class DrawGeometryCache
+{
+public:
+    DrawGeometryCache() = default;
+    DrawGeometryCache(const DrawGeometryCache&) = delete;
+    DrawGeometryCache& operator=(const DrawGeometryCache&) = delete;
+    ~DrawGeometryCache();
+
+    void clear();
+
+    // Emit one batch into the returned scratch list, then call end_batch() to append it as a new
+    // batch (empty batches are kept, so batch indices stay stable) or end_batch_replace(i).
+    // 'target' provides the shared draw data and flags the geometry will be appended with.
+    ImDrawList& begin_batch(const ImDrawList& target);
+    void end_batch();
+    void end_batch_replace(int index);
+
+    void append_to(ImDrawList& dl) const;
+
+    int batch_count() const { return batches.Size; }
+    int vertex_count() const { return vtx.Size; }
+
+private:
+    struct Batch
+    {
+        int vtx_begin, vtx_count, vtx_capacity;
+        int idx_begin, idx_count, idx_capacity;
+    };
+
+    void store(Batch& b);
+    void compact();
+
+    ImVector<ImDrawVert> vtx;
+    ImVector<ImDrawIdx> idx;
+    ImVector<Batch> batches;
+    int garbage_vtx = 0;   // storage left behind by batches that outgrew their range
+    ImDrawList* scratch = nullptr;
+};
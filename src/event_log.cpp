@@ -0,0 +1,74 @@
+#include "event_log.h"
+#include <atomic>
+#include <cstring>
+
+static const uint32_t event_log_version = 1;
+
+const char* game_event_type_name(int type) {
+    static const char* names[] = {
+        "level_reset", "brick_hit", "brick_destroy", "combo_end", "bonus_spawn", "bonus_pickup", "life_lost", "purchase",
+        "purchase_failed"
+    };
+    static_assert(sizeof(names) / sizeof(names[0]) == (int)GameEventType::Count, "one name per event type");
+    return type >= 0 && type < (int)GameEventType::Count ? names[type] : "?";
+}
+
+// Same order as ArkanoidImpl::BonusType
+const char* game_event_bonus_name(int bonus) {
+    static const char* names[] = {
+        "speed_up", "enlarge_paddle", "extra_life", "pierce", "slow_mo", "points", "magnet", "score_mult", "nuke_row"
+    };
+    if (bonus == GameEvent::no_bonus) return "-";
+    return bonus >= 0 && bonus < (int)(sizeof(names) / sizeof(names[0])) ? names[bonus] : "?";
+}
+
+bool GameEventLog::open(const std::string& path) {
+    close();
+    if (!file.open(path)) return false;
+    uint32_t header[3];
+    memcpy(&header[0], "ARKE", 4);
+    header[1] = event_log_version;
+    header[2] = sizeof(GameEvent);
+    failed = !file.write(header, sizeof(header));
+    buffer.reserve(buffer_events);
+    written = 0;
+    frame = 0;
+    game = 0;
+    return !failed;
+}
+
+void GameEventLog::flush() {
+    if (buffer.empty()) return;
+    if (file.is_open() && !failed) failed = !file.write(buffer.data(), buffer.size() * sizeof(GameEvent));
+    written += buffer.size();
+    buffer.clear();
+}
+
+bool GameEventLog::close() {
+    if (!file.is_open()) return !failed;
+    flush();
+    return file.close() && !failed;
+}
+
+bool GameEventLog::load(const std::string& path, std::vector<GameEvent>& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    uint32_t header[3] = {};
+    bool ok = fread(header, sizeof(header), 1, f) == 1 && memcmp(&header[0], "ARKE", 4) == 0 &&
+        header[1] == event_log_version && header[2] == sizeof(GameEvent);
+    if (ok) {
+        fseek(f, 0, SEEK_END);
+        long end = ftell(f);
+        fseek(f, sizeof(header), SEEK_SET);
+        size_t n = (size_t)(end - (long)sizeof(header)) / sizeof(GameEvent);   // a torn last record is dropped
+        out.resize(n);
+        ok = fread(out.data(), sizeof(GameEvent), n, f) == n;
+    }
+    fclose(f);
+    return ok;
+}
+
+static std::atomic<GameEventLog*> g_event_sink{ nullptr };
+
+void set_event_sink(GameEventLog* log) { g_event_sink.store(log, std::memory_order_release); }
+GameEventLog* event_sink() { return g_event_sink.load(std::memory_order_acquire); }
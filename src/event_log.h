@@ -0,0 +1,82 @@
+#pragma once
+
+#include "async_io.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Gameplay event log: one fixed-size record per brick hit, purchase, bonus, life lost, ...
+// appended to an .arkev file through a buffer and the async I/O engine (no syscall on the game
+// thread). The file is meant for offline analysis: --events-convert turns it into a columnar
+// .arkcol file for --events-query.
+//
+// .arkev layout (little-endian): "ARKE", version, record size, then raw GameEvent records.
+
+enum class GameEventType : uint8_t {
+    LevelReset, BrickHit, BrickDestroy, ComboEnd, BonusSpawn, BonusPickup, LifeLost, Purchase, PurchaseFailed,
+    Count
+};
+
+struct GameEvent
+{
+    static constexpr uint8_t no_bonus = 255;
+
+    uint32_t frame = 0;       // update() calls since the log was opened
+    uint16_t game = 0;        // level resets since the log was opened
+    uint8_t type = 0;         // GameEventType
+    uint8_t bonus = no_bonus; // bonus type for bonus events
+    int16_t row = -1, col = -1;   // brick cell, -1 when not a brick event
+    int16_t combo = 0;        // combo multiplier after a hit; chain length for ComboEnd
+    int16_t hit_points = 0;   // hit points left after a brick event
+    int32_t score = 0;        // session score after the event
+    int32_t value = 0;        // score gained / purchase cost / lives left / bricks (LevelReset)
+    int32_t money = 0;        // cents earned at the shop rate (brick events) or balance (purchases)
+};
+
+static_assert(sizeof(GameEvent) == 28, "GameEvent is written to disk as is");
+
+const char* game_event_type_name(int type);
+const char* game_event_bonus_name(int bonus);
+
+class GameEventLog
+{
+public:
+    GameEventLog() = default;
+    GameEventLog(const GameEventLog&) = delete;
+    GameEventLog& operator=(const GameEventLog&) = delete;
+    ~GameEventLog() { close(); }
+
+    bool open(const std::string& path);
+    bool is_open() const { return file.is_open(); }
+    bool close();
+
+    void next_frame() { frame++; }
+    void append(GameEvent e) {
+        e.frame = frame;
+        e.game = game;
+        if (e.type == (uint8_t)GameEventType::LevelReset) e.game = ++game;
+        buffer.push_back(e);
+        if (buffer.size() >= buffer_events) flush();
+    }
+    uint64_t count() const { return written + buffer.size(); }
+
+    // Read a whole .arkev file
+    static bool load(const std::string& path, std::vector<GameEvent>& out);
+
+private:
+    static constexpr size_t buffer_events = 4096;
+
+    void flush();
+
+    AsyncFile file;
+    std::vector<GameEvent> buffer;
+    uint64_t written = 0;
+    uint32_t frame = 0;
+    uint16_t game = 0;
+    bool failed = false;
+};
+
+// Log the game reports into; null (the default) disables event logging
+void set_event_sink(GameEventLog* log);
+GameEventLog* event_sink();
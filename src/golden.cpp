@@ -0,0 +1,300 @@
+#include "golden.h"
+#include "arkanoid_impl.h"
+#include "parallel.h"
+#include "soft_raster.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+static const int golden_width = 1280;
+static const int golden_height = 720;
+static const ImU32 golden_clear = IM_COL32(13, 19, 26, 255);   // main.cpp clear colour
+
+struct GoldenScene
+{
+    const char* name;
+    void (*setup)(ArkanoidImpl& game);
+    void (*input)(int frame, ImGuiIO& io);   // optional, before each frame
+    int frames;                              // the last one is captured
+    float world_scale = 0.0f;                // > 0: world through the offscreen layer at this scale
+};
+
+// Scene scripts. They set gameplay state directly, so a scene never depends on simulation timing.
+class GoldenScenes
+{
+public:
+    // Fixed visual quality (the governor reacts to wall-clock time) and the capture's screen mapping
+    static void prepare(ArkanoidImpl& g, ImGuiIO& io) {
+        g.quality.enabled = false;
+        g.quality.set_level(0);
+        g.screen_scale = g.world_to_screen_scale(io);
+    }
+
+    static void start_of_level(ArkanoidImpl&) {}
+
+    static void mid_combo(ArkanoidImpl& g) {
+        for (int i : { 2, 3, 4, 17, 18, 33 }) g.set_brick_alive(i, false);
+        g.destroyed_bricks_count = 6;
+        g.score = 240;
+        g.combo_mult = 4;
+        g.combo_timer = 0.6f;
+        g.ball_pos = Vect(420.0f, 330.0f);
+        g.ball_vel = Vect(-110.0f, -95.0f);
+        g.trail_mode = true;
+        for (int k = 0; k < 12; ++k) g.ball_trail.push_back(g.ball_pos + Vect(k * 6.0f, k * 5.2f));
+        const Rect& hit = g.bricks[18].rect_world;
+        g.spawn_particles(hit.pos + hit.size * 0.5f, g.bricks[18].base_color, 14);
+        g.integrate_particles(0.08f);
+    }
+
+    static void magnet_active(ArkanoidImpl& g) {
+        g.magnet_active = true;
+        g.magnet_timer = g.magnet_duration * 0.5f;
+        Vect c = g.carriage_world.pos + g.carriage_world.size * 0.5f;
+        for (int k = 0; k < 4; ++k)
+            g.spawn_bonus_at(Vect(c.x - 150.0f + k * 100.0f, c.y - 160.0f + k * 25.0f), (ArkanoidImpl::BonusType)(k * 2));
+    }
+
+    static void brick_light(ArkanoidImpl& g) {
+        g.light_mode = true;
+        g.pierce_mode = true;
+        g.pierce_timer = g.pierce_duration;
+        g.ball_pos = Vect(260.0f, 190.0f);
+        g.spawn_bonus_at(Vect(560.0f, 200.0f), ArkanoidImpl::BonusType::EnlargePaddle);
+    }
+
+    static void win_modal(ArkanoidImpl& g) {
+        for (int i = 0; i < (int)g.bricks.size(); ++i) g.set_brick_alive(i, false);
+        g.score = 1050;
+        g.state = ArkanoidImpl::GameState::Win;
+    }
+
+    // Click "Arkanoid (Debug)" once its window is hoverable (third frame) and let the popup
+    // appear (popups skip their first frame)
+    static void click_debug_menu(int frame, ImGuiIO& io) {
+        io.MousePos = ImVec2(golden_width * 0.5f - 30.0f, 22.0f);
+        io.MouseDown[0] = frame == 3;
+    }
+};
+
+static const GoldenScene golden_scenes[] = {
+    { "start_of_level",  GoldenScenes::start_of_level, nullptr,                        2 },
+    { "mid_combo",       GoldenScenes::mid_combo,      nullptr,                        2 },
+    { "magnet_active",   GoldenScenes::magnet_active,  nullptr,                        2 },
+    { "win_modal",       GoldenScenes::win_modal,      nullptr,                        2 },
+    { "brick_light",     GoldenScenes::brick_light,    nullptr,                        2 },
+    { "debug_menu_open", GoldenScenes::start_of_level, GoldenScenes::click_debug_menu, 8 },
+    { "half_res_world",  GoldenScenes::mid_combo,      nullptr,                        2, 0.5f },
+};
+
+
+
+// ----------------- Capture -----------------
+
+struct SceneJob
+{
+    const GoldenScene* scene = nullptr;
+    std::vector<ImDrawList*> lists;   // owned copies of the captured frame
+    ImDrawList* layer = nullptr;      // owned copy of the world layer, when the scene uses it
+    int layer_width = 0, layer_height = 0;
+    RgbaImage layer_image;            // the layer rasterized, read through layer_texture
+    RasterTexture layer_texture;
+    bool passed = false;
+    std::string message;
+    double ms = 0.0;
+};
+
+// Run the scene in a fresh ImGui context and keep a copy of its last frame's draw data.
+// ImGui contexts are global state, so capture is serial; rasterization is the parallel part.
+static void capture_scene(SceneJob& job, ImFontAtlas& atlas) {
+    ImGuiContext* prev_context = ImGui::GetCurrentContext();
+    ImGuiContext* context = ImGui::CreateContext(&atlas);
+    ImGui::SetCurrentContext(context);
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)golden_width, (float)golden_height);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = nullptr;
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+
+    ArkanoidSettings settings;
+    ArkanoidImpl game;
+    game.reset(settings);
+    GoldenScenes::prepare(game, io);
+    job.scene->setup(game);
+    if (job.scene->world_scale > 0.0f) {
+        WorldLayer& layer = game.offscreen_world();
+        layer.enabled = true;
+        layer.governor.enabled = false;
+        layer.governor.min_scale = std::min(layer.governor.min_scale, job.scene->world_scale);
+        layer.governor.set_scale(job.scene->world_scale);
+        layer.set_texture((ImTextureID)&job.layer_texture, false);
+    }
+
+    for (int f = 0; f < job.scene->frames; ++f) {
+        if (job.scene->input) job.scene->input(f, io);
+        ImGui::NewFrame();
+        game.draw(io, *ImGui::GetBackgroundDrawList());
+        ImGui::Render();
+    }
+
+    ImDrawData* data = ImGui::GetDrawData();
+    for (int i = 0; i < data->CmdListsCount; ++i) job.lists.push_back(data->CmdLists[i]->CloneOutput());
+    if (game.offscreen_world().active()) {
+        job.layer = game.offscreen_world().draw_list()->CloneOutput();
+        job.layer_width = game.offscreen_world().width();
+        job.layer_height = game.offscreen_world().height();
+    }
+
+    ImGui::DestroyContext(context);
+    ImGui::SetCurrentContext(prev_context);
+}
+
+
+
+// ----------------- Compare -----------------
+
+struct GoldenConfig
+{
+    std::string dir;
+    std::string out_dir;
+    int tolerance[3] = { 0, 0, 0 };
+    bool bless = false;
+};
+
+static void run_scene_job(SceneJob& job, const GoldenConfig& cfg) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    // The world layer first: the frame samples it through layer_texture
+    if (job.layer) {
+        job.layer_image.resize(job.layer_width, job.layer_height, golden_clear);
+        rasterize_draw_lists(&job.layer, 1, ImVec2(0.0f, 0.0f), job.layer_image);
+        job.layer_texture.rgba = (const unsigned char*)job.layer_image.pixels.data();
+        job.layer_texture.width = job.layer_width;
+        job.layer_texture.height = job.layer_height;
+    }
+
+    RgbaImage actual;
+    actual.resize(golden_width, golden_height, golden_clear);
+    rasterize_draw_lists(job.lists.data(), (int)job.lists.size(), ImVec2(0.0f, 0.0f), actual);
+
+    std::string golden_path = cfg.dir + "/" + job.scene->name + ".qoi";
+    std::string out_base = cfg.out_dir + "/" + job.scene->name;
+    RgbaImage golden, mask;
+
+    if (cfg.bless) {
+        job.passed = save_qoi(golden_path, actual);
+        job.message = job.passed ? "written" : "cannot write " + golden_path;
+    } else if (!load_qoi(golden_path, golden)) {
+        job.message = "missing golden " + golden_path;
+        save_ppm(out_base + ".actual.ppm", actual);
+    } else if (golden.width != actual.width || golden.height != actual.height) {
+        job.message = "size " + std::to_string(golden.width) + "x" + std::to_string(golden.height) + " differs";
+        save_ppm(out_base + ".actual.ppm", actual);
+    } else {
+        bool masked = load_qoi(cfg.dir + "/" + job.scene->name + ".mask.qoi", mask) &&
+            mask.width == actual.width && mask.height == actual.height;
+
+        // Diff image: failing pixels red, masked ones dark blue, the rest a dimmed golden
+        RgbaImage diff;
+        diff.resize(actual.width, actual.height, IM_COL32(0, 0, 0, 255));
+        int failed = 0, max_delta = 0;
+        for (int y = 0; y < actual.height; ++y) {
+            for (int x = 0; x < actual.width; ++x) {
+                ImU32 g = golden.at(x, y), a = actual.at(x, y);
+                if (masked && (mask.at(x, y) & 0x00FFFFFFu) == 0) { diff.at(x, y) = IM_COL32(0, 0, 90, 255); continue; }
+
+                bool bad = false;
+                for (int c = 0; c < 3; ++c) {
+                    int d = std::abs((int)((g >> (c * 8)) & 0xFF) - (int)((a >> (c * 8)) & 0xFF));
+                    max_delta = std::max(max_delta, d);
+                    bad |= d > cfg.tolerance[c];
+                }
+                int lum = (int)((g & 0xFF) + ((g >> 8) & 0xFF) + ((g >> 16) & 0xFF)) / 9;
+                diff.at(x, y) = bad ? IM_COL32(255, 0, 0, 255) : IM_COL32(lum, lum, lum, 255);
+                failed += bad ? 1 : 0;
+            }
+        }
+        job.passed = failed == 0;
+        job.message = std::to_string(failed) + " px over tolerance, max delta " + std::to_string(max_delta);
+        if (!job.passed) {
+            save_ppm(out_base + ".actual.ppm", actual);
+            save_ppm(out_base + ".diff.ppm", diff);
+        }
+    }
+
+    job.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// "T" or "R,G,B"
+static bool parse_tolerance(const char* text, int out[3]) {
+    int n = sscanf(text, "%d,%d,%d", &out[0], &out[1], &out[2]);
+    if (n == 1) out[1] = out[2] = out[0];
+    return n == 1 || n == 3;
+}
+
+// Checked-in goldens, used when no directory is given (run from the repository root)
+static const char* default_golden_dir = "tools/golden";
+
+int run_golden_tool(int argc, char** argv) {
+    GoldenConfig cfg;
+    const char* only_scene = nullptr;
+    unsigned threads = 0;
+    bool usage = false;
+    for (int i = 0; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--bless") == 0) cfg.bless = true;
+        else if (strcmp(argv[i], "--scene") == 0 && has_value) only_scene = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && has_value) usage |= !parse_tolerance(argv[++i], cfg.tolerance);
+        else if (strcmp(argv[i], "--threads") == 0 && has_value) threads = (unsigned)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0 && has_value) cfg.out_dir = argv[++i];
+        else if (argv[i][0] != '-' && cfg.dir.empty()) cfg.dir = argv[i];
+        else usage = true;
+    }
+    if (usage) {
+        fprintf(stderr, "usage: --golden [--bless] [--scene NAME] [--tolerance T | R,G,B] [--threads N] [--out DIR] [<golden dir>]  (default %s)\n",
+            default_golden_dir);
+        return 2;
+    }
+    if (cfg.dir.empty()) cfg.dir = default_golden_dir;
+    if (cfg.out_dir.empty()) cfg.out_dir = cfg.dir;
+    std::error_code ec;
+    if (cfg.bless) std::filesystem::create_directories(cfg.dir, ec);
+    std::filesystem::create_directories(cfg.out_dir, ec);
+
+    std::vector<SceneJob> jobs;
+    for (const GoldenScene& scene : golden_scenes) {
+        if (only_scene && strcmp(only_scene, scene.name) != 0) continue;
+        jobs.emplace_back();
+        jobs.back().scene = &scene;
+    }
+    if (jobs.empty()) {
+        fprintf(stderr, "no scene named '%s'\n", only_scene);
+        return 2;
+    }
+
+    // The font atlas is shared by every scene context and doubles as the rasterizer's texture
+    ImFontAtlas atlas;
+    RasterTexture font_texture;
+    atlas.GetTexDataAsRGBA32((unsigned char**)&font_texture.rgba, &font_texture.width, &font_texture.height);
+    atlas.TexID = (ImTextureID)&font_texture;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (SceneJob& job : jobs) capture_scene(job, atlas);
+    parallel_for(jobs.size(), threads, [&](size_t i) { run_scene_job(jobs[i], cfg); });
+    double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    int failed = 0;
+    for (SceneJob& job : jobs) {
+        printf("[%s] %-16s %s  %.1f ms\n", job.passed ? (cfg.bless ? "BLESS" : "PASS") : "FAIL", job.scene->name, job.message.c_str(), job.ms);
+        failed += job.passed ? 0 : 1;
+        for (ImDrawList* dl : job.lists) IM_DELETE(dl);
+        if (job.layer) IM_DELETE(job.layer);
+    }
+    printf("%zu scenes, %d failed in %.1f ms\n", jobs.size(), failed, total_ms);
+    return failed ? 1 : 0;
+}
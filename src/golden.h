@@ -0,0 +1,10 @@
+#pragma once
+
+// --golden [--bless] [--scene NAME] [--tolerance T | R,G,B] [--threads N] [--out DIR] [<golden dir>]
+// Renders scripted scenes (start of level, mid-combo, magnet, win modal, debug menu) through the
+// full draw() path into ImGui draw data, rasterizes them on the CPU in parallel and compares each
+// with <dir>/<scene>.qoi. A pixel fails when any channel differs by more than the tolerance;
+// black pixels of an optional <dir>/<scene>.mask.qoi are ignored. Failures write
+// <out>/<scene>.actual.ppm and <scene>.diff.ppm; --bless (re)writes the goldens. The golden dir
+// defaults to tools/golden, the checked-in set (QOI keeps it small in git).
+int run_golden_tool(int argc, char** argv);
@@ -0,0 +1,45 @@
+#include "headless.h"
+#include <GLFW/glfw3.h>
+
+static const int game_key_codes[GameKey_Count] = {
+    GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_R, GLFW_KEY_1, GLFW_KEY_2, GLFW_KEY_3, GLFW_KEY_C,
+    GLFW_KEY_X, GLFW_KEY_T, GLFW_KEY_Q, GLFW_KEY_Y, GLFW_KEY_E, GLFW_KEY_N,
+};
+
+int game_key_code(int bit_index) {
+    return (bit_index >= 0 && bit_index < GameKey_Count) ? game_key_codes[bit_index] : -1;
+}
+
+uint32_t pack_game_keys(const ImGuiIO& io) {
+    uint32_t keys = 0;
+    for (int i = 0; i < GameKey_Count; ++i)
+        if (io.KeysDown[game_key_codes[i]]) keys |= 1u << i;
+    return keys;
+}
+
+void unpack_game_keys(uint32_t keys, ImGuiIO& io) {
+    for (int i = 0; i < GameKey_Count; ++i)
+        io.KeysDown[game_key_codes[i]] = (keys & (1u << i)) != 0;
+}
+
+
+
+// ----------------- Headless Simulation -----------------
+
+HeadlessSim::HeadlessSim(const ArkanoidSettings& settings, Vect display_size) {
+    input.DisplaySize = ImVec2(display_size);
+    reset(settings);
+}
+
+void HeadlessSim::reset(const ArkanoidSettings& settings) {
+    impl.reset(settings);
+    debug.hits.clear();
+    frame_index = 0;
+}
+
+void HeadlessSim::step(float dt, uint32_t keys) {
+    unpack_game_keys(keys, input);
+    input.DeltaTime = dt;
+    impl.update(input, debug, dt);
+    frame_index++;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "arkanoid_impl.h"
+#include <cstdint>
+
+// Game keys that drive the simulation, packed as bits for replays and scripts
+enum GameKeyBit : uint32_t
+{
+    GameKey_Left      = 1u << 0,   // A
+    GameKey_Right     = 1u << 1,   // D
+    GameKey_Restart   = 1u << 2,   // R
+    GameKey_SpeedLow  = 1u << 3,   // 1
+    GameKey_SpeedMid  = 1u << 4,   // 2
+    GameKey_SpeedHigh = 1u << 5,   // 3
+    GameKey_Pierce    = 1u << 6,   // C
+    GameKey_Magnet    = 1u << 7,   // X
+    GameKey_ScoreMult = 1u << 8,   // T
+    GameKey_Freeze    = 1u << 9,   // Q
+    GameKey_God       = 1u << 10,  // Y
+    GameKey_BuyLife   = 1u << 11,  // E
+    GameKey_NukeRow   = 1u << 12,  // N
+};
+
+constexpr int GameKey_Count = 13;
+
+// GLFW key code of a game key bit index
+int game_key_code(int bit_index);
+
+uint32_t pack_game_keys(const ImGuiIO& io);
+void unpack_game_keys(uint32_t keys, ImGuiIO& io);
+
+// Runs the game simulation without a window or an ImGui context.
+// Each instance owns its input state, so several of them can run on different threads.
+class HeadlessSim
+{
+public:
+    explicit HeadlessSim(const ArkanoidSettings& settings, Vect display_size = Vect(1280.0f, 720.0f));
+
+    void reset(const ArkanoidSettings& settings);
+    void step(float dt, uint32_t keys);
+
+    ArkanoidImpl& game() { return impl; }
+    const ArkanoidImpl& game() const { return impl; }
+    ImGuiIO& io() { return input; }
+    ArkanoidDebugData& debug_data() { return debug; }
+    uint32_t frame() const { return frame_index; }
+
+private:
+    ArkanoidImpl impl;
+    ImGuiIO input;
+    ArkanoidDebugData debug;
+    uint32_t frame_index = 0;
+};
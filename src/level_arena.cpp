@@ -0,0 +1,105 @@
+#include "level_arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+static bool arena_huge_pages = false;
+
+void set_level_arena_huge_pages(bool enabled) { arena_huge_pages = enabled; }
+
+static size_t round_up(size_t v, size_t a) { return (v + a - 1) / a * a; }
+
+// Fresh zero-filled memory from the OS; size is rounded up to what was actually mapped
+static void* map_chunk(size_t& size, bool& huge) {
+    huge = false;
+#ifdef __linux__
+    const size_t huge_page = 2u << 20;
+    if (arena_huge_pages) {
+        size_t huge_size = round_up(size, huge_page);
+        void* p = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) { size = huge_size; huge = true; return p; }
+    }
+    size = round_up(size, 4096);
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return nullptr;
+    // No reserved huge pages: let the kernel back the chunk with transparent ones
+    if (arena_huge_pages && size >= huge_page) huge = madvise(p, size, MADV_HUGEPAGE) == 0;
+    return p;
+#else
+    return std::calloc(1, size);
+#endif
+}
+
+void LevelArena::free_chunk(Chunk* c) {
+#ifdef __linux__
+    munmap(c, c->size);
+#else
+    std::free(c);
+#endif
+}
+
+LevelArena::~LevelArena() {
+    while (head) {
+        Chunk* prev = head->prev;
+        free_chunk(head);
+        head = prev;
+    }
+}
+
+bool LevelArena::add_chunk(size_t min_size) {
+    size_t size = std::max(next_chunk_size, min_size);
+    bool chunk_huge = false;
+    void* p = map_chunk(size, chunk_huge);
+    if (!p) return false;
+
+    Chunk* c = (Chunk*)p;
+    c->prev = head;
+    c->size = size;
+    c->huge = chunk_huge;
+    if (head) used_before += head_used;
+    head = c;
+    head_used = sizeof(Chunk);
+    reserved += size;
+    next_chunk_size = size * 2;
+    chunks++;
+    huge = chunk_huge;
+    return true;
+}
+
+void* LevelArena::do_allocate(size_t bytes, size_t alignment) {
+    uintptr_t base = (uintptr_t)head;
+    size_t offset = head ? round_up(base + head_used, alignment) - base : 0;
+    if (!head || offset + bytes > head->size) {
+        if (!add_chunk(sizeof(Chunk) + alignment + bytes)) throw std::bad_alloc();
+        base = (uintptr_t)head;
+        offset = round_up(base + head_used, alignment) - base;
+    }
+    head_used = offset + bytes;
+    return (void*)(base + offset);
+}
+
+void LevelArena::release() {
+    if (!head) return;
+    if (!head->prev) {
+        head_used = sizeof(Chunk);
+        used_before = 0;
+        return;
+    }
+
+    // The last level spilled over several chunks: keep one that fits it whole
+    size_t total = reserved;
+    while (head) {
+        Chunk* prev = head->prev;
+        free_chunk(head);
+        head = prev;
+    }
+    head_used = used_before = reserved = 0;
+    chunks = 0;
+    next_chunk_size = total;
+    add_chunk(total);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// Bump allocator for level-lifetime data (bricks, broadphase rows, dirty lists...). Containers
+// take it as a std::pmr::memory_resource; deallocate is a no-op and release() drops everything
+// at once in O(1). Memory comes straight from the OS in chunks; when a level needed more than
+// one chunk, release() replaces them with a single chunk of the combined size, so from the
+// second level of a given size on, setting up a level does no allocation at all.
+//
+// Containers allocated from the arena must be emptied (or reassigned) before release().
+class LevelArena : public std::pmr::memory_resource
+{
+public:
+    explicit LevelArena(size_t first_chunk = 64 * 1024) : next_chunk_size(first_chunk) {}
+    LevelArena(const LevelArena&) = delete;
+    LevelArena& operator=(const LevelArena&) = delete;
+    ~LevelArena() override;
+
+    void release();
+
+    size_t used() const { return used_before + (head ? head_used : 0); }
+    size_t capacity() const { return reserved; }
+    int chunk_count() const { return chunks; }
+    bool huge_pages() const { return huge; }   // the current chunk is backed by huge pages
+
+private:
+    struct Chunk
+    {
+        Chunk* prev;
+        size_t size;     // bytes including this header
+        bool huge;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    bool add_chunk(size_t min_size);
+    static void free_chunk(Chunk* c);
+
+    Chunk* head = nullptr;
+    size_t head_used = 0;       // bytes used in head, header included
+    size_t used_before = 0;     // payload used in the older chunks
+    size_t reserved = 0;
+    size_t next_chunk_size;
+    int chunks = 0;
+    bool huge = false;
+};
+
+// Back arena chunks with huge pages (explicit MAP_HUGETLB first, then transparent huge pages).
+// Off by default; set before the game starts (--huge-pages).
+void set_level_arena_huge_pages(bool enabled);
@@ -0,0 +1,386 @@
+#include "level_cache.h"
+#include "async_io.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ARKANOID_MMAP 1
+#endif
+
+namespace fs = std::filesystem;
+
+static const char cache_magic[4] = { 'A', 'R', 'K', 'C' };
+static const uint32_t cache_version = 1;
+
+// 88 bytes, so the pack image after it keeps its 8-byte alignment in the mapping
+struct LevelCacheEntryHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t image_size;
+    uint64_t image_checksum;      // image_checksum() of the pack image
+    LevelCacheKey key;
+};
+
+static_assert(sizeof(LevelCacheEntryHeader) % 8 == 0, "the pack image must stay 8-byte aligned");
+
+static uint64_t fnv1a64(const void* data, size_t size) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+// Checksum of an entry's image: four independent multiply-xorshift lanes over 8-byte words, so
+// checking a mapped level costs about as much as copying it (byte-wise FNV is ~8x slower)
+static uint64_t image_checksum(const uint8_t* p, size_t size) {
+    const uint64_t k = 0x9E3779B97F4A7C15ull;
+    uint64_t lane[4] = { k, k ^ 1, k ^ 2, k ^ 3 };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int j = 0; j < 4; ++j) {
+            uint64_t w;
+            memcpy(&w, p + i + j * 8, 8);
+            lane[j] = (lane[j] ^ w) * k;
+            lane[j] ^= lane[j] >> 29;
+        }
+    }
+    uint64_t h = fnv1a64(p + i, size - i) ^ size;
+    for (int j = 0; j < 4; ++j) h = (h ^ lane[j]) * k, h ^= h >> 32;
+    return h;
+}
+
+uint64_t LevelCacheKey::hash() const { return fnv1a64(this, sizeof(*this)); }
+
+LevelCacheKey level_cache_key(int generator, const LevelGenParams& p) {
+    const LevelGenerator& gen = level_generator(generator);
+    LevelCacheKey k;
+    strncpy(k.generator, gen.name(), sizeof(k.generator) - 1);
+    k.generator_version = gen.version();
+    k.cols = p.cols;
+    k.rows = p.rows;
+    k.seed = p.seed;
+    k.density = p.density;
+    k.difficulty = p.difficulty;
+    k.bonus_chance = p.bonus_chance;
+    return k;
+}
+
+
+
+// ----------------- Entry files -----------------
+
+// Read-only view of a whole entry. Small entries are read into a reused buffer: a mapping costs
+// more than the read (mmap + munmap + faults) until entries reach about a megabyte.
+class EntryView
+{
+public:
+    static constexpr size_t map_threshold = 1u << 20;
+
+    EntryView() = default;
+    EntryView(const EntryView&) = delete;
+    EntryView& operator=(const EntryView&) = delete;
+    ~EntryView() {
+#if ARKANOID_MMAP
+        if (mapped) munmap((void*)data, size);
+#endif
+    }
+
+    bool open(const std::string& path, std::vector<uint8_t>& scratch) {
+#if ARKANOID_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size_t n = (size_t)st.st_size;
+            if (n >= map_threshold) {
+                int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+                flags |= MAP_POPULATE;   // read right away: fault the whole entry in one go
+#endif
+                void* p = mmap(nullptr, n, PROT_READ, flags, fd, 0);
+                if (p != MAP_FAILED) {
+                    data = (const uint8_t*)p;
+                    size = n;
+                    mapped = true;
+                }
+            } else {
+                if (scratch.size() < n) scratch.resize(n);
+                size_t got = 0;
+                while (got < n) {
+                    ssize_t r = pread(fd, scratch.data() + got, n - got, (off_t)got);
+                    if (r <= 0) break;
+                    got += (size_t)r;
+                }
+                if (got == n) {
+                    data = scratch.data();
+                    size = n;
+                }
+            }
+        }
+        ::close(fd);
+        return data != nullptr;
+#else
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) return false;
+        fseek(f, 0, SEEK_END);
+        long n = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if (n > 0 && scratch.size() < (size_t)n) scratch.resize((size_t)n);
+        bool ok = n > 0 && fread(scratch.data(), 1, (size_t)n, f) == (size_t)n;
+        fclose(f);
+        data = ok ? scratch.data() : nullptr;
+        size = ok ? (size_t)n : 0;
+        return ok;
+#endif
+    }
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+private:
+    bool mapped = false;
+};
+
+
+
+// ----------------- Cache -----------------
+
+LevelCache::~LevelCache() {
+    if (!writer.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    pending_ready.notify_all();
+    writer.join();
+}
+
+bool LevelCache::open(const std::string& dir, uint64_t max_bytes) {
+    flush();
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (!fs::is_directory(dir, ec)) return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        root = dir;
+        limit = max_bytes;
+        totals = LevelCacheStats();
+    }
+    evict();
+    if (!writer.joinable()) writer = std::thread(&LevelCache::writer_loop, this);
+    return true;
+}
+
+std::string LevelCache::entry_path(const LevelCacheKey& key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.arkc", (unsigned long long)key.hash());
+    return (fs::path(root) / name).string();
+}
+
+bool LevelCache::load(const LevelCacheKey& key, LevelData& out) {
+    if (!is_open()) return false;
+    auto t0 = std::chrono::steady_clock::now();
+    std::string path = entry_path(key);
+
+    bool found, ok = false, queued = false;
+    size_t size = 0;
+    {
+        static thread_local std::vector<uint8_t> scratch;
+        EntryView f;
+        {
+            // Stored but not published yet: read the queued copy
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const PendingStore& q : pending) {
+                if (memcmp(&q.key, &key, sizeof(key)) != 0) continue;
+                scratch.assign(q.entry.begin(), q.entry.end());
+                f.data = scratch.data();
+                f.size = scratch.size();
+                queued = true;
+            }
+        }
+        found = queued || f.open(path, scratch);
+        size = f.size;
+        if (found && f.size >= sizeof(LevelCacheEntryHeader)) {
+            LevelCacheEntryHeader h;
+            memcpy(&h, f.data, sizeof(h));
+            const uint8_t* image = f.data + sizeof(h);
+            // Decoded into a per-thread scratch level and swapped with out, so neither allocates
+            static thread_local std::vector<LevelData> levels;
+            ok = memcmp(h.magic, cache_magic, 4) == 0 && h.version == cache_version &&
+                memcmp(&h.key, &key, sizeof(key)) == 0 && h.image_size == f.size - sizeof(h) &&
+                image_checksum(image, (size_t)h.image_size) == h.image_checksum &&
+                decode_level_pack(image, (size_t)h.image_size, levels) && levels.size() == 1;
+            if (ok) std::swap(out, levels[0]);
+        }
+    }
+
+    std::error_code ec;
+    if (found && !ok && !queued) fs::remove(path, ec);       // torn or damaged: regenerate
+    if (ok && !queued) fs::last_write_time(path, fs::file_time_type::clock::now(), ec);   // LRU order
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ok) {
+        totals.misses++;
+        if (found && !queued) {
+            totals.corrupt++;
+            totals.bytes -= std::min<uint64_t>(totals.bytes, size);
+        }
+        return false;
+    }
+    totals.hits++;
+    totals.load_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    return true;
+}
+
+bool LevelCache::store(const LevelCacheKey& key, const LevelData& level) {
+    if (!is_open()) return false;
+    static thread_local std::vector<uint8_t> image;
+    encode_level_pack(std::vector<LevelData>(1, level), image);
+
+    LevelCacheEntryHeader h;
+    memcpy(h.magic, cache_magic, 4);
+    h.version = cache_version;
+    h.image_size = image.size();
+    h.image_checksum = image_checksum(image.data(), image.size());
+    h.key = key;
+
+    PendingStore q;
+    q.key = key;
+    q.entry.resize(sizeof(h) + image.size());
+    memcpy(q.entry.data(), &h, sizeof(h));
+    memcpy(q.entry.data() + sizeof(h), image.data(), image.size());
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        pending_done.wait(lock, [this] { return pending.size() < max_pending; });
+        pending.push_back(std::move(q));
+    }
+    pending_ready.notify_one();
+    return true;
+}
+
+void LevelCache::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    pending_done.wait(lock, [this] { return pending.empty(); });
+}
+
+// Write one entry to a temporary file and rename it into place
+bool LevelCache::write_entry(const PendingStore& q) {
+    // Unique across threads and processes sharing the directory; rename() publishes it whole
+    static const uint64_t process_tag = std::random_device{}();
+    static std::atomic<uint32_t> counter{ 0 };
+    std::string path = entry_path(q.key);
+    char suffix[48];
+    snprintf(suffix, sizeof(suffix), ".%08llx%08x.tmp", (unsigned long long)(process_tag & 0xffffffffu), (unsigned)counter++);
+    std::string tmp = path + suffix;
+
+    AsyncFile f;
+    if (!f.open(tmp)) return false;
+    bool ok = f.write(q.entry.data(), q.entry.size());
+    ok = f.close() && ok;
+    std::error_code ec;
+    if (ok) fs::rename(tmp, path, ec);
+    if (!ok || ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+void LevelCache::writer_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        pending_ready.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) return;   // stopping, everything written
+
+        // The front entry stays queued while it is written: load() still finds it
+        const PendingStore& q = pending.front();
+        lock.unlock();
+        bool ok = write_entry(q);
+        lock.lock();
+
+        bool over = false;
+        if (ok) {
+            totals.stores++;
+            totals.bytes += q.entry.size();
+            over = totals.bytes > limit;
+        }
+        pending.pop_front();
+        pending_done.notify_all();
+        if (over) {
+            lock.unlock();
+            evict();
+            lock.lock();
+        }
+    }
+}
+
+// Rescan the directory (other processes write to it too) and drop the least recently used
+// entries down to 3/4 of the limit, so eviction doesn't run again on the next store. The scan
+// runs unlocked: load() and store() don't wait for it.
+void LevelCache::evict() {
+    struct Entry { fs::file_time_type time; uint64_t size; fs::path path; };
+    std::vector<Entry> entries;
+    uint64_t total = 0, evicted = 0;
+    std::error_code ec;
+    for (fs::directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".arkc") continue;
+        std::error_code e;
+        Entry entry = { it->last_write_time(e), it->file_size(e), it->path() };
+        if (e) continue;
+        total += entry.size;
+        entries.push_back(entry);
+    }
+    if (total > limit) {
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+        for (const Entry& e : entries) {
+            if (total <= limit / 4 * 3) break;
+            if (fs::remove(e.path, ec)) {
+                total -= e.size;
+                evicted++;
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    totals.evictions += evicted;
+    totals.bytes = total;
+}
+
+LevelCacheStats LevelCache::stats() {
+    std::unique_lock<std::mutex> lock(mutex);
+    pending_done.wait(lock, [this] { return pending.empty(); });
+    return totals;
+}
+
+
+
+void generate_level_cached(LevelCache* cache, int generator, const LevelGenParams& p, LevelData& out, unsigned threads) {
+    if (!cache || !cache->is_open()) {
+        generate_level(generator, p, out, threads);
+        return;
+    }
+    LevelCacheKey key = level_cache_key(generator, p);
+    if (cache->load(key, out)) {
+        // The key has the generator's name; its index may differ between builds
+        out.generator = (uint32_t)std::max(0, std::min(level_generator_count() - 1, generator));
+        return;
+    }
+    generate_level(generator, p, out, threads);
+    cache->store(key, out);
+}
+
+static std::atomic<LevelCache*> game_level_cache{ nullptr };
+
+void set_level_cache(LevelCache* cache) { game_level_cache.store(cache); }
+LevelCache* level_cache() { return game_level_cache.load(std::memory_order_relaxed); }
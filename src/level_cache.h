@@ -0,0 +1,100 @@
+#pragma once
+
+#include "levelgen.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// On-disk cache of generated levels, content-addressed: an entry's name is the hash of what
+// the generator's output depends on (generator name and version, the generation parameters
+// derived from ArkanoidSettings, seed), so a changed generator or setting can never hit a stale
+// level. An entry is a small header followed by the level pack image (levelgen.h), read (mapped
+// when big) on load; the header repeats the full key and carries a checksum of the image, and an
+// entry that fails either check is deleted and regenerated.
+//
+// Entries are written to a temporary file and renamed into place, so several processes (batch
+// workers) can share one directory. A hit refreshes the entry's modification time; when the
+// directory grows over max_bytes the least recently used entries are removed.
+//
+// store() only encodes the entry and queues it: a writer thread writes it through the shared
+// async I/O engine, publishes it and runs eviction, so a level built on the game thread never
+// waits for the disk. load() sees queued entries before they reach the directory.
+
+// Everything a generated level depends on; stored in the entry and compared on load
+struct LevelCacheKey
+{
+    char generator[32] = {};
+    uint32_t generator_version = 0;
+    int32_t cols = 0, rows = 0;
+    uint32_t seed = 0;
+    float density = 0.0f, difficulty = 0.0f, bonus_chance = 0.0f;
+    uint32_t reserved = 0;
+
+    uint64_t hash() const;
+};
+
+static_assert(sizeof(LevelCacheKey) == 64, "LevelCacheKey is written to disk as is");
+
+LevelCacheKey level_cache_key(int generator, const LevelGenParams& p);
+
+struct LevelCacheStats
+{
+    uint64_t hits = 0, misses = 0, stores = 0, evictions = 0, corrupt = 0;
+    double load_us = 0.0;         // summed over hits
+    uint64_t bytes = 0;           // entries on disk
+};
+
+class LevelCache
+{
+public:
+    static constexpr size_t max_pending = 64;   // store() waits while this many entries are queued
+
+    LevelCache() = default;
+    LevelCache(const LevelCache&) = delete;
+    LevelCache& operator=(const LevelCache&) = delete;
+    ~LevelCache();
+
+    bool open(const std::string& dir, uint64_t max_bytes = 64ull << 20);   // creates the directory
+    bool is_open() const { return !root.empty(); }
+
+    bool load(const LevelCacheKey& key, LevelData& out);
+    bool store(const LevelCacheKey& key, const LevelData& level);   // queues the write
+
+    void flush();                 // wait until every queued entry is on disk
+    LevelCacheStats stats();      // waits for the queued stores
+
+private:
+    struct PendingStore
+    {
+        LevelCacheKey key;
+        std::vector<uint8_t> entry;   // header + pack image, as written
+    };
+
+    std::string entry_path(const LevelCacheKey& key) const;
+    bool write_entry(const PendingStore& s);
+    void writer_loop();
+    void evict();
+
+    std::string root;
+    uint64_t limit = 0;
+    std::mutex mutex;
+    LevelCacheStats totals;
+
+    // Queued stores; the front one stays queued (and visible to load()) until it is published
+    std::deque<PendingStore> pending;
+    std::condition_variable pending_ready;   // queued (or stopping)
+    std::condition_variable pending_done;    // published: room in the queue, flush() may return
+    std::thread writer;
+    bool stopping = false;
+};
+
+// generate_level() through a cache (null: just generate). A miss generates and stores the level.
+void generate_level_cached(LevelCache* cache, int generator, const LevelGenParams& p, LevelData& out, unsigned threads = 0);
+
+// Cache the game builds its levels through; null (the default) disables caching (--level-cache)
+void set_level_cache(LevelCache* cache);
+LevelCache* level_cache();
@@ -0,0 +1,190 @@
+#include "level_editor.h"
+#include "arkanoid_impl.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static const char* tool_names[(int)LevelEditor::Tool::Count] = { "Paint", "Erase", "Hit points", "Bonus", "Colour", "Script" };
+
+// The brick as the current tool leaves it
+LevelCell LevelEditor::apply_tool(const LevelCell& cell) const {
+    LevelCell c = cell;
+    switch (tool) {
+    case Tool::Paint:
+        c.hit_points = (uint8_t)brush_hit_points;
+        c.bonus = brush_bonus ? 1 : 0;
+        c.script = (uint8_t)brush_script;
+        c.color = ImGui::ColorConvertFloat4ToU32(brush_color);
+        break;
+    case Tool::Erase:
+        c.hit_points = 0;
+        break;
+    case Tool::HitPoints:
+        if (c.hit_points > 0) c.hit_points = (uint8_t)brush_hit_points;
+        break;
+    case Tool::Bonus:
+        if (c.hit_points > 0) c.bonus = brush_bonus ? 1 : 0;
+        break;
+    case Tool::Color:
+        if (c.hit_points > 0) c.color = ImGui::ColorConvertFloat4ToU32(brush_color);
+        break;
+    case Tool::Script:
+        if (c.hit_points > 0) c.script = (uint8_t)brush_script;
+        break;
+    default:
+        break;
+    }
+    return c;
+}
+
+// Apply the tool to one cell as part of the open stroke
+void LevelEditor::edit_cell(ArkanoidImpl& game, int index) {
+    EditCommand cmd;
+    cmd.cell = (uint32_t)index;
+    cmd.before = game.brick_cell(index);
+    cmd.after = apply_tool(cmd.before);
+    if (memcmp(&cmd.before, &cmd.after, sizeof(LevelCell)) == 0) return;
+
+    if (!stroking) {
+        // A new stroke drops whatever could have been redone
+        if (applied_strokes < strokes.size()) {
+            log.resize(strokes[applied_strokes]);
+            strokes.resize(applied_strokes);
+        }
+        strokes.push_back((uint32_t)log.size());
+        applied_strokes = strokes.size();
+        stroking = true;
+    }
+    log.push_back(cmd);
+    game.set_brick_cell(index, cmd.after);
+}
+
+bool LevelEditor::undo(ArkanoidImpl& game) {
+    if (applied_strokes == 0) return false;
+    size_t begin = strokes[applied_strokes - 1];
+    size_t end = applied_strokes < strokes.size() ? strokes[applied_strokes] : log.size();
+    for (size_t i = end; i-- > begin;) game.set_brick_cell((int)log[i].cell, log[i].before);
+    applied_strokes--;
+    return true;
+}
+
+bool LevelEditor::redo(ArkanoidImpl& game) {
+    if (applied_strokes == strokes.size()) return false;
+    size_t begin = strokes[applied_strokes];
+    size_t end = applied_strokes + 1 < strokes.size() ? strokes[applied_strokes + 1] : log.size();
+    for (size_t i = begin; i < end; ++i) game.set_brick_cell((int)log[i].cell, log[i].after);
+    applied_strokes++;
+    return true;
+}
+
+void LevelEditor::clear_history() {
+    log.clear();
+    strokes.clear();
+    applied_strokes = 0;
+    stroking = false;
+    last_cell = -1;
+}
+
+void LevelEditor::draw(ArkanoidImpl& game, ImGuiIO& io, ImDrawList& dl) {
+    if (!open) {
+        if (paused_game) { game.set_paused(false); paused_game = false; }
+        stroking = false;
+        return;
+    }
+
+    // The world holds still while it is edited
+    if (!game.is_paused()) { game.set_paused(true); paused_game = true; }
+
+    draw_window(game);
+
+    // Shortcuts (unless a text field has the keyboard)
+    if (!io.WantTextInput && io.KeyCtrl) {
+        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Z))) io.KeyShift ? redo(game) : undo(game);
+        if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Y))) redo(game);
+    }
+
+    // Mouse editing over the world; clicks on ImGui windows are theirs
+    if (!ImGui::IsMouseDown(ImGuiMouseButton_Left)) { stroking = false; last_cell = -1; }
+    if (io.WantCaptureMouse) return;
+
+    int cell = game.brick_at(game.screen_to_world(io.MousePos));
+    if (cell < 0) { last_cell = -1; return; }
+
+    if (ImGui::IsMouseDown(ImGuiMouseButton_Left) && cell != last_cell) edit_cell(game, cell);
+    if (ImGui::IsMouseDown(ImGuiMouseButton_Left)) last_cell = cell;
+
+    Rect r = game.brick_rect(cell);
+    ImVec2 p0 = game.world_to_screen(r.pos);
+    ImVec2 p1 = game.world_to_screen(r.pos + r.size);
+    dl.AddRect(ImVec2(p0.x - 2, p0.y - 2), ImVec2(p1.x + 2, p1.y + 2), IM_COL32(255, 255, 255, 220), 4.0f, ImDrawCornerFlags_All, 2.0f);
+}
+
+void LevelEditor::draw_window(ArkanoidImpl& game) {
+    ImGui::SetNextWindowSize(ImVec2(300, 0), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Level Editor", &open)) { ImGui::End(); return; }
+
+    int t = (int)tool;
+    for (int i = 0; i < (int)Tool::Count; ++i) {
+        if (i) ImGui::SameLine();
+        ImGui::RadioButton(tool_names[i], &t, i);
+    }
+    tool = (Tool)t;
+
+    ImGui::SliderInt("Hit points", &brush_hit_points, 1, 3);
+    ImGui::Checkbox("Bonus", &brush_bonus);
+    ImGui::ColorEdit3("Colour", &brush_color.x);
+    if (ImGui::BeginCombo("Script", brick_script_name(brush_script))) {
+        for (int i = 0; i < (int)BrickScriptType::Count; ++i)
+            if (ImGui::Selectable(brick_script_name(i), i == brush_script)) brush_script = i;
+        ImGui::EndCombo();
+    }
+
+    ImGui::Separator();
+
+    bool can_undo = applied_strokes > 0, can_redo = applied_strokes < strokes.size();
+    if (ImGui::Button("Undo") && can_undo) undo(game);
+    ImGui::SameLine();
+    if (ImGui::Button("Redo") && can_redo) redo(game);
+    ImGui::SameLine();
+    ImGui::TextDisabled("%zu/%zu strokes, %zu edits", applied_strokes, strokes.size(), log.size());
+
+    ImGui::Separator();
+
+    // Level pack I/O: save puts the current layout at the level index of the pack (appended past
+    // its end, a new pack if there is none) and keeps the pack's other levels
+    ImGui::InputText("Pack", pack_path, sizeof(pack_path));
+    ImGui::InputInt("Level", &pack_index);
+    pack_index = std::max(0, pack_index);
+    if (ImGui::Button("Save")) {
+        std::vector<LevelData> levels;
+        FILE* existing = fopen(pack_path, "rb");
+        bool readable = !existing || load_level_pack(pack_path, levels);
+        if (existing) fclose(existing);
+        if (!readable) status = "pack unreadable, not overwritten";
+        else {
+            if (pack_index >= (int)levels.size()) {
+                pack_index = (int)levels.size();
+                levels.emplace_back();
+            }
+            game.level_snapshot(levels[pack_index]);
+            status = save_level_pack(pack_path, levels) ? "saved" : "save failed";
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Load")) {
+        std::vector<LevelData> levels;
+        if (!load_level_pack(pack_path, levels)) status = "load failed";
+        else if (pack_index >= (int)levels.size()) status = "no such level";
+        else if (levels[pack_index].cols < ArkanoidSettings::bricks_columns_min || levels[pack_index].cols > ArkanoidSettings::bricks_columns_max ||
+                 levels[pack_index].rows < ArkanoidSettings::bricks_rows_min || levels[pack_index].rows > ArkanoidSettings::bricks_rows_max)
+            status = "unsupported level size";
+        else {
+            game.load_level(levels[pack_index], game.current_settings());
+            game.keep_level_on_restart();
+            status = "loaded";
+        }
+    }
+    if (!status.empty()) { ImGui::SameLine(); ImGui::TextUnformatted(status.c_str()); }
+
+    ImGui::End();
+}
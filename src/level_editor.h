@@ -0,0 +1,58 @@
+#pragma once
+
+#include "base.h"
+#include "levelgen.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ArkanoidImpl;
+
+// One brick change: the cell index with its state before and after (20 bytes)
+struct EditCommand
+{
+    uint32_t cell;
+    LevelCell before;
+    LevelCell after;
+};
+
+// Designer tool for the running game (Debug menu -> Level Editor). Paints, erases and retouches
+// bricks with the mouse through ArkanoidImpl::set_brick_cell(), so every edit is O(1) and playable
+// at once. Edits go to a command log grouped into strokes (one mouse drag = one undo step);
+// undo/redo is unbounded and a new edit drops the redo tail.
+class LevelEditor
+{
+public:
+    enum class Tool { Paint, Erase, HitPoints, Bonus, Color, Script, Count };
+
+    bool open = false;
+
+    // Editor window, mouse editing over the world and the hovered-cell outline
+    void draw(ArkanoidImpl& game, ImGuiIO& io, ImDrawList& dl);
+
+    bool undo(ArkanoidImpl& game);
+    bool redo(ArkanoidImpl& game);
+    void clear_history();
+
+private:
+    LevelCell apply_tool(const LevelCell& cell) const;
+    void edit_cell(ArkanoidImpl& game, int index);
+    void draw_window(ArkanoidImpl& game);
+
+    Tool tool = Tool::Paint;
+    int brush_hit_points = 1;
+    bool brush_bonus = false;
+    int brush_script = 0;            // BrickScriptType
+    ImVec4 brush_color = ImVec4(0.35f, 0.65f, 0.95f, 1.0f);
+
+    std::vector<EditCommand> log;
+    std::vector<uint32_t> strokes;   // log index where each stroke starts
+    size_t applied_strokes = 0;      // strokes [0, applied) are in effect, the rest can be redone
+    bool stroking = false;
+    int last_cell = -1;              // a drag edits each cell once per visit
+    bool paused_game = false;        // the editor paused the game and resumes it on close
+
+    char pack_path[256] = "edited.arkpack";
+    int pack_index = 0;
+    std::string status;
+};
@@ -0,0 +1,224 @@
+#include "level_estimator.h"
+#include "autopilot.h"
+#include "headless.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Result of a single autopilot game
+struct GameOutcome
+{
+    bool cleared = false;
+    float time = 0.0f;
+    int lives_lost = 0;
+    int money = 0;
+    std::vector<float> destroy_time;   // per brick, < 0 = never destroyed
+};
+
+static void play_game(const LevelData& level, const ArkanoidSettings& settings, const EstimateConfig& cfg, uint32_t seed, GameOutcome& out) {
+    HeadlessSim sim(settings);
+    ArkanoidImpl& game = sim.game();
+    game.load_level(level, settings);
+    game.reseed(seed);
+    Autopilot pilot(seed);
+
+    out.destroy_time.assign((size_t)game.brick_count(), -1.0f);
+    std::vector<char> alive((size_t)game.brick_count());
+    for (int i = 0; i < game.brick_count(); ++i) alive[i] = game.brick_alive(i);
+
+    ArkanoidImpl::Observation o;
+    game.observe(o);
+    int prev_lives = o.lives;
+    int prev_destroyed = o.destroyed_bricks;
+
+    const int max_frames = (int)(cfg.max_time / cfg.dt);
+    float t = 0.0f;
+    for (int f = 0; f < max_frames && o.playing; ++f) {
+        sim.step(cfg.dt, pilot.keys(o));
+        t += cfg.dt;
+        game.observe(o);
+
+        if (o.lives < prev_lives) out.lives_lost += prev_lives - o.lives;
+        prev_lives = o.lives;
+
+        // Only rescan bricks on frames where something was destroyed
+        if (o.destroyed_bricks != prev_destroyed) {
+            for (int i = 0; i < game.brick_count(); ++i) {
+                if (alive[i] && !game.brick_alive(i)) { alive[i] = 0; out.destroy_time[i] = t; }
+            }
+            prev_destroyed = o.destroyed_bricks;
+        }
+    }
+
+    out.cleared = o.won;
+    out.time = t;
+    out.money = o.total_money;
+}
+
+static float percentile(const std::vector<float>& sorted, float p) {
+    if (sorted.empty()) return 0.0f;
+    size_t i = (size_t)(p * (sorted.size() - 1) + 0.5f);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+void estimate_level(const LevelData& level, const ArkanoidSettings& settings, const EstimateConfig& cfg, LevelEstimate& out) {
+    std::vector<GameOutcome> games((size_t)std::max(1, cfg.games));
+    parallel_for(games.size(), cfg.threads, [&](size_t i) {
+        play_game(level, settings, cfg, cfg.first_seed + (uint32_t)i, games[i]);
+    });
+
+    out = LevelEstimate();
+    out.games = (int)games.size();
+    for (const auto& c : level.cells) if (c.hit_points > 0) out.bricks++;
+
+    std::vector<float> clear_times;
+    for (const auto& g : games) {
+        if (g.cleared) { out.cleared++; clear_times.push_back(g.time); }
+        out.avg_lives_lost += g.lives_lost;
+        out.avg_money += g.money;
+    }
+    out.avg_lives_lost /= out.games;
+    out.avg_money /= out.games;
+
+    std::sort(clear_times.begin(), clear_times.end());
+    if (!clear_times.empty()) {
+        out.clear_time_min = clear_times.front();
+        out.clear_time_p10 = percentile(clear_times, 0.1f);
+        out.clear_time_p50 = percentile(clear_times, 0.5f);
+        out.clear_time_p90 = percentile(clear_times, 0.9f);
+        out.clear_time_max = clear_times.back();
+    }
+
+    // Bricks that survive most often (then take longest) are the hard-to-reach ones
+    std::vector<LevelEstimate::HardBrick> bricks;
+    for (int r = 0; r < level.rows; ++r) {
+        for (int c = 0; c < level.cols; ++c) {
+            if (level.at(r, c).hit_points == 0) continue;
+            size_t i = (size_t)r * level.cols + c;
+            int survived = 0, destroyed = 0;
+            float sum_time = 0.0f;
+            for (const auto& g : games) {
+                if (g.destroy_time[i] < 0.0f) survived++;
+                else { destroyed++; sum_time += g.destroy_time[i]; }
+            }
+            bricks.push_back({ r, c, (float)survived / out.games, destroyed ? sum_time / destroyed : 0.0f });
+        }
+    }
+    std::sort(bricks.begin(), bricks.end(), [](const LevelEstimate::HardBrick& a, const LevelEstimate::HardBrick& b) {
+        return a.survive_rate != b.survive_rate ? a.survive_rate > b.survive_rate : a.mean_time > b.mean_time;
+    });
+    bricks.resize(std::min<size_t>(bricks.size(), 5));
+    out.hard_bricks = bricks;
+
+    // Unfinished games dominate, then typical clear time, then lives lost
+    float clear_rate = (float)out.cleared / out.games;
+    float typical_time = out.cleared ? out.clear_time_p50 : cfg.max_time;
+    out.difficulty = (1.0f - clear_rate) * 100.0f + typical_time / cfg.max_time * 50.0f + out.avg_lives_lost * 5.0f;
+}
+
+
+
+// ----------------- Tool -----------------
+
+static void print_estimate(int index, const LevelData& level, const LevelEstimate& e) {
+    printf("level %d (%s, seed %u, %dx%d, %d bricks): cleared %d/%d (%.1f%%), difficulty %.1f\n",
+        index, level_generator((int)level.generator).name(), level.seed, level.cols, level.rows, e.bricks,
+        e.cleared, e.games, 100.0f * e.cleared / e.games, e.difficulty);
+    if (e.cleared)
+        printf("  clear time  min %.1fs  p10 %.1fs  p50 %.1fs  p90 %.1fs  max %.1fs\n",
+            e.clear_time_min, e.clear_time_p10, e.clear_time_p50, e.clear_time_p90, e.clear_time_max);
+    printf("  lives lost  %.2f avg   money  $%.1f avg\n", e.avg_lives_lost, e.avg_money);
+    printf("  hard bricks (row,col survived mean-time):");
+    for (const auto& b : e.hard_bricks) printf("  (%d,%d %.0f%% %.1fs)", b.row, b.col, b.survive_rate * 100.0f, b.mean_time);
+    printf("\n");
+}
+
+int run_estimate_tool(int argc, char** argv) {
+    EstimateConfig cfg;
+    ArkanoidSettings settings;
+    const char* pack_path = nullptr;
+    const char* csv_path = nullptr;
+
+    for (int i = 0; i < argc; ++i) {
+        const char* a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(a, "--pack") == 0 && has_value) pack_path = argv[++i];
+        else if (strcmp(a, "--csv") == 0 && has_value) csv_path = argv[++i];
+        else if (strcmp(a, "--games") == 0 && has_value) cfg.games = atoi(argv[++i]);
+        else if (strcmp(a, "--max-time") == 0 && has_value) cfg.max_time = (float)atof(argv[++i]);
+        else if (strcmp(a, "--threads") == 0 && has_value) cfg.threads = (unsigned)atoi(argv[++i]);
+        else if (strcmp(a, "--generator") == 0 && has_value) settings.level_generator = std::max(0, find_level_generator(argv[++i]));
+        else if (strcmp(a, "--seed") == 0 && has_value) settings.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(a, "--cols") == 0 && has_value) settings.bricks_columns_count = atoi(argv[++i]);
+        else if (strcmp(a, "--rows") == 0 && has_value) settings.bricks_rows_count = atoi(argv[++i]);
+        else if (strcmp(a, "--density") == 0 && has_value) settings.level_density = (float)atof(argv[++i]);
+        else if (strcmp(a, "--difficulty") == 0 && has_value) settings.level_difficulty = (float)atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: --estimate [--pack file.arkpack | --generator G --seed S --cols C --rows R --density D --difficulty D]\n"
+                            "                  [--games N] [--max-time S] [--threads N] [--csv out.csv]\n");
+            return 2;
+        }
+    }
+
+    std::vector<LevelData> levels;
+    if (pack_path) {
+        if (!load_level_pack(pack_path, levels)) {
+            fprintf(stderr, "Cannot read level pack %s\n", pack_path);
+            return 1;
+        }
+    }
+    else {
+        // Same level build_level() would produce for these settings
+        LevelGenParams p;
+        p.cols = std::max(ArkanoidSettings::bricks_columns_min, std::min(ArkanoidSettings::bricks_columns_max, settings.bricks_columns_count));
+        p.rows = std::max(ArkanoidSettings::bricks_rows_min, std::min(ArkanoidSettings::bricks_rows_max, settings.bricks_rows_count));
+        p.seed = settings.seed;
+        p.density = settings.level_density;
+        p.difficulty = settings.level_difficulty;
+        levels.resize(1);
+        generate_level(settings.level_generator, p, levels[0]);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<LevelEstimate> estimates(levels.size());
+    for (size_t i = 0; i < levels.size(); ++i) {
+        estimate_level(levels[i], settings, cfg, estimates[i]);
+        print_estimate((int)i, levels[i], estimates[i]);
+        fflush(stdout);
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // Ranking, hardest first
+    std::vector<size_t> order(levels.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return estimates[a].difficulty > estimates[b].difficulty; });
+
+    if (levels.size() > 1) {
+        printf("\nranking (hardest first):\n");
+        for (size_t k = 0; k < order.size(); ++k) {
+            const LevelEstimate& e = estimates[order[k]];
+            printf("  %4zu. level %zu  difficulty %.1f  cleared %.0f%%  p50 %.1fs\n",
+                k + 1, order[k], e.difficulty, 100.0f * e.cleared / e.games, e.clear_time_p50);
+        }
+    }
+    printf("%zu levels x %d games in %.1f s\n", levels.size(), cfg.games, sec);
+
+    if (csv_path) {
+        FILE* f = fopen(csv_path, "w");
+        if (!f) { fprintf(stderr, "Cannot write %s\n", csv_path); return 1; }
+        fprintf(f, "rank,level,generator,seed,cols,rows,bricks,games,cleared,clear_p10,clear_p50,clear_p90,lives_lost,money,difficulty\n");
+        for (size_t k = 0; k < order.size(); ++k) {
+            const LevelData& l = levels[order[k]];
+            const LevelEstimate& e = estimates[order[k]];
+            fprintf(f, "%zu,%zu,%s,%u,%d,%d,%d,%d,%d,%.2f,%.2f,%.2f,%.3f,%.2f,%.2f\n",
+                k + 1, order[k], level_generator((int)l.generator).name(), l.seed, l.cols, l.rows, e.bricks, e.games, e.cleared,
+                e.clear_time_p10, e.clear_time_p50, e.clear_time_p90, e.avg_lives_lost, e.avg_money, e.difficulty);
+        }
+        fclose(f);
+    }
+    return 0;
+}
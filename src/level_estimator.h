@@ -0,0 +1,40 @@
+#pragma once
+
+#include "arkanoid.h"
+#include "levelgen.h"
+#include <vector>
+
+struct EstimateConfig
+{
+    int games = 200;               // autopilot games per level
+    float max_time = 900.0f;       // seconds of game time before a game counts as not cleared
+    float dt = 1.0f / 60.0f;
+    uint32_t first_seed = 1;       // game i uses first_seed + i
+    unsigned threads = 0;          // 0 = all cores
+};
+
+struct LevelEstimate
+{
+    struct HardBrick
+    {
+        int row, col;
+        float survive_rate;        // share of games that ended with this brick alive
+        float mean_time;           // mean destroy time in games where it was destroyed
+    };
+
+    int bricks = 0;
+    int games = 0;
+    int cleared = 0;
+    float clear_time_min = 0.0f, clear_time_p10 = 0.0f, clear_time_p50 = 0.0f, clear_time_p90 = 0.0f, clear_time_max = 0.0f;
+    float avg_lives_lost = 0.0f;
+    float avg_money = 0.0f;
+    std::vector<HardBrick> hard_bricks;   // hardest first, at most 5
+    float difficulty = 0.0f;              // ranking score, higher = harder
+};
+
+// Play cfg.games autopilot games on the level (in parallel) and summarize them
+void estimate_level(const LevelData& level, const ArkanoidSettings& settings, const EstimateConfig& cfg, LevelEstimate& out);
+
+// --estimate [--pack file.arkpack | --generator G --seed S --cols C --rows R ...] [--games N] [--max-time S]
+//            [--threads N] [--csv out.csv]
+int run_estimate_tool(int argc, char** argv);
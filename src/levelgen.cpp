@@ -0,0 +1,458 @@
+#include "levelgen.h"
+#include "level_cache.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// ----------------- Helpers -----------------
+
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27; x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// Counter-based random number in [0, 1) for one cell: no state, so rows can be generated in any order
+static inline float cell_random(uint32_t seed, uint32_t salt, int r, int c) {
+    uint64_t h = mix64((uint64_t)seed * 0x9e3779b97f4a7c15ull + salt);
+    h = mix64(h ^ (((uint64_t)(uint32_t)r << 32) | (uint32_t)c));
+    return (float)(h >> 40) * (1.0f / 16777216.0f);
+}
+
+ImU32 level_row_color(int row, int rows) {
+    return IM_COL32(140 + (int)(90.0f * row / std::max(1, rows - 1)), 180, 230, 255);
+}
+
+ImU32 level_bonus_color() {
+    return IM_COL32(255, 200, 80, 255);
+}
+
+// Difficulty curve: top rows are harder, difficulty 0 gives single-hit bricks only
+static inline uint8_t pick_hit_points(float u, const LevelGenParams& p, int r) {
+    float t = (p.rows > 1) ? 1.0f - (float)r / (float)(p.rows - 1) : 1.0f;
+    float h = std::max(0.0f, std::min(1.0f, p.difficulty)) * (0.4f + 0.6f * t);
+    if (u < 0.3f * h) return 3;
+    if (u < 0.9f * h) return 2;
+    return 1;
+}
+
+// Fill a brick cell with hit points, bonus flag and color from per-cell randomness
+static inline void fill_brick(LevelCell& cell, const LevelGenParams& p, int r, float hp_u, float bonus_u) {
+    cell.hit_points = pick_hit_points(hp_u, p, r);
+    cell.bonus = bonus_u < p.bonus_chance ? 1 : 0;
+    cell.color = cell.bonus ? level_bonus_color() : level_row_color(r, p.rows);
+}
+
+
+
+// ----------------- Generators -----------------
+
+// Original layout: full grid, sequential mt19937, 15% bonuses, 5%/20% for 3/2 HP.
+// Cells depend on generation order, so the whole level is always produced by one thread.
+class ClassicLevelGenerator : public LevelGenerator
+{
+public:
+    const char* name() const override { return "classic"; }
+    uint32_t version() const override { return 1; }
+    bool supports_bands() const override { return false; }
+
+    void generate_rows(const LevelGenParams& p, LevelData& out, int row_begin, int row_end) const override {
+        std::mt19937 rng(p.seed);
+        std::uniform_real_distribution<float> unif(0.0f, 1.0f);
+        std::uniform_int_distribution<int> hpDist(0, 99);
+
+        for (int r = 0; r < row_end; ++r) {
+            for (int c = 0; c < p.cols; ++c) {
+                float u = unif(rng);
+                int rnd = hpDist(rng);
+                if (r < row_begin) continue;
+
+                LevelCell& cell = out.at(r, c);
+                cell.bonus = (u < p.bonus_chance) ? 1 : 0;
+                cell.color = cell.bonus ? level_bonus_color() : level_row_color(r, p.rows);
+                cell.hit_points = (rnd < 5) ? 3 : (rnd < 25) ? 2 : 1;
+            }
+        }
+    }
+};
+
+// Fractal value noise: filled where the field is below the density threshold,
+// so bricks form organic clusters with holes between them
+class NoiseLevelGenerator : public LevelGenerator
+{
+public:
+    const char* name() const override { return "noise"; }
+    uint32_t version() const override { return 1; }
+
+    void generate_rows(const LevelGenParams& p, LevelData& out, int row_begin, int row_end) const override {
+        for (int r = row_begin; r < row_end; ++r) {
+            for (int c = 0; c < p.cols; ++c) {
+                float v = fbm(p.seed, (float)c, (float)r);
+                v = std::max(0.0f, std::min(1.0f, (v - 0.5f) * 2.2f + 0.5f));   // spread towards [0, 1]
+                LevelCell& cell = out.at(r, c);
+                if (v >= p.density) { cell = LevelCell(); continue; }
+                fill_brick(cell, p, r, cell_random(p.seed, 1, r, c), cell_random(p.seed, 2, r, c));
+            }
+        }
+    }
+
+private:
+    static float smooth(float t) { return t * t * (3.0f - 2.0f * t); }
+
+    static float value_noise(uint32_t seed, uint32_t octave, float x, float y) {
+        int xi = (int)std::floor(x), yi = (int)std::floor(y);
+        float tx = smooth(x - xi), ty = smooth(y - yi);
+        float a = cell_random(seed, 16 + octave, yi, xi);
+        float b = cell_random(seed, 16 + octave, yi, xi + 1);
+        float c = cell_random(seed, 16 + octave, yi + 1, xi);
+        float d = cell_random(seed, 16 + octave, yi + 1, xi + 1);
+        return (a + (b - a) * tx) + ((c + (d - c) * tx) - (a + (b - a) * tx)) * ty;
+    }
+
+    static float fbm(uint32_t seed, float x, float y) {
+        float sum = 0.0f, amp = 0.5f, freq = 1.0f / 6.0f, norm = 0.0f;
+        for (uint32_t o = 0; o < 3; ++o) {
+            sum += value_noise(seed, o, x * freq, y * freq) * amp;
+            norm += amp;
+            amp *= 0.5f;
+            freq *= 2.0f;
+        }
+        return sum / norm;
+    }
+};
+
+// Left-right mirrored pattern: every cell copies the decision of its mirror cell
+class SymmetricLevelGenerator : public LevelGenerator
+{
+public:
+    const char* name() const override { return "symmetric"; }
+    uint32_t version() const override { return 1; }
+
+    void generate_rows(const LevelGenParams& p, LevelData& out, int row_begin, int row_end) const override {
+        for (int r = row_begin; r < row_end; ++r) {
+            for (int c = 0; c < p.cols; ++c) {
+                int m = std::min(c, p.cols - 1 - c);
+                LevelCell& cell = out.at(r, c);
+                if (cell_random(p.seed, 3, r, m) >= p.density) { cell = LevelCell(); continue; }
+                fill_brick(cell, p, r, cell_random(p.seed, 4, r, m), cell_random(p.seed, 5, r, m));
+            }
+        }
+    }
+};
+
+// Binary-tree maze: maze cells sit on even (row, col), walls are bricks.
+// Every maze cell opens either north or east on its own coin flip, so rows stay independent.
+class MazeLevelGenerator : public LevelGenerator
+{
+public:
+    const char* name() const override { return "maze"; }
+    uint32_t version() const override { return 1; }
+
+    void generate_rows(const LevelGenParams& p, LevelData& out, int row_begin, int row_end) const override {
+        for (int r = row_begin; r < row_end; ++r) {
+            for (int c = 0; c < p.cols; ++c) {
+                LevelCell& cell = out.at(r, c);
+                if (is_passage(p, r, c)) { cell = LevelCell(); continue; }
+                fill_brick(cell, p, r, cell_random(p.seed, 6, r, c), cell_random(p.seed, 7, r, c));
+            }
+        }
+    }
+
+private:
+    // true = carve north, false = carve east (edges of the maze force the other direction)
+    static bool opens_north(const LevelGenParams& p, int mr, int mc) {
+        int maze_cols = (p.cols + 1) / 2;
+        if (mr == 0) return false;
+        if (mc == maze_cols - 1) return true;
+        return cell_random(p.seed, 8, mr, mc) < 0.5f;
+    }
+
+    static bool is_passage(const LevelGenParams& p, int r, int c) {
+        bool even_r = (r % 2) == 0, even_c = (c % 2) == 0;
+        if (even_r && even_c) return true;                                  // maze cell
+        if (even_r) return !opens_north(p, r / 2, c / 2);                   // wall between (r, c-1) and (r, c+1)
+        if (even_c) return opens_north(p, (r + 1) / 2, c / 2);              // wall between (r-1, c) and (r+1, c)
+        return false;                                                       // corner post
+    }
+};
+
+// Showcase for scripted bricks (brick_script.h): a scattered grid where some bricks blink,
+// regenerate, call in reinforcements or patrol their row. Regenerating bricks get at least 2 HP.
+class ScriptedLevelGenerator : public LevelGenerator
+{
+public:
+    const char* name() const override { return "scripted"; }
+    uint32_t version() const override { return 1; }
+
+    void generate_rows(const LevelGenParams& p, LevelData& out, int row_begin, int row_end) const override {
+        for (int r = row_begin; r < row_end; ++r) {
+            for (int c = 0; c < p.cols; ++c) {
+                LevelCell& cell = out.at(r, c);
+                if (cell_random(p.seed, 9, r, c) >= p.density) { cell = LevelCell(); continue; }
+                fill_brick(cell, p, r, cell_random(p.seed, 10, r, c), cell_random(p.seed, 11, r, c));
+                float u = cell_random(p.seed, 12, r, c);
+                cell.script = u < 0.15f ? 1 : u < 0.30f ? 2 : u < 0.36f ? 3 : u < 0.50f ? 4 : 0;
+                if (cell.script == 2) cell.hit_points = std::max<uint8_t>(cell.hit_points, 2);
+            }
+        }
+    }
+};
+
+static const ClassicLevelGenerator classic_generator;
+static const NoiseLevelGenerator noise_generator;
+static const SymmetricLevelGenerator symmetric_generator;
+static const MazeLevelGenerator maze_generator;
+static const ScriptedLevelGenerator scripted_generator;
+
+static const LevelGenerator* const generators[] = {
+    &classic_generator, &noise_generator, &symmetric_generator, &maze_generator, &scripted_generator,
+};
+
+int level_generator_count() {
+    return (int)(sizeof(generators) / sizeof(generators[0]));
+}
+
+const LevelGenerator& level_generator(int index) {
+    return *generators[std::max(0, std::min(level_generator_count() - 1, index))];
+}
+
+int find_level_generator(const char* name) {
+    for (int i = 0; i < level_generator_count(); ++i)
+        if (strcmp(generators[i]->name(), name) == 0) return i;
+    return -1;
+}
+
+
+
+// ----------------- Generation -----------------
+
+void generate_level(int generator, const LevelGenParams& p, LevelData& out, unsigned threads) {
+    const LevelGenerator& gen = level_generator(generator);
+    out.cols = p.cols;
+    out.rows = p.rows;
+    out.seed = p.seed;
+    out.generator = (uint32_t)std::max(0, std::min(level_generator_count() - 1, generator));
+    out.cells.assign((size_t)p.cols * p.rows, LevelCell());
+
+    // Bands of ~16K cells: small levels stay on the calling thread
+    const size_t band_cells = 16384;
+    if (!gen.supports_bands() || out.cells.size() <= band_cells || threads == 1) {
+        gen.generate_rows(p, out, 0, p.rows);
+        return;
+    }
+
+    int band_rows = std::max(1, (int)(band_cells / std::max(1, p.cols)));
+    int bands = (p.rows + band_rows - 1) / band_rows;
+    parallel_for((size_t)bands, threads, [&](size_t b) {
+        int r0 = (int)b * band_rows;
+        gen.generate_rows(p, out, r0, std::min(p.rows, r0 + band_rows));
+    });
+}
+
+void generate_level_batch(int generator, const LevelGenParams& p, int count, std::vector<LevelData>& out, unsigned threads,
+    LevelCache* cache) {
+    out.resize((size_t)std::max(0, count));
+    parallel_for(out.size(), threads, [&](size_t i) {
+        LevelGenParams lp = p;
+        lp.seed = p.seed + (uint32_t)i;
+        generate_level_cached(cache, generator, lp, out[i], 1);
+    });
+}
+
+
+
+// ----------------- Level Pack IO -----------------
+
+// Layout: header, table of entries, then 8-byte aligned cell arrays (LevelCell as-is)
+struct LevelPackHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t level_count;
+    uint32_t reserved;
+};
+
+struct LevelPackEntry
+{
+    uint64_t offset;      // of the first cell, from file start
+    uint32_t cols;
+    uint32_t rows;
+    uint32_t seed;
+    uint32_t generator;
+};
+
+static const char level_pack_magic[4] = { 'A', 'R', 'K', 'L' };
+static const uint32_t level_pack_version = 1;
+// Anything past these is a damaged file, not a level
+static const uint32_t level_pack_max_levels = 1u << 16;
+static const uint32_t level_pack_max_side = 1024;
+
+void encode_level_pack(const std::vector<LevelData>& levels, std::vector<uint8_t>& out) {
+    uint64_t offset = sizeof(LevelPackHeader) + sizeof(LevelPackEntry) * levels.size();
+    size_t total = (size_t)offset;
+    for (const auto& l : levels) total += l.cells.size() * sizeof(LevelCell);
+    out.resize(total);
+    uint8_t* p = out.data();
+
+    LevelPackHeader h;
+    memcpy(h.magic, level_pack_magic, 4);
+    h.version = level_pack_version;
+    h.level_count = (uint32_t)levels.size();
+    h.reserved = 0;
+    memcpy(p, &h, sizeof(h));
+    p += sizeof(h);
+
+    for (const auto& l : levels) {
+        LevelPackEntry e = { offset, (uint32_t)l.cols, (uint32_t)l.rows, l.seed, l.generator };
+        memcpy(p, &e, sizeof(e));
+        p += sizeof(e);
+        offset += l.cells.size() * sizeof(LevelCell);
+    }
+    for (const auto& l : levels) {
+        if (!l.cells.empty()) memcpy(p, l.cells.data(), l.cells.size() * sizeof(LevelCell));
+        p += l.cells.size() * sizeof(LevelCell);
+    }
+}
+
+bool decode_level_pack(const uint8_t* data, size_t size, std::vector<LevelData>& levels) {
+    LevelPackHeader h;
+    bool ok = size >= sizeof(h);
+    if (ok) memcpy(&h, data, sizeof(h));
+    ok = ok && memcmp(h.magic, level_pack_magic, 4) == 0 && h.version == level_pack_version &&
+        h.level_count <= level_pack_max_levels && (size - sizeof(h)) / sizeof(LevelPackEntry) >= h.level_count;
+    if (!ok) {
+        levels.clear();
+        return false;
+    }
+
+    // Levels already in 'levels' are reused (their cells keep their capacity)
+    levels.resize(h.level_count);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        LevelPackEntry e;
+        memcpy(&e, data + sizeof(h) + i * sizeof(LevelPackEntry), sizeof(e));
+        uint64_t bytes = (uint64_t)e.cols * e.rows * sizeof(LevelCell);
+        if (e.cols > level_pack_max_side || e.rows > level_pack_max_side || e.offset > size || bytes > size - e.offset) {
+            levels.clear();
+            return false;
+        }
+        LevelData& l = levels[i];
+        l.cols = (int)e.cols;
+        l.rows = (int)e.rows;
+        l.seed = e.seed;
+        l.generator = e.generator;
+        l.cells.resize((size_t)e.cols * e.rows);
+        if (bytes) memcpy(l.cells.data(), data + e.offset, (size_t)bytes);
+    }
+    return true;
+}
+
+bool save_level_pack(const std::string& path, const std::vector<LevelData>& levels) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::vector<uint8_t> image;
+    encode_level_pack(levels, image);
+    bool ok = fwrite(image.data(), 1, image.size(), f) == image.size();
+    ok = fclose(f) == 0 && ok;
+    return ok;
+}
+
+bool load_level_pack(const std::string& path, std::vector<LevelData>& levels) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+
+    // Read it whole and decode that: the counts and offsets are checked against the real size
+    // before anything is sized by them
+    std::vector<uint8_t> image;
+    long size = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    bool ok = size >= 0 && fseek(f, 0, SEEK_SET) == 0;
+    if (ok) {
+        image.resize((size_t)size);
+        ok = image.empty() || fread(image.data(), 1, image.size(), f) == image.size();
+    }
+    fclose(f);
+
+    if (!ok) {
+        levels.clear();
+        return false;
+    }
+    return decode_level_pack(image.data(), image.size(), levels);
+}
+
+
+
+// ----------------- Batch Tool -----------------
+
+int run_levelgen_tool(int argc, char** argv) {
+    LevelGenParams p;
+    int generator = -1, count = 1;
+    unsigned threads = 0;
+    const char* out_path = nullptr;
+    const char* cache_dir = nullptr;
+
+    for (int i = 0; i < argc; ++i) {
+        const char* a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(a, "--count") == 0 && has_value) count = atoi(argv[++i]);
+        else if (strcmp(a, "--cols") == 0 && has_value) p.cols = atoi(argv[++i]);
+        else if (strcmp(a, "--rows") == 0 && has_value) p.rows = atoi(argv[++i]);
+        else if (strcmp(a, "--seed") == 0 && has_value) p.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(a, "--density") == 0 && has_value) p.density = (float)atof(argv[++i]);
+        else if (strcmp(a, "--difficulty") == 0 && has_value) p.difficulty = (float)atof(argv[++i]);
+        else if (strcmp(a, "--threads") == 0 && has_value) threads = (unsigned)atoi(argv[++i]);
+        else if (strcmp(a, "-o") == 0 && has_value) out_path = argv[++i];
+        else if (strcmp(a, "--cache") == 0 && has_value) cache_dir = argv[++i];
+        else generator = find_level_generator(a);
+    }
+
+    if (generator < 0 || !out_path || p.cols <= 0 || p.rows <= 0) {
+        fprintf(stderr, "usage: --levelgen <generator> [--count N] [--cols C] [--rows R] [--seed S]\n"
+                        "                  [--density D] [--difficulty D] [--threads N] [--cache DIR] -o <pack.arkpack>\n");
+        fprintf(stderr, "generators:");
+        for (int i = 0; i < level_generator_count(); ++i) fprintf(stderr, " %s", level_generator(i).name());
+        fprintf(stderr, "\n");
+        return 2;
+    }
+
+    LevelCache cache;
+    if (cache_dir && !cache.open(cache_dir)) {
+        fprintf(stderr, "Cannot use level cache %s\n", cache_dir);
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<LevelData> levels;
+    if (count == 1) {
+        // One (possibly huge) level: split its rows between threads instead
+        levels.resize(1);
+        generate_level_cached(&cache, generator, p, levels[0], threads);
+    }
+    else generate_level_batch(generator, p, count, levels, threads, &cache);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    size_t cells = 0, filled = 0;
+    for (const auto& l : levels) {
+        cells += l.cells.size();
+        for (const auto& c : l.cells) if (c.hit_points > 0) filled++;
+    }
+
+    if (!save_level_pack(out_path, levels)) {
+        fprintf(stderr, "Failed to write level pack %s\n", out_path);
+        return 1;
+    }
+    printf("%s: %d levels %dx%d, %.1f%% filled, %.1f ms (%.1f Mcells/s) -> %s\n",
+        level_generator(generator).name(), (int)levels.size(), p.cols, p.rows,
+        cells ? 100.0 * filled / cells : 0.0, ms, ms > 0.0 ? cells / ms / 1000.0 : 0.0, out_path);
+    if (cache.is_open()) {
+        LevelCacheStats cs = cache.stats();
+        printf("level cache %s: %llu hits (%.1f us avg), %llu misses, %llu evicted, %llu corrupt, %.1f MB\n", cache_dir,
+            (unsigned long long)cs.hits, cs.hits ? cs.load_us / cs.hits : 0.0, (unsigned long long)cs.misses,
+            (unsigned long long)cs.evictions, (unsigned long long)cs.corrupt, cs.bytes / (1024.0 * 1024.0));
+    }
+    return 0;
+}
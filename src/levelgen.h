@@ -0,0 +1,87 @@
+#pragma once
+
+#include "base.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One grid cell of a level. 8 bytes, stored as-is in level packs.
+struct LevelCell
+{
+    uint8_t hit_points = 0;   // 0 = empty cell, 1..3 = brick durability
+    uint8_t bonus = 0;        // 1 = spawns a bonus when destroyed
+    uint8_t script = 0;       // BrickScriptType the brick runs (brick_script.h), 0 = none
+    uint8_t reserved = 0;
+    ImU32 color = 0;          // base brick color
+};
+
+// Brick layout of a level, row-major (independent of world geometry)
+struct LevelData
+{
+    int cols = 0;
+    int rows = 0;
+    uint32_t seed = 0;
+    uint32_t generator = 0;   // index into the generator table
+    std::vector<LevelCell> cells;
+
+    LevelCell& at(int r, int c) { return cells[(size_t)r * cols + c]; }
+    const LevelCell& at(int r, int c) const { return cells[(size_t)r * cols + c]; }
+};
+
+class LevelCache;
+
+struct LevelGenParams
+{
+    int cols = 15;
+    int rows = 7;
+    uint32_t seed = 1337;
+    float density = 0.85f;        // target share of filled cells
+    float difficulty = 0.5f;      // 0..1, scales hit points (top rows get the hardest bricks)
+    float bonus_chance = 0.15f;
+};
+
+// Common interface of the procedural generators.
+// A generator must be a pure function of (params, cell): the same seed gives the same level,
+// no matter how the rows are split between threads.
+class LevelGenerator
+{
+public:
+    virtual ~LevelGenerator() = default;
+
+    virtual const char* name() const = 0;
+    virtual uint32_t version() const = 0;
+
+    // false when cells depend on each other in generation order (rows can't be split)
+    virtual bool supports_bands() const { return true; }
+
+    // Fill rows [row_begin, row_end) of out (cells are already sized)
+    virtual void generate_rows(const LevelGenParams& p, LevelData& out, int row_begin, int row_end) const = 0;
+};
+
+int level_generator_count();
+const LevelGenerator& level_generator(int index);       // index is clamped, 0 = classic
+int find_level_generator(const char* name);             // -1 if unknown
+
+// Default colors used by generators
+ImU32 level_row_color(int row, int rows);
+ImU32 level_bonus_color();
+
+// Generate a whole level. Large levels are split in row bands across 'threads' (0 = all cores).
+void generate_level(int generator, const LevelGenParams& p, LevelData& out, unsigned threads = 0);
+
+// Level pack: many levels in one file, laid out so a level's cells can be used straight from a mapping
+bool save_level_pack(const std::string& path, const std::vector<LevelData>& levels);
+bool load_level_pack(const std::string& path, std::vector<LevelData>& levels);
+
+// The same pack image in memory (level cache entries embed it)
+void encode_level_pack(const std::vector<LevelData>& levels, std::vector<uint8_t>& out);
+bool decode_level_pack(const uint8_t* data, size_t size, std::vector<LevelData>& levels);
+
+// Pre-generate 'count' levels with consecutive seeds starting at p.seed (parallel across levels),
+// through the level cache when one is given (level_cache.h)
+void generate_level_batch(int generator, const LevelGenParams& p, int count, std::vector<LevelData>& out, unsigned threads = 0,
+    LevelCache* cache = nullptr);
+
+// --levelgen <generator> [--count N] [--cols C] [--rows R] [--seed S] [--density D] [--difficulty D] [--threads N]
+//            [--cache DIR] -o <pack>
+int run_levelgen_tool(int argc, char** argv);
@@ -0,0 +1,98 @@
+#include "light_map.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+void LightMap::resize(const Vect& world_size, int cols, int rows) {
+    w = std::max(1, cols);
+    h = std::max(1, rows);
+    cell = Vect(world_size.x / w, world_size.y / h);
+    for (auto& p : plane) p.assign((size_t)w * h, 0.0f);
+    scratch.assign((size_t)w * h, 0.0f);
+    cell_x.resize(w);
+    for (int c = 0; c < w; ++c) cell_x[c] = (c + 0.5f) * cell.x;
+}
+
+void LightMap::build() {
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto& p : plane) std::fill(p.begin(), p.end(), 0.0f);
+    for (const LightEmitter& e : emitters) accumulate(e);
+    if (!emitters.empty())
+        for (auto& p : plane) blur(p);
+    last_us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Falloff (1 - d^2/r^2)^2 over the cells within the emitter's radius
+void LightMap::accumulate(const LightEmitter& e) {
+    if (e.radius <= 0.0f) return;
+    int c0 = std::max(0, (int)((e.pos.x - e.radius) / cell.x));
+    int c1 = std::min(w - 1, (int)((e.pos.x + e.radius) / cell.x));
+    int r0 = std::max(0, (int)((e.pos.y - e.radius) / cell.y));
+    int r1 = std::min(h - 1, (int)((e.pos.y + e.radius) / cell.y));
+    if (c0 > c1 || r0 > r1) return;
+
+    const float inv_r2 = 1.0f / (e.radius * e.radius);
+    const float* __restrict cx = cell_x.data();
+    for (int r = r0; r <= r1; ++r) {
+        float dy = (r + 0.5f) * cell.y - e.pos.y;
+        float dy2 = dy * dy;
+        float* __restrict pr = plane[0].data() + (size_t)r * w;
+        float* __restrict pg = plane[1].data() + (size_t)r * w;
+        float* __restrict pb = plane[2].data() + (size_t)r * w;
+        for (int c = c0; c <= c1; ++c) {
+            float dx = cx[c] - e.pos.x;
+            float f = std::max(0.0f, 1.0f - (dx * dx + dy2) * inv_r2);
+            f *= f;
+            pr[c] += f * e.r;
+            pg[c] += f * e.g;
+            pb[c] += f * e.b;
+        }
+    }
+}
+
+// [1 4 6 4 1] / 16 along rows, then along columns; edges clamp
+void LightMap::blur(std::vector<float>& p) {
+    const float k0 = 6.0f / 16.0f, k1 = 4.0f / 16.0f, k2 = 1.0f / 16.0f;
+    auto at = [&](const float* row, int c) { return row[std::min(w - 1, std::max(0, c))]; };
+
+    for (int r = 0; r < h; ++r) {
+        const float* __restrict s = p.data() + (size_t)r * w;
+        float* __restrict d = scratch.data() + (size_t)r * w;
+        for (int c = 0; c < std::min(2, w); ++c)
+            d[c] = k0 * s[c] + k1 * (at(s, c - 1) + at(s, c + 1)) + k2 * (at(s, c - 2) + at(s, c + 2));
+        for (int c = 2; c < w - 2; ++c)
+            d[c] = k0 * s[c] + k1 * (s[c - 1] + s[c + 1]) + k2 * (s[c - 2] + s[c + 2]);
+        for (int c = std::max(2, w - 2); c < w; ++c)
+            d[c] = k0 * s[c] + k1 * (at(s, c - 1) + at(s, c + 1)) + k2 * (at(s, c - 2) + at(s, c + 2));
+    }
+
+    // Whole rows at a time, so the inner loop runs along contiguous cells
+    for (int r = 0; r < h; ++r) {
+        const float* __restrict m2 = scratch.data() + (size_t)std::max(0, r - 2) * w;
+        const float* __restrict m1 = scratch.data() + (size_t)std::max(0, r - 1) * w;
+        const float* __restrict m0 = scratch.data() + (size_t)r * w;
+        const float* __restrict p1 = scratch.data() + (size_t)std::min(h - 1, r + 1) * w;
+        const float* __restrict p2 = scratch.data() + (size_t)std::min(h - 1, r + 2) * w;
+        float* __restrict d = p.data() + (size_t)r * w;
+        for (int c = 0; c < w; ++c)
+            d[c] = k0 * m0[c] + k1 * (m1[c] + p1[c]) + k2 * (m2[c] + p2[c]);
+    }
+}
+
+void LightMap::sample(const Vect& pos, float rgb[3]) const {
+    rgb[0] = rgb[1] = rgb[2] = 0.0f;
+    if (w == 0 || emitters.empty()) return;
+    float fx = std::min((float)w - 1.0f, std::max(0.0f, pos.x / cell.x - 0.5f));
+    float fy = std::min((float)h - 1.0f, std::max(0.0f, pos.y / cell.y - 0.5f));
+    int c = std::min(w - 2, (int)fx), r = std::min(h - 2, (int)fy);
+    c = std::max(0, c);
+    r = std::max(0, r);
+    float tx = std::min(1.0f, fx - c), ty = std::min(1.0f, fy - r);
+    int c1 = std::min(w - 1, c + 1), r1 = std::min(h - 1, r + 1);
+    for (int k = 0; k < 3; ++k) {
+        const float* p = plane[k].data();
+        float top = p[r * w + c] + (p[r * w + c1] - p[r * w + c]) * tx;
+        float bottom = p[r1 * w + c] + (p[r1 * w + c1] - p[r1 * w + c]) * tx;
+        rgb[k] = top + (bottom - top) * ty;
+    }
+}
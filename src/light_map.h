@@ -0,0 +1,50 @@
+#pragma once
+
+#include "base.h"
+#include <vector>
+
+// Point light in world units; colour is linear intensity per channel (1 = full brick brightness)
+struct LightEmitter
+{
+    Vect pos;
+    float radius;
+    float r, g, b;
+};
+
+// Low resolution light grid over the world, built on the CPU every frame: each emitter adds a
+// smooth radial falloff to the cells around it, then the grid gets a separable 5-tap blur.
+// Channels are kept as separate float planes and the inner loops run along a row of cells
+// without branches, so the compiler vectorizes them. Emitters past max_emitters are dropped,
+// which bounds the cost by the grid size alone, whatever is on screen.
+class LightMap
+{
+public:
+    int max_emitters = 32;
+
+    void resize(const Vect& world_size, int cols, int rows);
+    int cols() const { return w; }
+    int rows() const { return h; }
+
+    void clear_emitters() { emitters.clear(); }
+    void add(const LightEmitter& e) { if ((int)emitters.size() < max_emitters) emitters.push_back(e); }
+    int emitter_count() const { return (int)emitters.size(); }
+
+    // Rebuild the grid from the current emitters
+    void build();
+    float build_us() const { return last_us; }
+
+    // Bilinear sample at a world position, rgb[3] in light units
+    void sample(const Vect& pos, float rgb[3]) const;
+
+private:
+    void accumulate(const LightEmitter& e);
+    void blur(std::vector<float>& plane);
+
+    int w = 0, h = 0;
+    Vect cell = Vect(1.0f, 1.0f);
+    std::vector<float> plane[3];       // r, g, b; w * h each
+    std::vector<float> scratch;        // blur pass in between
+    std::vector<float> cell_x;         // cell centre x per column
+    std::vector<LightEmitter> emitters;
+    float last_us = 0.0f;
+};
@@ -5,8 +5,29 @@
 #include "imgui_impl_opengl3.h"
 
 #include "arkanoid.h"
+#include "async_io.h"
+#include "autopilot.h"
+#include "columnar.h"
+#include "crash_handler.h"
+#include "draw_capture.h"
+#include "event_log.h"
+#include "golden.h"
+#include "headless.h"
+#include "level_arena.h"
+#include "level_cache.h"
+#include "level_estimator.h"
+#include "levelgen.h"
+#include "metrics.h"
+#include "microbench.h"
+#include "perf_fuzz.h"
+#include "replay.h"
+#include "scenario.h"
+#include "soak.h"
+#include "video_capture.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
@@ -25,28 +46,292 @@ struct ArkanoidSettingsExtended : ArkanoidSettings
     float debug_draw_timeout = 0.5f;
 };
 
-int main(int, char**)
+// Offscreen render target: the world layer (dynamic internal resolution, see world_layer.h) and
+// --draw-replay. The texture keeps its name when resized, so the layer's ImTextureID stays valid.
+struct OffscreenTarget
 {
-    // Setup window
-    glfwSetErrorCallback(glfw_error_callback);
-    
-    if (!glfwInit())
-        return 1;
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
 
-    // Decide GL+GLSL versions
+    void create()
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        resize(1, 1);
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void resize(int w, int h)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        width = w;
+        height = h;
+    }
+
+    void render(ImDrawData* data, int w, int h, const ImVec4& clear_color)
+    {
+        if (w != width || h != height)
+            resize(w, h);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, width, height);
+        glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
+        glClear(GL_COLOR_BUFFER_BIT);
+        ImGui_ImplOpenGL3_RenderDrawData(data);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Render the layer recorded this frame; call before the frame itself is rendered
+    void render(WorldLayer& layer, const ImVec4& clear_color)
+    {
+        render(layer.draw_data(), layer.width(), layer.height(), clear_color);
+    }
+
+    void destroy()
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteTextures(1, &texture);
+        framebuffer = texture = 0;
+    }
+};
+
+// Decide GL+GLSL versions; returns the GLSL version for the OpenGL3 backend
+static const char* set_gl_window_hints()
+{
 #ifdef __APPLE__
     // GL 3.2 + GLSL 150
-    const char* glsl_version = "#version 150";
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  // 3.2+ only
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);            // Required on Mac
+    return "#version 150";
 #else
     // GL 3.0 + GLSL 130
-    const char* glsl_version = "#version 130";
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    return "#version 130";
 #endif
+}
+
+// --draw-replay through the OpenGL3 backend. Frames go to offscreen targets of the captured
+// framebuffer size, so the (hidden) window's size doesn't matter.
+class GlReplayTarget : public DrawReplayTarget
+{
+public:
+    OffscreenTarget layer, frame;
+    ImVec4 clear_color = ImVec4(0.05f, 0.075f, 0.1f, 1.00f);
+
+    const char* name() const override { return "OpenGL3 backend"; }
+    ImTextureID font_texture() override { return ImGui::GetIO().Fonts->TexID; }
+    ImTextureID layer_texture() override { return (ImTextureID)(intptr_t)layer.texture; }
+
+    void render_layer(ImDrawData& data) override
+    {
+        layer.render(&data, (int)data.DisplaySize.x, (int)data.DisplaySize.y, clear_color);
+    }
+
+    void render_frame(ImDrawData& data) override
+    {
+        int w = (int)(data.DisplaySize.x * data.FramebufferScale.x), h = (int)(data.DisplaySize.y * data.FramebufferScale.y);
+        frame.render(&data, w, h, clear_color);
+    }
+
+    void finish() override { glFinish(); }
+};
+
+static int run_draw_replay_gl(int argc, char** argv)
+{
+    for (int i = 0; i < argc; ++i)
+        if (strcmp(argv[i], "--cpu") == 0)
+            return run_draw_replay(argc, argv, nullptr);
+
+    glfwSetErrorCallback(glfw_error_callback);
+    GLFWwindow* window = nullptr;
+    const char* glsl_version = nullptr;
+    if (glfwInit())
+    {
+        glsl_version = set_gl_window_hints();
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        window = glfwCreateWindow(64, 64, "Arkanoid draw replay", NULL, NULL);
+    }
+    if (window)
+    {
+        glfwMakeContextCurrent(window);
+        if (!gladLoadGL(glfwGetProcAddress))
+        {
+            glfwDestroyWindow(window);
+            window = nullptr;
+        }
+    }
+    if (!window)
+    {
+        fprintf(stderr, "No OpenGL context, replaying on the CPU rasterizer\n");
+        glfwTerminate();
+        return run_draw_replay(argc, argv, nullptr);
+    }
+    glfwSwapInterval(0);
+
+    ImGui::CreateContext();
+    ImGui_ImplOpenGL3_Init(glsl_version);
+    ImGui_ImplOpenGL3_NewFrame();   // creates the font texture
+
+    GlReplayTarget target;
+    target.layer.create();
+    target.frame.create();
+    int result = run_draw_replay(argc, argv, &target);
+    target.layer.destroy();
+    target.frame.destroy();
+
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui::DestroyContext();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return result;
+}
+
+// Command line tools, run without creating a window
+struct CommandLineTool
+{
+    const char* name;
+    int (*run)(int argc, char** argv);
+};
+
+static const CommandLineTool command_line_tools[] = {
+    { "--replay-verify", run_replay_tool },
+    { "--levelgen", run_levelgen_tool },
+    { "--estimate", run_estimate_tool },
+    { "--microbench", run_microbench_tool },
+    { "--golden", run_golden_tool },
+    { "--capture-export", run_capture_export_tool },
+    { "--events-convert", run_events_convert_tool },
+    { "--events-query", run_events_query_tool },
+    { "--scenario", run_scenario_tool },
+    { "--perf-fuzz", run_perf_fuzz_tool },
+    { "--draw-replay", run_draw_replay_gl },
+};
+
+int main(int argc, char** argv)
+{
+    for (const auto& tool : command_line_tools)
+        if (argc > 1 && strcmp(argv[1], tool.name) == 0)
+            return tool.run(argc - 2, argv + 2);
+
+    // --record <file>: save the session inputs as a replay on exit
+    const char* record_path = nullptr;
+    for (int i = 1; i + 1 < argc; ++i)
+        if (strcmp(argv[i], "--record") == 0) record_path = argv[i + 1];
+
+    // --metrics-port <port>: serve OpenMetrics text on http://127.0.0.1:<port>/metrics
+    GameMetrics metrics;
+    MetricsServer metrics_server;
+    for (int i = 1; i + 1 < argc; ++i)
+        if (strcmp(argv[i], "--metrics-port") == 0 && metrics_server.start(metrics, atoi(argv[i + 1])))
+            set_metrics_sink(&metrics);
+
+    // --soak <report> [--soak-interval s] [--soak-duration s]: the autopilot plays (restarting after
+    // every game) while memory and container capacities are sampled; the report is written on exit
+    const char* soak_path = nullptr;
+    double soak_interval = 10.0, soak_duration = 0.0;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (strcmp(argv[i], "--soak") == 0) soak_path = argv[i + 1];
+        if (strcmp(argv[i], "--soak-interval") == 0) soak_interval = atof(argv[i + 1]);
+        if (strcmp(argv[i], "--soak-duration") == 0) soak_duration = atof(argv[i + 1]);
+    }
+    SoakMonitor soak(soak_interval);
+    Autopilot soak_pilot;
+    int exit_code = 0;
+
+    // Crash dumps (replay from the last state snapshot + report) go to --crash-dir, default "."
+    const char* crash_dir = ".";
+    bool crash_dumps = true;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--crash-dir") == 0 && i + 1 < argc) crash_dir = argv[i + 1];
+        if (strcmp(argv[i], "--no-crash-dump") == 0) crash_dumps = false;
+    }
+    static CrashRecorder crash_recorder;
+
+    // --huge-pages: back the per-level arena with huge pages
+    for (int i = 1; i < argc; ++i)
+        if (strcmp(argv[i], "--huge-pages") == 0) set_level_arena_huge_pages(true);
+
+    // --no-io-uring: write logs and captures through the thread pool even where io_uring works
+    for (int i = 1; i < argc; ++i)
+        if (strcmp(argv[i], "--no-io-uring") == 0) set_async_io_threads_only(true);
+
+    // --level-cache <dir> [--level-cache-mb N]: keep generated levels on disk (content-addressed, LRU)
+    const char* level_cache_dir = nullptr;
+    unsigned long long level_cache_mb = 64;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (strcmp(argv[i], "--level-cache") == 0) level_cache_dir = argv[i + 1];
+        if (strcmp(argv[i], "--level-cache-mb") == 0) level_cache_mb = strtoull(argv[i + 1], nullptr, 10);
+    }
+    LevelCache game_level_cache;
+    if (level_cache_dir)
+    {
+        if (game_level_cache.open(level_cache_dir, level_cache_mb << 20))
+            set_level_cache(&game_level_cache);
+        else
+            fprintf(stderr, "Cannot use level cache %s\n", level_cache_dir);
+    }
+
+    // --capture <file.arkv> [--capture-threads N]: encode every rendered frame (QOI, worker pool)
+    const char* capture_path = nullptr;
+    unsigned capture_threads = 0;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (strcmp(argv[i], "--capture") == 0) capture_path = argv[i + 1];
+        if (strcmp(argv[i], "--capture-threads") == 0) capture_threads = (unsigned)atoi(argv[i + 1]);
+    }
+    VideoCapture capture;
+    std::vector<uint8_t> capture_pixels;
+
+    // --events <file.arkev>: log brick hits, bonuses, purchases, ... for --events-convert / --events-query
+    const char* events_path = nullptr;
+    for (int i = 1; i + 1 < argc; ++i)
+        if (strcmp(argv[i], "--events") == 0) events_path = argv[i + 1];
+    GameEventLog event_log;
+    if (events_path)
+    {
+        if (event_log.open(events_path))
+            set_event_sink(&event_log);
+        else
+            fprintf(stderr, "Failed to open event log %s\n", events_path);
+    }
+
+    // --dynamic-res [--min-render-scale S]: draw the world offscreen at an internal resolution that
+    // follows frame-time headroom and upscale it; HUD and menus stay at native resolution
+    bool dynamic_res = false;
+    float min_render_scale = 0.0f;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--dynamic-res") == 0) dynamic_res = true;
+        if (strcmp(argv[i], "--min-render-scale") == 0 && i + 1 < argc) min_render_scale = (float)atof(argv[i + 1]);
+    }
+    OffscreenTarget world_target;
+
+    // --draw-capture <file.arkd>: record every frame's draw commands for --draw-replay
+    const char* draw_capture_path = nullptr;
+    for (int i = 1; i + 1 < argc; ++i)
+        if (strcmp(argv[i], "--draw-capture") == 0) draw_capture_path = argv[i + 1];
+    DrawCaptureWriter draw_capture;
+    if (draw_capture_path && !draw_capture.open(draw_capture_path))
+        fprintf(stderr, "Failed to open draw capture %s\n", draw_capture_path);
+
+    // Setup window
+    glfwSetErrorCallback(glfw_error_callback);
+    
+    if (!glfwInit())
+        return 1;
+
+    // Decide GL+GLSL versions
+    const char* glsl_version = set_gl_window_hints();
 
     // Create window with graphics context
     GLFWwindow* window = glfwCreateWindow(1280, 720, "Arkanoid Test", NULL, NULL);
@@ -82,6 +367,24 @@ int main(int, char**)
     
     Arkanoid* arkanoid = create_arkanoid();
     arkanoid->reset(arkanoid_settings);
+
+    Replay recording;
+    recording.settings = arkanoid_settings;
+
+    ArkanoidImpl* arkanoid_impl = dynamic_cast<ArkanoidImpl*>(arkanoid);
+    ArkanoidImpl* soak_game = soak_path ? arkanoid_impl : nullptr;
+    double soak_start = glfwGetTime();
+    if(arkanoid_impl && crash_dumps)
+        crash_recorder.install(crash_dir);
+    if(arkanoid_impl)
+    {
+        world_target.create();
+        WorldLayer& layer = arkanoid_impl->offscreen_world();
+        layer.set_texture((ImTextureID)(intptr_t)world_target.texture, true);
+        layer.enabled = dynamic_res;
+        if(min_render_scale > 0.0f)
+            layer.governor.min_scale = min_render_scale;
+    }
     
     // Main loop
     double last_time = glfwGetTime();
@@ -116,6 +419,23 @@ int main(int, char**)
         {
             if(do_arkanoid_update)
             {
+                if(soak_game)
+                {
+                    ArkanoidImpl::Observation obs;
+                    soak_game->observe(obs);
+                    unpack_game_keys(obs.playing ? soak_pilot.keys(obs) : GameKey_Restart, io);
+                }
+
+                uint32_t frame_keys = pack_game_keys(io);
+                if(record_path)
+                {
+                    if(recording.frames.empty())
+                        recording.display_size = io.DisplaySize;
+                    recording.frames.push_back({ elapsed_time, frame_keys });
+                }
+                if(arkanoid_impl)
+                    crash_recorder.record_frame(*arkanoid_impl, arkanoid_settings, io.DisplaySize, elapsed_time, frame_keys);
+
                 arkanoid->update(io, arkanoid_debug_data, elapsed_time);
                 
                 // update debug draw data time
@@ -140,6 +460,13 @@ int main(int, char**)
 
             arkanoid->draw(io, *bg_drawlist);
         }
+
+        if(soak_game)
+        {
+            soak.update(cur_time - soak_start, *soak_game, arkanoid_debug_data);
+            if(soak_duration > 0.0 && cur_time - soak_start >= soak_duration)
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
         
         // debug draw
         if(arkanoid_settings.debug_draw)
@@ -154,6 +481,14 @@ int main(int, char**)
         
         // Rendering
         ImGui::Render();
+        bool world_layer = arkanoid_impl && arkanoid_impl->offscreen_world().active();
+        if(world_layer)
+            world_target.render(arkanoid_impl->offscreen_world(), clear_color);
+        if(draw_capture.is_open())
+        {
+            draw_capture.set_textures(io.Fonts->TexID, (ImTextureID)(intptr_t)world_target.texture);
+            draw_capture.write_frame(*ImGui::GetDrawData(), world_layer ? arkanoid_impl->offscreen_world().draw_data() : nullptr);
+        }
         int display_w, display_h;
         glfwGetFramebufferSize(window, &display_w, &display_h);
         glViewport(0, 0, display_w, display_h);
@@ -161,10 +496,73 @@ int main(int, char**)
         glClear(GL_COLOR_BUFFER_BIT);
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+        if (capture_path)
+        {
+            if (!capture.is_open() && !capture.open(capture_path, display_w, display_h, 60, capture_threads))
+            {
+                fprintf(stderr, "Failed to open capture %s\n", capture_path);
+                capture_path = nullptr;
+            }
+            else
+            {
+                capture_pixels.resize((size_t)display_w * display_h * 4);
+                glPixelStorei(GL_PACK_ALIGNMENT, 1);
+                glReadPixels(0, 0, display_w, display_h, GL_RGBA, GL_UNSIGNED_BYTE, capture_pixels.data());
+                capture.push_frame(capture_pixels.data(), display_w, display_h, true);
+            }
+        }
+
         glfwSwapBuffers(window);
     }
 
+    if(record_path && !save_replay(record_path, recording))
+        fprintf(stderr, "Failed to write replay %s\n", record_path);
+
+    if(soak_game && !soak.write_report(soak_path))
+        exit_code = 1;
+
+    if(capture.is_open())
+    {
+        if (!capture.close())
+            fprintf(stderr, "Failed to write capture %s\n", capture_path);
+        capture.stats().print(stdout);
+    }
+
+    if(draw_capture.is_open())
+    {
+        uint32_t frames = draw_capture.frames();
+        double raw_mb = draw_capture.raw_bytes() / 1048576.0, written_mb = draw_capture.written_bytes() / 1048576.0;
+        if (!draw_capture.close())
+            fprintf(stderr, "Failed to write draw capture %s\n", draw_capture_path);
+        printf("%u frames of draw commands captured to %s: %.1f MB (%.1f MB raw)\n", frames, draw_capture_path, written_mb, raw_mb);
+    }
+
+    if(event_log.is_open())
+    {
+        set_event_sink(nullptr);
+        uint64_t events = event_log.count();
+        if (!event_log.close())
+            fprintf(stderr, "Failed to write event log %s\n", events_path);
+        printf("%llu events logged to %s\n", (unsigned long long)events, events_path);
+    }
+
+    if(capture_path || events_path || draw_capture_path)
+    {
+        AsyncIo& async_io = AsyncIo::shared();
+        async_io.stats().print(stdout, async_io.backend_name());
+    }
+
+    if(level_cache())
+    {
+        set_level_cache(nullptr);
+        LevelCacheStats cs = game_level_cache.stats();
+        printf("level cache %s: %llu hits (%.1f us avg), %llu misses, %.1f MB\n", level_cache_dir, (unsigned long long)cs.hits,
+            cs.hits ? cs.load_us / cs.hits : 0.0, (unsigned long long)cs.misses, cs.bytes / (1024.0 * 1024.0));
+    }
+
     // Cleanup
+    if(world_target.texture)
+        world_target.destroy();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -172,5 +570,5 @@ int main(int, char**)
     glfwDestroyWindow(window);
     glfwTerminate();
 
-    return 0;
+    return exit_code;
 }
@@ -0,0 +1,92 @@
+#include "mem_stats.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+static size_t usable_size(void* p) { return _msize(p); }
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+static size_t usable_size(void* p) { return malloc_size(p); }
+#else
+#include <malloc.h>
+#include <unistd.h>
+static size_t usable_size(void* p) { return malloc_usable_size(p); }
+#endif
+
+// ----------------- Counters -----------------
+
+static std::atomic<uint64_t> g_allocations{ 0 };
+static std::atomic<uint64_t> g_deallocations{ 0 };
+static std::atomic<uint64_t> g_bytes_allocated{ 0 };
+static std::atomic<uint64_t> g_bytes_freed{ 0 };
+
+MemStats mem_stats() {
+    MemStats s;
+    s.allocations = g_allocations.load(std::memory_order_relaxed);
+    s.deallocations = g_deallocations.load(std::memory_order_relaxed);
+    s.bytes_allocated = g_bytes_allocated.load(std::memory_order_relaxed);
+    s.bytes_freed = g_bytes_freed.load(std::memory_order_relaxed);
+    return s;
+}
+
+size_t process_rss_bytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return pmc.WorkingSetSize;
+    return 0;
+#elif defined(__linux__)
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long pages_total = 0, pages_resident = 0;
+    int n = fscanf(f, "%lu %lu", &pages_total, &pages_resident);
+    fclose(f);
+    return n == 2 ? (size_t)pages_resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+
+
+// ----------------- Global operator new / delete -----------------
+// Plain and array forms only; over-aligned allocations keep the library defaults.
+
+static void* counted_alloc(size_t size) {
+    void* p = malloc(size ? size : 1);
+    if (p) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_bytes_allocated.fetch_add(usable_size(p), std::memory_order_relaxed);
+    }
+    return p;
+}
+
+static void counted_free(void* p) {
+    if (!p) return;
+    g_deallocations.fetch_add(1, std::memory_order_relaxed);
+    g_bytes_freed.fetch_add(usable_size(p), std::memory_order_relaxed);
+    free(p);
+}
+
+void* operator new(size_t size) {
+    if (void* p = counted_alloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    if (void* p = counted_alloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size); }
+
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete[](void* p) noexcept { counted_free(p); }
+void operator delete(void* p, size_t) noexcept { counted_free(p); }
+void operator delete[](void* p, size_t) noexcept { counted_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { counted_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { counted_free(p); }
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Process-wide heap counters, maintained by the global operator new/delete replacements in mem_stats.cpp.
+// Updated with relaxed atomics, so any thread may read them at any time.
+// Allocations that bypass operator new (ImGui's malloc-based heap) are not counted.
+struct MemStats
+{
+    uint64_t allocations = 0;       // operator new calls
+    uint64_t deallocations = 0;     // operator delete calls (non-null)
+    uint64_t bytes_allocated = 0;   // cumulative usable bytes handed out
+    uint64_t bytes_freed = 0;       // cumulative usable bytes returned
+
+    uint64_t live_allocations() const { return allocations - deallocations; }
+    uint64_t live_bytes() const { return bytes_allocated - bytes_freed; }
+};
+
+MemStats mem_stats();
+
+// Resident set size of this process in bytes (0 where unsupported)
+size_t process_rss_bytes();
@@ -0,0 +1,230 @@
+#include "metrics.h"
+#include "mem_stats.h"
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET socket_t;
+typedef int socklen_t;
+static void close_socket(socket_t s) { closesocket(s); }
+static bool wait_readable(socket_t s, int ms) {
+    WSAPOLLFD pfd = { s, POLLRDNORM, 0 };
+    return WSAPoll(&pfd, 1, ms) > 0;
+}
+static void set_send_timeout(socket_t s, int ms) {
+    DWORD t = (DWORD)ms;
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&t, sizeof(t));
+}
+static const int send_flags = 0;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+typedef int socket_t;
+static void close_socket(socket_t s) { close(s); }
+static bool wait_readable(socket_t s, int ms) {
+    pollfd pfd = { s, POLLIN, 0 };
+    return poll(&pfd, 1, ms) > 0;
+}
+static void set_send_timeout(socket_t s, int ms) {
+    timeval t = { ms / 1000, (ms % 1000) * 1000 };
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &t, sizeof(t));
+#ifdef SO_NOSIGPIPE
+    int on = 1;   // macOS has no MSG_NOSIGNAL
+    setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+#ifdef MSG_NOSIGNAL
+static const int send_flags = MSG_NOSIGNAL;   // a scraper that resets the connection must not raise SIGPIPE
+#else
+static const int send_flags = 0;
+#endif
+#endif
+
+// A client gets this long to send its request and to take the response; the serve thread is
+// shared by every scrape and by stop()
+static const int client_timeout_ms = 1000;
+
+// ----------------- Metrics -----------------
+
+const double GameMetrics::frame_buckets[GameMetrics::bucket_count] = {
+    0.002, 0.004, 0.008, 0.0125, 0.0167, 0.025, 0.0334, 0.05, 0.1, 0.25
+};
+
+static std::atomic<GameMetrics*> g_metrics_sink{ nullptr };
+
+void set_metrics_sink(GameMetrics* m) { g_metrics_sink.store(m, std::memory_order_release); }
+GameMetrics* metrics_sink() { return g_metrics_sink.load(std::memory_order_acquire); }
+
+void GameMetrics::record_frame(const MetricsFrame& f) {
+    double frame_s = f.frame_ms * 0.001;
+    int bucket = 0;
+    while (bucket < bucket_count && frame_s > frame_buckets[bucket]) bucket++;
+
+    current.frames++;
+    current.frame_buckets[bucket]++;
+    current.frame_seconds_sum += frame_s;
+    current.update_seconds_sum += f.update_ms * 0.001;
+    current.draw_seconds_sum += f.draw_ms * 0.001;
+    for (int i = 0; i < (int)PerfPhase::Count; ++i) current.phase_seconds_sum[i] += f.phase_ms[i] * 0.001;
+    if (f.won && !current.last.won) current.levels_cleared++;
+    current.last = f;
+
+    published.store(current);
+}
+
+std::string GameMetrics::format_openmetrics() const {
+    Snapshot s = snapshot();
+    MemStats mem = mem_stats();
+
+    std::string out;
+    char line[256];
+    auto emit = [&](const char* fmt, auto... args) {
+        snprintf(line, sizeof(line), fmt, args...);
+        out += line;
+    };
+
+    emit("# TYPE arkanoid_frame_seconds histogram\n# UNIT arkanoid_frame_seconds seconds\n"
+         "# HELP arkanoid_frame_seconds Wall time between frames.\n");
+    uint64_t cumulative = 0;
+    for (int i = 0; i < bucket_count; ++i) {
+        cumulative += s.frame_buckets[i];
+        emit("arkanoid_frame_seconds_bucket{le=\"%g\"} %llu\n", frame_buckets[i], (unsigned long long)cumulative);
+    }
+    emit("arkanoid_frame_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)s.frames);
+    emit("arkanoid_frame_seconds_count %llu\narkanoid_frame_seconds_sum %.6f\n", (unsigned long long)s.frames, s.frame_seconds_sum);
+
+    emit("# TYPE arkanoid_work_seconds counter\n# UNIT arkanoid_work_seconds seconds\n"
+         "# HELP arkanoid_work_seconds CPU time spent in update() and draw().\n");
+    emit("arkanoid_work_seconds_total{stage=\"update\"} %.6f\n", s.update_seconds_sum);
+    emit("arkanoid_work_seconds_total{stage=\"draw\"} %.6f\n", s.draw_seconds_sum);
+
+    emit("# TYPE arkanoid_update_phase_seconds counter\n# UNIT arkanoid_update_phase_seconds seconds\n"
+         "# HELP arkanoid_update_phase_seconds Time spent in each update() phase.\n");
+    for (int i = 0; i < (int)PerfPhase::Count; ++i)
+        emit("arkanoid_update_phase_seconds_total{phase=\"%s\"} %.6f\n", perf_phase_name((PerfPhase)i), s.phase_seconds_sum[i]);
+
+    emit("# TYPE arkanoid_update_phase_last_seconds gauge\n# UNIT arkanoid_update_phase_last_seconds seconds\n");
+    for (int i = 0; i < (int)PerfPhase::Count; ++i)
+        emit("arkanoid_update_phase_last_seconds{phase=\"%s\"} %.9f\n", perf_phase_name((PerfPhase)i), s.last.phase_ms[i] * 0.001);
+
+    emit("# TYPE arkanoid_entities gauge\n# HELP arkanoid_entities Live entities by kind.\n");
+    emit("arkanoid_entities{kind=\"bricks\"} %d\n", s.last.bricks_alive);
+    emit("arkanoid_entities{kind=\"bricks_total\"} %d\n", s.last.bricks_total);
+    emit("arkanoid_entities{kind=\"bonuses\"} %d\n", s.last.bonuses);
+    emit("arkanoid_entities{kind=\"particles\"} %d\n", s.last.particles);
+
+    emit("# TYPE arkanoid_quality_level gauge\narkanoid_quality_level %d\n", s.last.quality_level);
+    emit("# TYPE arkanoid_score gauge\narkanoid_score %d\n", s.last.score);
+    emit("# TYPE arkanoid_lives gauge\narkanoid_lives %d\n", s.last.lives);
+    emit("# TYPE arkanoid_balance gauge\narkanoid_balance %d\n", s.last.balance);
+    emit("# TYPE arkanoid_total_money gauge\narkanoid_total_money %d\n", s.last.total_money);
+    emit("# TYPE arkanoid_levels_cleared counter\narkanoid_levels_cleared_total %llu\n", (unsigned long long)s.levels_cleared);
+
+    emit("# TYPE arkanoid_heap_allocations counter\n# HELP arkanoid_heap_allocations operator new / delete calls.\n");
+    emit("arkanoid_heap_allocations_total{op=\"new\"} %llu\n", (unsigned long long)mem.allocations);
+    emit("arkanoid_heap_allocations_total{op=\"delete\"} %llu\n", (unsigned long long)mem.deallocations);
+    emit("# TYPE arkanoid_heap_allocated_bytes counter\n# UNIT arkanoid_heap_allocated_bytes bytes\n");
+    emit("arkanoid_heap_allocated_bytes_total %llu\n", (unsigned long long)mem.bytes_allocated);
+    emit("# TYPE arkanoid_heap_live_bytes gauge\n# UNIT arkanoid_heap_live_bytes bytes\n");
+    emit("arkanoid_heap_live_bytes %llu\n", (unsigned long long)mem.live_bytes());
+    emit("# TYPE process_resident_memory_bytes gauge\n# UNIT process_resident_memory_bytes bytes\n");
+    emit("process_resident_memory_bytes %llu\n", (unsigned long long)process_rss_bytes());
+
+    out += "# EOF\n";
+    return out;
+}
+
+
+
+// ----------------- HTTP server -----------------
+
+bool MetricsServer::start(const GameMetrics& m, int port) {
+    if (running) return true;
+
+#if defined(_WIN32)
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#endif
+
+    socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == (socket_t)-1) return false;
+
+    int yes = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);   // local scraping only
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 8) != 0) {
+        fprintf(stderr, "Metrics: cannot listen on 127.0.0.1:%d\n", port);
+        close_socket(s);
+        return false;
+    }
+
+    metrics = &m;
+    listen_socket = (intptr_t)s;
+    running = true;
+    thread = std::thread([this] { serve(); });
+    printf("Metrics: http://127.0.0.1:%d/metrics\n", port);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running) return;
+    running = false;
+    thread.join();
+    close_socket((socket_t)listen_socket);
+    listen_socket = -1;
+}
+
+static void send_all(socket_t c, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int n = (int)send(c, data.data() + sent, (int)(data.size() - sent), send_flags);
+        if (n <= 0) return;
+        sent += (size_t)n;
+    }
+}
+
+void MetricsServer::serve() {
+    socket_t ls = (socket_t)listen_socket;
+    while (running) {
+        // Wake up regularly so stop() does not have to wait for a client
+        if (!wait_readable(ls, 200)) continue;
+        socket_t c = accept(ls, nullptr, nullptr);
+        if (c == (socket_t)-1) continue;
+        set_send_timeout(c, client_timeout_ms);
+
+        // Only the request line matters; headers are read and ignored. A client that sends
+        // nothing is dropped after the timeout.
+        if (!wait_readable(c, client_timeout_ms)) {
+            close_socket(c);
+            continue;
+        }
+        char request[1024];
+        int n = (int)recv(c, request, sizeof(request) - 1, 0);
+        request[n > 0 ? n : 0] = 0;
+
+        std::string response;
+        if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0) {
+            std::string body = metrics->format_openmetrics();
+            response = "HTTP/1.1 200 OK\r\n"
+                       "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                       "Connection: close\r\n\r\n" + body;
+        }
+        else {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        }
+        send_all(c, response);
+        close_socket(c);
+    }
+}
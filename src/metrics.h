@@ -0,0 +1,70 @@
+#pragma once
+
+#include "perf.h"
+#include "seqlock.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// What the game reports once per frame
+struct MetricsFrame
+{
+    float frame_ms = 0.0f, update_ms = 0.0f, draw_ms = 0.0f;
+    float phase_ms[(int)PerfPhase::Count] = {};
+    int bricks_alive = 0, bricks_total = 0, bonuses = 0, particles = 0;
+    int score = 0, lives = 0, balance = 0, total_money = 0;
+    int quality_level = 0;
+    bool won = false;
+};
+
+// Aggregated game metrics. record_frame() is called from the game thread only;
+// snapshot() may be called from any thread and never blocks the writer.
+class GameMetrics
+{
+public:
+    static constexpr int bucket_count = 10;
+    static const double frame_buckets[bucket_count];   // upper bounds in seconds, +Inf implied
+
+    struct Snapshot {
+        uint64_t frames = 0;
+        uint64_t frame_buckets[bucket_count + 1] = {};  // per bucket (not cumulative), last is +Inf
+        double frame_seconds_sum = 0.0;
+        double update_seconds_sum = 0.0, draw_seconds_sum = 0.0;
+        double phase_seconds_sum[(int)PerfPhase::Count] = {};
+        MetricsFrame last;
+        uint64_t levels_cleared = 0;
+    };
+
+    void record_frame(const MetricsFrame& f);
+    Snapshot snapshot() const { return published.load(); }
+
+    // OpenMetrics text exposition, including process memory counters
+    std::string format_openmetrics() const;
+
+private:
+    Snapshot current;            // game thread copy
+    SeqLock<Snapshot> published;
+};
+
+// Sink the game reports into; null (the default) disables metrics collection
+void set_metrics_sink(GameMetrics* m);
+GameMetrics* metrics_sink();
+
+// Minimal HTTP server answering GET /metrics on 127.0.0.1:<port> from its own thread
+class MetricsServer
+{
+public:
+    ~MetricsServer() { stop(); }
+
+    bool start(const GameMetrics& metrics, int port);
+    void stop();
+
+private:
+    void serve();
+
+    const GameMetrics* metrics = nullptr;
+    std::thread thread;
+    std::atomic<bool> running{ false };
+    intptr_t listen_socket = -1;
+};
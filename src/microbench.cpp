@@ -0,0 +1,566 @@
+#include "microbench.h"
+#include "arkanoid_impl.h"
+#include "level_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ----------------- Statistics -----------------
+
+struct BenchResult
+{
+    std::string name;
+    std::vector<double> samples;   // ns per operation, outliers removed, all runs
+    std::vector<double> runs;      // median of each independent run
+    int rejected = 0;
+    double median = 0.0, mean = 0.0, stddev = 0.0;   // median: of the run medians
+};
+
+static double median_of(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return (n % 2) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+// Drop samples further than 3 scaled MADs from the median (robust to the skew of timing noise)
+static int reject_outliers(std::vector<double>& v) {
+    double med = median_of(v);
+    std::vector<double> dev;
+    for (double x : v) dev.push_back(std::abs(x - med));
+    double mad = median_of(dev) * 1.4826;
+    if (mad <= 0.0) return 0;
+
+    size_t before = v.size();
+    v.erase(std::remove_if(v.begin(), v.end(), [&](double x) { return std::abs(x - med) > 3.0 * mad; }), v.end());
+    return (int)(before - v.size());
+}
+
+static void summarize(BenchResult& r) {
+    r.rejected = reject_outliers(r.samples);
+    r.median = median_of(r.samples);
+    r.runs.assign(1, r.median);
+    double sum = 0.0;
+    for (double x : r.samples) sum += x;
+    r.mean = r.samples.empty() ? 0.0 : sum / r.samples.size();
+    double var = 0.0;
+    for (double x : r.samples) var += (x - r.mean) * (x - r.mean);
+    r.stddev = r.samples.size() > 1 ? std::sqrt(var / (r.samples.size() - 1)) : 0.0;
+}
+
+// Fold a later run of the same benchmark into r
+static void merge_run(BenchResult& r, const BenchResult& run) {
+    r.samples.insert(r.samples.end(), run.samples.begin(), run.samples.end());
+    r.runs.insert(r.runs.end(), run.runs.begin(), run.runs.end());
+    r.rejected += run.rejected;
+    r.median = median_of(r.runs);
+    double sum = 0.0;
+    for (double x : r.samples) sum += x;
+    r.mean = r.samples.empty() ? 0.0 : sum / r.samples.size();
+    double var = 0.0;
+    for (double x : r.samples) var += (x - r.mean) * (x - r.mean);
+    r.stddev = r.samples.size() > 1 ? std::sqrt(var / (r.samples.size() - 1)) : 0.0;
+}
+
+// How far the result moves by itself, in percent of its median: the spread of the run medians,
+// or for a single run 3 scaled MADs of its samples
+static double noise_percent(const BenchResult& r) {
+    if (r.median <= 0.0) return 0.0;
+    if (r.runs.size() >= 2) {
+        auto mm = std::minmax_element(r.runs.begin(), r.runs.end());
+        return (*mm.second - *mm.first) / r.median * 100.0;
+    }
+    std::vector<double> dev;
+    for (double x : r.samples) dev.push_back(std::abs(x - r.median));
+    return 3.0 * 1.4826 * median_of(dev) / r.median * 100.0;
+}
+
+// Two-sided Mann-Whitney U test, normal approximation with tie correction. Returns the p-value.
+static double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b) {
+    size_t n1 = a.size(), n2 = b.size();
+    if (n1 < 2 || n2 < 2) return 1.0;
+
+    std::vector<std::pair<double, int>> all;
+    for (double x : a) all.push_back({ x, 0 });
+    for (double x : b) all.push_back({ x, 1 });
+    std::sort(all.begin(), all.end());
+
+    double rank_sum_a = 0.0, tie_term = 0.0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first) ++j;
+        double rank = 0.5 * (double)(i + 1 + j);   // average rank of the tie group
+        for (size_t k = i; k < j; ++k) if (all[k].second == 0) rank_sum_a += rank;
+        double t = (double)(j - i);
+        tie_term += t * t * t - t;
+        i = j;
+    }
+
+    double n = (double)(n1 + n2);
+    double u = rank_sum_a - n1 * (n1 + 1) * 0.5;
+    double mu = n1 * n2 * 0.5;
+    double sigma = std::sqrt(n1 * n2 / 12.0 * ((n + 1.0) - tie_term / (n * (n - 1.0))));
+    if (sigma <= 0.0) return 1.0;
+    double z = (u - mu) / sigma;
+    return std::erfc(std::abs(z) / std::sqrt(2.0));
+}
+
+
+
+// ----------------- Runner -----------------
+
+struct BenchConfig
+{
+    int samples = 40;
+    double sample_ms = 2.0;     // target duration of one sample
+    double warmup_ms = 50.0;
+};
+
+// op(count) runs 'count' operations of the kernel
+static BenchResult run_benchmark(const char* name, const BenchConfig& cfg, const std::function<void(int)>& op) {
+    using clock = std::chrono::steady_clock;
+    BenchResult r;
+    r.name = name;
+
+    // Warmup while calibrating the batch size of one sample
+    int batch = 1;
+    auto warm_start = clock::now();
+    for (;;) {
+        auto t0 = clock::now();
+        op(batch);
+        double ms = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+        bool warm = std::chrono::duration<double, std::milli>(clock::now() - warm_start).count() >= cfg.warmup_ms;
+        if (ms >= cfg.sample_ms && warm) break;
+        if (ms < cfg.sample_ms) batch *= 2;
+    }
+
+    for (int s = 0; s < cfg.samples; ++s) {
+        auto t0 = clock::now();
+        op(batch);
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+        r.samples.push_back(ns / batch);
+    }
+    summarize(r);
+    return r;
+}
+
+
+
+// ----------------- Kernels -----------------
+
+// Has friend access to ArkanoidImpl, so the private hot routines can be driven directly
+class ArkanoidMicroBench
+{
+public:
+    ArkanoidMicroBench() {
+        // Drawing needs an ImGui context (shared draw data and the font atlas)
+        prev_context = ImGui::GetCurrentContext();
+        context = ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = ImVec2(1280.0f, 720.0f);
+        io.DeltaTime = 1.0f / 60.0f;
+        io.IniFilename = nullptr;
+        unsigned char* pixels;
+        int w, h;
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &w, &h);
+        ImGui::NewFrame();
+        dl = IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData());
+    }
+
+    ~ArkanoidMicroBench() {
+        IM_DELETE(dl);
+        ImGui::EndFrame();
+        ImGui::DestroyContext(context);
+        ImGui::SetCurrentContext(prev_context);
+    }
+
+    void run_all(const BenchConfig& cfg, const char* filter, std::vector<BenchResult>& out) {
+        auto bench = [&](const std::string& name, const std::function<void(int)>& op) {
+            if (filter && name.find(filter) == std::string::npos) return;
+            out.push_back(run_benchmark(name.c_str(), cfg, op));
+            const BenchResult& r = out.back();
+            printf("%-34s %10.1f ns/op  (mean %.1f, sd %.1f, n %zu, %d outliers)\n",
+                r.name.c_str(), r.median, r.mean, r.stddev, r.samples.size(), r.rejected);
+            fflush(stdout);
+        };
+
+        ArkanoidSettings s;
+        ArkanoidImpl g;
+        g.reset(s);
+        g.screen_scale = Vect(1280.0f / s.world_size.x, 720.0f / s.world_size.y);
+
+        // Ball positions around one brick: hits on every side plus misses
+        Rect rect = g.bricks[g.bricks.size() / 2].rect_world;
+        std::vector<Vect> probes;
+        for (int i = 0; i < 64; ++i) {
+            float a = i * 0.098f;
+            float d = (i % 3 == 0) ? 40.0f : 0.5f * rect.size.y + g.ball_radius * 0.5f;
+            probes.push_back(Vect(rect.pos.x + rect.size.x * 0.5f + std::cos(a) * d * 1.5f, rect.pos.y + rect.size.y * 0.5f + std::sin(a) * d));
+        }
+        bench("collide_ball_with_rect", [&](int n) {
+            Vect normal, hit;
+            float t;
+            for (int i = 0; i < n; ++i) {
+                g.ball_pos = probes[i & 63];
+                sink += g.collide_ball_with_rect(rect, normal, hit, t) ? 1 : 0;
+            }
+        });
+
+        const Vect normals[4] = { Vect(1, 0), Vect(-1, 0), Vect(0, 1), Vect(0, -1) };
+        bench("reflect_ball", [&](int n) {
+            for (int i = 0; i < n; ++i) {
+                if ((i & 15) == 0) g.ball_vel = Vect(120.0f, -90.0f);
+                g.reflect_ball(normals[i & 3]);
+            }
+            sink += (int)g.ball_vel.x;
+        });
+
+        bench("bounce_from_carriage", [&](int n) {
+            Rect c = g.carriage_world;
+            for (int i = 0; i < n; ++i)
+                g.bounce_from_carriage(c, Vect(c.pos.x + c.size.x * (i & 63) / 63.0f, c.pos.y));
+            sink += (int)g.ball_vel.y;
+        });
+
+        bench("spawn_particles(14)", [&](int n) {
+            for (int i = 0; i < n; ++i) {
+                if (g.particles.size() > 1024) g.particles.clear();
+                g.spawn_particles(Vect(100.0f + (i & 255), 200.0f), IM_COL32(200, 180, 120, 255), 14);
+            }
+        });
+
+        for (int count : { 256, 2048 }) {
+            bench("integrate_particles(" + std::to_string(count) + ")", [&, count](int n) {
+                for (int i = 0; i < n; ++i) {
+                    if ((int)g.particles.size() < count) fill_particles(g, count);
+                    g.integrate_particles(1e-4f);
+                }
+            });
+        }
+
+        // Physical debris over the default level: walls, paddle and brick lookups every step
+        g.debris.budget_us = 1e9f;
+        for (int count : { 1024, 4096 }) {
+            bench("integrate_debris(" + std::to_string(count) + ")", [&, count](int n) {
+                for (int i = 0; i < n; ++i) {
+                    if (g.debris.size() < count) fill_debris(g, count);
+                    g.integrate_particles(1.0f / 60.0f);
+                }
+            });
+        }
+        g.debris = DebrisSystem();
+
+        // Light map build: falloff per emitter plus the blur, independent of the brick count
+        for (int count : { 1, 32 }) {
+            bench("light_map_build(" + std::to_string(count) + ")", [&, count](int n) {
+                LightMap& lm = g.light_map;
+                lm.clear_emitters();
+                for (int k = 0; k < count; ++k)
+                    lm.add({ Vect(40.0f + k * 97 % 720, 40.0f + k * 61 % 520), 90.0f, 0.5f, 0.3f, 0.4f });
+                for (int i = 0; i < n; ++i) lm.build();
+                float rgb[3];
+                lm.sample(Vect(400.0f, 300.0f), rgb);
+                sink += (int)rgb[0];
+            });
+        }
+
+        for (int count : { 16, 256 }) {
+            for (bool magnet : { false, true }) {
+                std::string name = "integrate_bonuses(" + std::to_string(count) + (magnet ? ", magnet)" : ")");
+                bench(name, [&, count, magnet](int n) {
+                    g.magnet_active = magnet;
+                    for (int i = 0; i < n; ++i) {
+                        if ((int)g.bonuses.size() < count) fill_bonuses(g, count);
+                        g.integrate_bonuses(1e-4f);
+                    }
+                    g.magnet_active = false;
+                });
+            }
+        }
+        g.particles.clear();
+        g.bonuses.clear();
+
+        // draw_world at several brick counts, with cached brick geometry and with a full rebuild
+        for (int cols : { 15, 30, 100 }) {
+            int rows = cols == 15 ? 7 : cols == 30 ? 10 : 30;
+            LevelGenParams p;
+            p.cols = cols;
+            p.rows = rows;
+            LevelData level;
+            generate_level(0, p, level);
+            g.load_level(level, s);
+
+            std::string suffix = "(" + std::to_string(cols * rows) + " bricks)";
+            bench("draw_world" + suffix, [&](int n) {
+                for (int i = 0; i < n; ++i) draw_once(g);
+            });
+            bench("draw_world" + suffix + " rebuild", [&](int n) {
+                for (int i = 0; i < n; ++i) { g.brick_geometry_dirty = true; draw_once(g); }
+            });
+        }
+
+        // Restart latency: copying the pristine level back vs building it again (seeding, generation,
+        // layout), at the largest settings reset() accepts and on huge levels loaded directly
+        ArkanoidSettings max_settings = s;
+        max_settings.bricks_columns_count = ArkanoidSettings::bricks_columns_max;
+        max_settings.bricks_rows_count = ArkanoidSettings::bricks_rows_max;
+        max_settings.level_generator = find_level_generator("maze");
+        std::string max_suffix = "(" + std::to_string(ArkanoidSettings::bricks_columns_max * ArkanoidSettings::bricks_rows_max) + " bricks)";
+        g.reset(max_settings);
+        bench("restart" + max_suffix + " pristine", [&](int n) {
+            for (int i = 0; i < n; ++i) g.reset(max_settings);
+        });
+        bench("restart" + max_suffix + " regenerate", [&](int n) {
+            for (int i = 0; i < n; ++i) { g.pristine.valid = false; g.reset(max_settings); }
+        });
+
+        for (int cols : { 100, 300 }) {
+            LevelGenParams p;
+            p.cols = cols;
+            p.rows = cols == 100 ? 30 : 100;
+            p.seed = s.seed;
+            int generator = find_level_generator("maze");
+            auto regenerate = [&]() {
+                g.rng.seed(s.seed);
+                generate_level(generator, p, g.level_scratch);
+                g.load_level(g.level_scratch, s);
+            };
+            regenerate();
+            g.capture_pristine_level(s);
+
+            std::string suffix = "(" + std::to_string(p.cols * p.rows) + " bricks)";
+            bench("restart" + suffix + " pristine", [&](int n) {
+                for (int i = 0; i < n; ++i) g.restore_pristine_level(s);
+            });
+            bench("restart" + suffix + " regenerate", [&](int n) {
+                for (int i = 0; i < n; ++i) regenerate();
+            });
+        }
+
+        // Brick scripts: one 60 Hz step over a level where half the bricks run a script; only the
+        // scripts that are due get resumed, the rest stay asleep in the run queue
+        for (int cols : { 100, 300 }) {
+            LevelGenParams p;
+            p.cols = cols;
+            p.rows = cols == 100 ? 30 : 100;
+            p.seed = s.seed;
+            generate_level(find_level_generator("scripted"), p, g.level_scratch);
+            g.load_level(g.level_scratch, s);
+            g.step_brick_scripts(10.0f);   // past the start-up staggering
+            bench("brick_scripts(" + std::to_string(g.brick_scripts.stats().running) + ") step", [&](int n) {
+                for (int i = 0; i < n; ++i) g.step_brick_scripts(1.0f / 60.0f);
+                sink += g.brick_scripts.stats().resumed;
+            });
+        }
+
+        // Level cache: mapping and checking a stored level instead of generating it
+        LevelCache cache;
+        if (cache.open((std::filesystem::temp_directory_path() / "arkanoid_microbench_levels").string())) {
+            for (int cols : { 100, 300 }) {
+                LevelGenParams p;
+                p.cols = cols;
+                p.rows = cols == 100 ? 30 : 100;
+                p.seed = s.seed;
+                int generator = find_level_generator("maze");
+                LevelCacheKey key = level_cache_key(generator, p);
+                std::string suffix = "(" + std::to_string(p.cols * p.rows) + " bricks)";
+                bench("level" + suffix + " generate", [&](int n) {
+                    for (int i = 0; i < n; ++i) generate_level(generator, p, g.level_scratch);
+                });
+                cache.store(key, g.level_scratch);
+                bench("level" + suffix + " cache load", [&](int n) {
+                    for (int i = 0; i < n; ++i) sink += cache.load(key, g.level_scratch);
+                });
+            }
+        }
+    }
+
+    int sink = 0;
+
+private:
+    void draw_once(ArkanoidImpl& g) {
+        dl->_ResetForNewFrame();
+        dl->PushClipRectFullScreen();
+        dl->PushTextureID(ImGui::GetIO().Fonts->TexID);
+        g.draw_world(*dl, g.screen_scale, g.screen_offset);
+        g.draw_world_labels(*dl);
+        sink += dl->VtxBuffer.Size;
+    }
+
+    static void fill_particles(ArkanoidImpl& g, int count) {
+        while ((int)g.particles.size() < count) {
+            ArkanoidImpl::Particle p;
+            int i = (int)g.particles.size();
+            p.pos = Vect(10.0f + (i % 700), 10.0f + (i % 500));
+            p.vel = Vect((float)(i % 17) - 8.0f, (float)(i % 13) - 6.0f);
+            p.life = 1e9f;
+            p.size = 2.0f;
+            p.color = IM_COL32(255, 255, 255, 255);
+            g.particles.push_back(p);
+        }
+    }
+
+    static void fill_debris(ArkanoidImpl& g, int count) {
+        g.debris.max_count = std::max(g.debris.max_count, count);
+        for (int i = g.debris.size(); i < count; ++i)
+            g.debris.spawn(Vect(10.0f + (i * 37 % 780), 10.0f + (i * 53 % 560)), Vect((float)(i % 17) * 20.0f - 160.0f, (float)(i % 13) * 20.0f - 120.0f),
+                1e9f, 2.0f, IM_COL32(255, 255, 255, 255));
+    }
+
+    static void fill_bonuses(ArkanoidImpl& g, int count) {
+        while ((int)g.bonuses.size() < count) {
+            int i = (int)g.bonuses.size();
+            g.spawn_bonus_at(Vect(30.0f + (i * 37) % 700, 40.0f + (i * 13) % 200), (ArkanoidImpl::BonusType)(i % 8));
+        }
+    }
+
+    ImGuiContext* prev_context = nullptr;
+    ImGuiContext* context = nullptr;
+    ImDrawList* dl = nullptr;
+};
+
+
+
+// ----------------- Baseline IO -----------------
+
+static bool save_results_json(const char* path, const std::vector<BenchResult>& results) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "{\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        fprintf(f, "    { \"name\": \"%s\", \"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, \"runs\": [",
+            r.name.c_str(), r.median, r.mean, r.stddev);
+        for (size_t k = 0; k < r.runs.size(); ++k) fprintf(f, "%s%.3f", k ? ", " : "", r.runs[k]);
+        fprintf(f, "], \"samples\": [");
+        for (size_t k = 0; k < r.samples.size(); ++k) fprintf(f, "%s%.3f", k ? ", " : "", r.samples[k]);
+        fprintf(f, "] }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+static void parse_numbers(const char* p, const char* end, std::vector<double>& out) {
+    while (p < end) {
+        char* next;
+        double v = strtod(p, &next);
+        if (next == p) { p++; continue; }
+        out.push_back(v);
+        p = next;
+    }
+}
+
+// Reads back the files written by save_results_json (names, run medians and samples; files
+// without run medians count as a single run)
+static bool load_results_json(const char* path, std::vector<BenchResult>& results) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    std::string text;
+    char buf[4096];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;) text.append(buf, n);
+    fclose(f);
+
+    size_t pos = 0;
+    while ((pos = text.find("\"name\"", pos)) != std::string::npos) {
+        size_t q0 = text.find('"', text.find(':', pos) + 1);
+        size_t q1 = text.find('"', q0 + 1);
+        size_t s0 = text.find('[', text.find("\"samples\"", q1));
+        size_t s1 = text.find(']', s0);
+        if (q0 == std::string::npos || q1 == std::string::npos || s0 == std::string::npos || s1 == std::string::npos) return false;
+
+        BenchResult r;
+        r.name = text.substr(q0 + 1, q1 - q0 - 1);
+        parse_numbers(text.c_str() + s0 + 1, text.c_str() + s1, r.samples);
+        size_t r0 = text.find("\"runs\"", q1);
+        if (r0 != std::string::npos && r0 < s0) {
+            r0 = text.find('[', r0);
+            parse_numbers(text.c_str() + r0 + 1, text.c_str() + text.find(']', r0), r.runs);
+        }
+        if (r.runs.empty()) r.runs.assign(1, median_of(r.samples));
+        r.median = median_of(r.runs);
+        results.push_back(r);
+        pos = s1;
+    }
+    return true;
+}
+
+
+
+// ----------------- Tool -----------------
+
+int run_microbench_tool(int argc, char** argv) {
+    BenchConfig cfg;
+    const char* filter = nullptr;
+    const char* json_path = nullptr;
+    const char* compare_path = nullptr;
+    double threshold = 5.0;   // percent
+    double alpha = 0.01;
+    int runs = 3;
+
+    for (int i = 0; i < argc; ++i) {
+        const char* a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(a, "--filter") == 0 && has_value) filter = argv[++i];
+        else if (strcmp(a, "--samples") == 0 && has_value) cfg.samples = std::max(5, atoi(argv[++i]));
+        else if (strcmp(a, "--runs") == 0 && has_value) runs = std::max(1, atoi(argv[++i]));
+        else if (strcmp(a, "--json") == 0 && has_value) json_path = argv[++i];
+        else if (strcmp(a, "--compare") == 0 && has_value) compare_path = argv[++i];
+        else if (strcmp(a, "--threshold") == 0 && has_value) threshold = atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: --microbench [--filter TEXT] [--samples N] [--runs N] [--json out.json] [--compare baseline.json] [--threshold PERCENT]\n");
+            return 2;
+        }
+    }
+
+    std::vector<BenchResult> baseline;
+    if (compare_path && !load_results_json(compare_path, baseline)) {
+        fprintf(stderr, "Cannot read baseline %s\n", compare_path);
+        return 2;
+    }
+
+    // Independent runs: a fresh game and ImGui context each, so caches, allocations and the
+    // machine's state differ between them the way they do between two invocations
+    std::vector<BenchResult> results;
+    for (int run = 0; run < runs; ++run) {
+        if (runs > 1) printf("%srun %d/%d\n", run ? "\n" : "", run + 1, runs);
+        std::vector<BenchResult> pass;
+        {
+            ArkanoidMicroBench bench;
+            bench.run_all(cfg, filter, pass);
+        }
+        if (run == 0) results.swap(pass);
+        else for (size_t k = 0; k < results.size() && k < pass.size(); ++k) merge_run(results[k], pass[k]);
+    }
+
+    if (json_path && !save_results_json(json_path, results))
+        fprintf(stderr, "Cannot write %s\n", json_path);
+
+    if (!compare_path) return 0;
+
+    int regressions = 0;
+    printf("\ncomparison with %s (threshold %.1f%% or the run-to-run noise, p < %.2f):\n", compare_path, threshold, alpha);
+    for (const BenchResult& r : results) {
+        auto it = std::find_if(baseline.begin(), baseline.end(), [&](const BenchResult& b) { return b.name == r.name; });
+        if (it == baseline.end()) { printf("  %-34s (no baseline)\n", r.name.c_str()); continue; }
+
+        // A change within either side's own run-to-run drift is noise, however small p gets
+        double change = it->median > 0.0 ? (r.median - it->median) / it->median * 100.0 : 0.0;
+        double floor = std::max(threshold, std::max(noise_percent(r), noise_percent(*it)));
+        double p = mann_whitney_p(r.samples, it->samples);
+        const char* verdict = "same";
+        if (p < alpha && change > floor) { verdict = "REGRESSION"; regressions++; }
+        else if (p < alpha && change < -floor) verdict = "improved";
+        printf("  %-34s %10.1f -> %10.1f ns/op  %+6.1f%%  (noise %4.1f%%)  p=%.4f  %s\n", r.name.c_str(), it->median, r.median,
+            change, floor, p, verdict);
+    }
+    printf("%d regression(s)\n", regressions);
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// --microbench [--filter TEXT] [--samples N] [--runs N] [--json out.json] [--compare baseline.json] [--threshold PERCENT]
+// Times the simulation and drawing hot routines in isolation. Every benchmark is warmed up,
+// sampled repeatedly and cleaned of outliers, in several independent runs (3 by default).
+// --compare runs a Mann-Whitney U test against a previous --json run and fails when a benchmark
+// is significantly slower by more than the threshold and by more than its medians drift between
+// runs, in either file: samples within one run are not independent of the machine's state.
+int run_microbench_tool(int argc, char** argv);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Run fn(index) for every index in [0, count) on up to 'threads' threads.
+// Indices are handed out one at a time, so jobs of uneven length balance themselves.
+// threads == 0 means one thread per hardware core. The calling thread takes part.
+template <typename Fn>
+void parallel_for(size_t count, unsigned threads, Fn&& fn)
+{
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads > count) threads = (unsigned)count;
+
+    std::atomic<size_t> next{ 0 };
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+            fn(i);
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "probes.h"
+#include <chrono>
+
+// Update phases timed separately in the perf overlay
+enum class PerfPhase { Controls, Ball, Bonuses, Particles, Collisions, Scripts, Count };
+
+inline const char* perf_phase_name(PerfPhase p) {
+    static const char* names[(int)PerfPhase::Count] = { "controls", "ball", "bonuses", "particles", "collisions", "scripts" };
+    return names[(int)p];
+}
+
+// Stopwatch returning milliseconds since the previous lap
+struct PerfTimer
+{
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    float lap_ms() {
+        auto t1 = std::chrono::steady_clock::now();
+        float ms = std::chrono::duration<float, std::milli>(t1 - t0).count();
+        t0 = t1;
+        return ms;
+    }
+};
+
+// Frame timings: last raw values plus exponentially smoothed ones for display
+struct PerfStats
+{
+    static constexpr int history_size = 120;
+    static constexpr float smoothing = 0.1f;
+
+    float frame_ms = 0.0f;                          // wall time between update() calls
+    float update_ms = 0.0f;                         // last update() cost
+    float draw_ms = 0.0f;                           // last draw() cost
+    float phase_ms[(int)PerfPhase::Count] = {};     // last update() cost per phase
+
+    float avg_frame_ms = 0.0f;
+    float avg_work_ms = 0.0f;                       // update + draw
+    float avg_phase_ms[(int)PerfPhase::Count] = {};
+
+    float work_history[history_size] = {};          // update + draw per frame, ring buffer
+    int history_pos = 0;
+    int frames = 0;                                 // frames completed (draw() calls)
+
+    static void smooth(float& avg, float v) { avg += (v - avg) * smoothing; }
+
+    void set_phase(PerfPhase p, float ms) {
+        phase_ms[(int)p] = ms;
+        ARK_PROBE2(update_phase, (int)p, ms * 1e6f);   // phase id, nanoseconds
+    }
+
+    void end_frame() {
+        float work = update_ms + draw_ms;
+        smooth(avg_work_ms, work);
+        smooth(avg_frame_ms, frame_ms);
+        for (int i = 0; i < (int)PerfPhase::Count; ++i) smooth(avg_phase_ms[i], phase_ms[i]);
+        work_history[history_pos] = work;
+        history_pos = (history_pos + 1) % history_size;
+        frames++;
+    }
+};
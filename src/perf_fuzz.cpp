@@ -0,0 +1,336 @@
+#include "perf_fuzz.h"
+#include "autopilot.h"
+#include "headless.h"
+#include "levelgen.h"
+#include "replay.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+
+// Reads the game situation a step ended in (private state) for the coverage map
+class PerfFuzzProbe
+{
+public:
+    // Coverage feature of one step: bucketed counts and flags packed into feature_bits bits.
+    // Each bucket boundary is where some update() path gets more expensive: more brick
+    // collisions resolved, more bonuses and particles integrated, magnet pull, faster ball.
+    static constexpr int feature_bits = 18;
+
+    static uint32_t feature(const ArkanoidImpl& g, int destroyed_in_step, bool life_lost) {
+        auto log_bucket = [](int v, int max) { int b = 0; while (v > 0 && b < max) { v >>= 1; b++; } return (uint32_t)b; };
+        uint32_t f = 0;
+        f = f << 3 | log_bucket(destroyed_in_step, 7);
+        f = f << 3 | log_bucket((int)g.bonuses.size(), 7);
+        f = f << 3 | log_bucket((int)g.particles.size() / 8, 7);
+        f = f << 3 | std::min(7u, (uint32_t)(g.ball_speed_cur / 150.0f));
+        f = f << 2 | log_bucket(g.combo_mult - 1, 3);
+        f = f << 1 | (g.pierce_mode ? 1u : 0u);
+        f = f << 1 | (g.magnet_active ? 1u : 0u);
+        f = f << 1 | (g.slowmo_mode ? 1u : 0u);
+        f = f << 1 | (life_lost ? 1u : 0u);
+        return f;
+    }
+
+    static int entities(const ArkanoidImpl& g) { return (int)(g.bonuses.size() + g.particles.size()); }
+    static int bricks_left(const ArkanoidImpl& g) { return g.brick_grid.alive; }
+};
+
+namespace {
+
+struct FuzzRun
+{
+    float worst_us = 0.0f;
+    uint32_t worst_frame = 0;
+    int bricks_left = 0, entities = 0;   // at the worst step
+};
+
+struct FuzzEntry
+{
+    FuzzInput input;
+    FuzzRun run;       // confirmed timings
+    int new_features = 0;
+};
+
+const uint32_t movement_keys[] = { 0, GameKey_Left, GameKey_Right };
+const uint32_t action_keys[] = {
+    GameKey_Pierce, GameKey_Magnet, GameKey_NukeRow, GameKey_ScoreMult, GameKey_SpeedHigh, GameKey_SpeedLow,
+    GameKey_SpeedMid, GameKey_Restart, GameKey_BuyLife, GameKey_God,
+};
+const float step_lengths[] = { 1.0f / 240.0f, 1.0f / 120.0f, 1.0f / 60.0f, 1.0f / 30.0f, 1.0f / 15.0f };
+
+Replay to_replay(const FuzzInput& in, uint32_t frames) {
+    Replay r;
+    r.settings = in.settings;
+    r.frames.reserve(frames);
+    while (r.frames.size() < frames) {
+        for (const FuzzSegment& s : in.segments)
+            for (int k = 0; k < s.frames && r.frames.size() < frames; ++k) r.frames.push_back({ in.dt, s.keys });
+        if (in.segments.empty()) r.frames.push_back({ in.dt, 0 });
+    }
+    return r;
+}
+
+// Per-step update() time; features of every step when asked
+void run_replay(const Replay& r, std::vector<float>& step_us, std::vector<uint32_t>* features) {
+    using clock = std::chrono::steady_clock;
+    HeadlessSim sim(r.settings, r.display_size);
+    ArkanoidImpl& g = sim.game();
+    ArkanoidImpl::Observation o;
+    g.observe(o);
+    int destroyed = o.destroyed_bricks, lives = o.lives;
+    step_us.resize(r.frames.size());
+    if (features) features->clear();
+    for (size_t i = 0; i < r.frames.size(); ++i) {
+        auto t0 = clock::now();
+        sim.step(r.frames[i].dt, r.frames[i].keys);
+        step_us[i] = std::chrono::duration<float, std::micro>(clock::now() - t0).count();
+        if (!features) continue;
+        g.observe(o);
+        // A restart resets the counters; count it as nothing destroyed
+        int d = std::max(0, o.destroyed_bricks - destroyed);
+        features->push_back(PerfFuzzProbe::feature(g, d, o.lives < lives));
+        destroyed = o.destroyed_bricks;
+        lives = o.lives;
+    }
+}
+
+FuzzRun summarize(const Replay& r, const std::vector<float>& step_us) {
+    FuzzRun run;
+    for (size_t i = 0; i < step_us.size(); ++i)
+        if (step_us[i] > run.worst_us) { run.worst_us = step_us[i]; run.worst_frame = (uint32_t)i; }
+
+    // Replay up to the worst step again to report what was on screen
+    HeadlessSim sim(r.settings, r.display_size);
+    for (uint32_t i = 0; i <= run.worst_frame && i < r.frames.size(); ++i) sim.step(r.frames[i].dt, r.frames[i].keys);
+    run.entities = PerfFuzzProbe::entities(sim.game());
+    run.bricks_left = PerfFuzzProbe::bricks_left(sim.game());
+    return run;
+}
+
+// Worst step once every step has been timed `runs` times, keeping each step's fastest time:
+// a step only counts as slow if it is slow every time
+FuzzRun confirm(const Replay& r, int runs) {
+    std::vector<float> best, us;
+    run_replay(r, best, nullptr);
+    for (int k = 1; k < runs; ++k) {
+        run_replay(r, us, nullptr);
+        for (size_t i = 0; i < best.size(); ++i) best[i] = std::min(best[i], us[i]);
+    }
+    return summarize(r, best);
+}
+
+class Mutator
+{
+public:
+    explicit Mutator(uint32_t seed) : rng(seed) {}
+
+    int below(int n) { return (int)(rng() % (uint32_t)std::max(1, n)); }
+    float uniform(float a, float b) { return std::uniform_real_distribution<float>(a, b)(rng); }
+    bool chance(float p) { return uniform(0.0f, 1.0f) < p; }
+
+    FuzzSegment random_segment() {
+        FuzzSegment s;
+        s.keys = movement_keys[below(3)];
+        if (chance(0.3f)) s.keys |= action_keys[below((int)(sizeof(action_keys) / sizeof(action_keys[0])))];
+        s.frames = (uint16_t)(1 + below(chance(0.5f) ? 8 : 120));
+        return s;
+    }
+
+    FuzzInput random_input() {
+        FuzzInput in;
+        for (int n = 4 + below(28); n > 0; --n) in.segments.push_back(random_segment());
+        return in;
+    }
+
+    void mutate_settings(ArkanoidSettings& s) {
+        switch (below(8)) {
+        case 0: s.ball_speed = std::min(ArkanoidSettings::ball_speed_max, std::max(50.0f, s.ball_speed * uniform(0.5f, 2.0f))); break;
+        case 1: s.ball_radius = uniform(ArkanoidSettings::ball_radius_min, ArkanoidSettings::ball_radius_max); break;
+        case 2: s.bricks_columns_count = ArkanoidSettings::bricks_columns_min + below(ArkanoidSettings::bricks_columns_max - ArkanoidSettings::bricks_columns_min + 1); break;
+        case 3: s.bricks_rows_count = ArkanoidSettings::bricks_rows_min + below(ArkanoidSettings::bricks_rows_max - ArkanoidSettings::bricks_rows_min + 1); break;
+        case 4:
+            s.bricks_columns_padding = uniform(ArkanoidSettings::bricks_columns_padding_min, ArkanoidSettings::bricks_columns_padding_max);
+            s.bricks_rows_padding = uniform(ArkanoidSettings::bricks_rows_padding_min, ArkanoidSettings::bricks_rows_padding_max);
+            break;
+        case 5: s.carriage_width = uniform(ArkanoidSettings::carriage_width_min, 400.0f); break;
+        case 6: s.seed = (unsigned)rng(); break;
+        default:
+            s.level_generator = below(level_generator_count());
+            s.level_density = uniform(0.3f, 1.0f);
+            s.level_difficulty = uniform(0.0f, 1.0f);
+            break;
+        }
+    }
+
+    void mutate(FuzzInput& in) {
+        auto& seg = in.segments;
+        if (seg.empty()) seg.push_back(random_segment());
+        FuzzSegment& s = seg[below((int)seg.size())];
+        switch (below(8)) {
+        case 0: mutate_settings(in.settings); break;
+        case 1: in.dt = step_lengths[below((int)(sizeof(step_lengths) / sizeof(step_lengths[0])))]; break;
+        case 2: s.keys ^= 1u << below(GameKey_Count); break;
+        case 3: s.frames = (uint16_t)std::max(1, std::min(4000, (int)(s.frames * uniform(0.25f, 4.0f)))); break;
+        case 4: s.keys = (s.keys & (GameKey_Left | GameKey_Right)) ^ (GameKey_Left | GameKey_Right); break;   // swap direction
+        case 5:
+            // Short burst of a powerup or cheat
+            seg.insert(seg.begin() + below((int)seg.size() + 1),
+                FuzzSegment{ action_keys[below(3)] | movement_keys[below(3)], (uint16_t)(1 + below(4)) });
+            break;
+        case 6: seg.insert(seg.begin() + below((int)seg.size() + 1), random_segment()); break;
+        default: if (seg.size() > 1) seg.erase(seg.begin() + below((int)seg.size())); break;
+        }
+        if (seg.size() > 512) seg.resize(512);
+    }
+
+    // Settings and prefix from one parent, the rest of the sequence from the other
+    FuzzInput crossover(const FuzzInput& a, const FuzzInput& b) {
+        FuzzInput c = a;
+        size_t cut_a = (size_t)below((int)a.segments.size() + 1), cut_b = (size_t)below((int)b.segments.size() + 1);
+        c.segments.resize(cut_a);
+        c.segments.insert(c.segments.end(), b.segments.begin() + cut_b, b.segments.end());
+        if (chance(0.5f)) c.dt = b.dt;
+        return c;
+    }
+
+    std::mt19937 rng;
+};
+
+// Autopilot session compressed into segments, so the search starts from a ball that stays in play
+FuzzInput autopilot_input(uint32_t seed, uint32_t frames) {
+    FuzzInput in;
+    HeadlessSim sim(in.settings);
+    Autopilot pilot(seed);
+    ArkanoidImpl::Observation o;
+    for (uint32_t i = 0; i < frames; ++i) {
+        sim.game().observe(o);
+        uint32_t k = pilot.keys(o);
+        sim.step(in.dt, k);
+        if (!in.segments.empty() && in.segments.back().keys == k && in.segments.back().frames < 0xffff) in.segments.back().frames++;
+        else in.segments.push_back({ k, 1 });
+    }
+    return in;
+}
+
+void print_run(const char* what, int iteration, const FuzzRun& run, size_t coverage, size_t corpus) {
+    printf("%6d  %-8s %8.1f us at frame %5u  bricks %3d  entities %4d  coverage %zu  corpus %zu\n",
+        iteration, what, run.worst_us, run.worst_frame, run.bricks_left, run.entities, coverage, corpus);
+    fflush(stdout);
+}
+
+bool save_reproducer(const std::string& path, const Replay& r) {
+    if (!save_replay(path, r)) return false;
+    GoldenTrace golden;
+    HeadlessSim sim(r.settings, r.display_size);
+    golden.frames.resize(r.frames.size());
+    for (size_t i = 0; i < r.frames.size(); ++i) {
+        sim.step(r.frames[i].dt, r.frames[i].keys);
+        sim.game().capture_digest(golden.frames[i]);
+    }
+    return save_golden(golden_path_for(path), golden);
+}
+
+} // namespace
+
+
+
+int run_perf_fuzz_tool(int argc, char** argv) {
+    int iterations = 2000, keep = 4;
+    uint32_t frames = 1800, seed = 1;
+    std::string out_dir = ".";
+    bool usage = false;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) iterations = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = (uint32_t)std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--keep") == 0 && i + 1 < argc) keep = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_dir = argv[++i];
+        else usage = true;
+    }
+    if (usage) {
+        fprintf(stderr, "usage: --perf-fuzz [--iterations N] [--frames N] [--seed S] [--keep K] [--out DIR]\n");
+        return 2;
+    }
+
+    const int confirm_runs = 3;
+    const size_t corpus_max = 64;
+    Mutator mut(seed);
+    std::vector<uint8_t> seen((size_t)1 << PerfFuzzProbe::feature_bits, 0);
+    size_t coverage = 0;
+    std::vector<FuzzEntry> corpus;
+    std::vector<float> step_us;
+    std::vector<uint32_t> features;
+    float best_us = 0.0f;
+
+    // Runs a candidate; keeps it when it reaches new coverage or a confirmed new worst step
+    auto evaluate = [&](FuzzInput in, int iteration) {
+        Replay r = to_replay(in, frames);
+        run_replay(r, step_us, &features);
+        int fresh = 0;
+        for (uint32_t f : features)
+            if (!seen[f]) { seen[f] = 1; fresh++; }
+        coverage += fresh;
+
+        float worst = *std::max_element(step_us.begin(), step_us.end());
+        bool slower = worst > best_us;
+        if (!fresh && !slower && corpus.size() >= corpus_max) return;
+
+        FuzzEntry e{ std::move(in), confirm(r, confirm_runs), fresh };
+        if (!fresh && e.run.worst_us <= best_us) return;   // the slow step was noise
+        if (e.run.worst_us > best_us) {
+            best_us = e.run.worst_us;
+            print_run("worst", iteration, e.run, coverage, std::min(corpus.size() + 1, corpus_max));
+        }
+        else if (iteration % 50 == 0) print_run("coverage", iteration, e.run, coverage, std::min(corpus.size() + 1, corpus_max));
+
+        corpus.push_back(std::move(e));
+        if (corpus.size() > corpus_max) {
+            // Evict the fastest entry that brought the least coverage
+            auto victim = std::min_element(corpus.begin(), corpus.end(), [](const FuzzEntry& a, const FuzzEntry& b) {
+                return std::make_pair(a.new_features > 0, a.run.worst_us) < std::make_pair(b.new_features > 0, b.run.worst_us);
+            });
+            corpus.erase(victim);
+        }
+    };
+
+    printf("perf fuzz: %d iterations of %u frames, seed %u\n", iterations, frames, seed);
+    evaluate(autopilot_input(seed, frames), 0);
+    for (int k = 0; k < 7; ++k) evaluate(mut.random_input(), 0);
+
+    for (int it = 1; it <= iterations; ++it) {
+        // Tournament of two, biased to the slower parent
+        auto pick = [&]() -> const FuzzEntry& {
+            const FuzzEntry& a = corpus[mut.below((int)corpus.size())];
+            const FuzzEntry& b = corpus[mut.below((int)corpus.size())];
+            return a.run.worst_us >= b.run.worst_us ? a : b;
+        };
+        FuzzInput child = mut.chance(0.2f) ? mut.crossover(pick().input, pick().input) : pick().input;
+        for (int n = 1 + mut.below(4); n > 0; --n) mut.mutate(child);
+        evaluate(std::move(child), it);
+    }
+
+    std::sort(corpus.begin(), corpus.end(), [](const FuzzEntry& a, const FuzzEntry& b) { return a.run.worst_us > b.run.worst_us; });
+    std::error_code ec;
+    std::filesystem::create_directories(out_dir, ec);
+    int failed = 0;
+    for (int i = 0; i < keep && i < (int)corpus.size(); ++i) {
+        const FuzzEntry& e = corpus[i];
+        std::string path = out_dir + "/fuzz_" + std::to_string(i) + ".arkrep";
+        if (!save_reproducer(path, to_replay(e.input, frames))) {
+            fprintf(stderr, "cannot write %s\n", path.c_str());
+            failed++;
+            continue;
+        }
+        const ArkanoidSettings& s = e.input.settings;
+        printf("%s: worst %.1f us at frame %u  (ball %.0f r%.0f, %dx%d bricks, generator %d, dt 1/%.0f)\n", path.c_str(),
+            e.run.worst_us, e.run.worst_frame, s.ball_speed, s.ball_radius, s.bricks_columns_count, s.bricks_rows_count,
+            s.level_generator, 1.0f / e.input.dt);
+    }
+    printf("coverage %zu features, corpus %zu\n", coverage, corpus.size());
+    return failed ? 1 : 0;
+}
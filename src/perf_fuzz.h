@@ -0,0 +1,30 @@
+#pragma once
+
+#include "arkanoid.h"
+#include <cstdint>
+#include <vector>
+
+// Input sequence plus settings the fuzzer mutates; expands to a replay of a fixed frame count
+struct FuzzSegment
+{
+    uint32_t keys;      // GameKeyBit mask held for the whole segment
+    uint16_t frames;
+};
+
+struct FuzzInput
+{
+    ArkanoidSettings settings;
+    float dt = 1.0f / 60.0f;
+    std::vector<FuzzSegment> segments;
+};
+
+// --perf-fuzz [--iterations N] [--frames N] [--seed S] [--keep K] [--out DIR]
+// Searches for inputs that make single update() steps expensive: mutates settings (ball speed and
+// radius, grid size, generator), step length and key sequences (movement, pierce, magnet, nuke,
+// restarts), and keeps a corpus of inputs that either reach new coverage (combinations of
+// expensive game situations: many bricks broken in one step, crowds of bonuses and particles,
+// active powerups) or raise the worst step. A new worst is only accepted once confirmed by
+// repeated runs, taking each step's fastest time, so scheduler noise doesn't win.
+// The slowest inputs are saved as replays with golden traces (fuzz_<n>.arkrep) for --replay-verify
+// and the benchmark corpus.
+int run_perf_fuzz_tool(int argc, char** argv);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+
+// USDT (user statically defined tracing) probes under the "arkanoid" provider, for bpftrace / perf / bcc.
+// A probe is a single nop plus an ELF note (.note.stapsdt) describing where its arguments live,
+// so an unattached probe costs nothing beyond evaluating its arguments.
+//
+//   ARK_PROBE(name)                 no arguments
+//   ARK_PROBE1..4(name, args...)    integer arguments, passed to the tracer as int64
+//
+// Uses <sys/sdt.h> when available, otherwise an equivalent note emitter on x86-64 / AArch64 Linux,
+// and compiles to nothing elsewhere (or with ARKANOID_NO_PROBES). Ready-made scripts: tools/bpftrace/
+//
+//   frame_begin(frame, elapsed_us)          start of update()
+//   frame_end(frame, update_ns, draw_ns)    end of draw()
+//   update_phase(phase, ns)                 after each PerfPhase of update() (0 controls .. 4 collisions, 5 scripts)
+//   brick_destroy(index, score, destroyed)
+//   bonus_spawn(type, x, y)                 world position
+//   bonus_apply(type, score)
+//   life_lost(lives_left, score)
+//   purchase(cost, balance, ok)
+//   level_reset(seed, generator, bricks)
+
+#if defined(ARKANOID_NO_PROBES) || !defined(__linux__) || !(defined(__GNUC__) || defined(__clang__))
+#  define ARKANOID_PROBES 0
+#elif defined(__has_include)
+#  if __has_include(<sys/sdt.h>)
+#    include <sys/sdt.h>
+#    define ARKANOID_PROBES 1
+#  endif
+#endif
+
+#if !defined(ARKANOID_PROBES) && (defined(__x86_64__) || defined(__aarch64__))
+#  define ARKANOID_PROBES 2
+#endif
+#ifndef ARKANOID_PROBES
+#  define ARKANOID_PROBES 0
+#endif
+
+
+
+#if ARKANOID_PROBES == 1
+
+#define ARK_PROBE(name)                 DTRACE_PROBE(arkanoid, name)
+#define ARK_PROBE1(name, a)             DTRACE_PROBE1(arkanoid, name, (int64_t)(a))
+#define ARK_PROBE2(name, a, b)          DTRACE_PROBE2(arkanoid, name, (int64_t)(a), (int64_t)(b))
+#define ARK_PROBE3(name, a, b, c)       DTRACE_PROBE3(arkanoid, name, (int64_t)(a), (int64_t)(b), (int64_t)(c))
+#define ARK_PROBE4(name, a, b, c, d)    DTRACE_PROBE4(arkanoid, name, (int64_t)(a), (int64_t)(b), (int64_t)(c), (int64_t)(d))
+
+#elif ARKANOID_PROBES == 2
+
+// Same note layout as <sys/sdt.h> (stapsdt note type 3): probe pc, base (unused), semaphore (none),
+// provider, name and the argument description "-8@<operand>" (signed 8-byte) per argument.
+#define ARK_SDT_NOTE(name, args)                                    \
+    "990: nop\n"                                                    \
+    ".pushsection .note.stapsdt,\"\",\"note\"\n"                    \
+    ".balign 4\n"                                                   \
+    ".4byte 992f-991f, 994f-993f, 3\n"                              \
+    "991: .asciz \"stapsdt\"\n"                                     \
+    "992: .balign 4\n"                                              \
+    "993: .8byte 990b\n"                                            \
+    ".8byte 0\n"                                                    \
+    ".8byte 0\n"                                                    \
+    ".asciz \"arkanoid\"\n"                                         \
+    ".asciz \"" #name "\"\n"                                        \
+    ".asciz \"" args "\"\n"                                         \
+    "994: .balign 4\n"                                              \
+    ".popsection\n"
+
+#define ARK_SDT_ARG(n, v) [a##n] "nor" ((int64_t)(v))
+
+#define ARK_PROBE(name) \
+    __asm__ __volatile__(ARK_SDT_NOTE(name, ""))
+#define ARK_PROBE1(name, a) \
+    __asm__ __volatile__(ARK_SDT_NOTE(name, "-8@%[a1]") :: ARK_SDT_ARG(1, a))
+#define ARK_PROBE2(name, a, b) \
+    __asm__ __volatile__(ARK_SDT_NOTE(name, "-8@%[a1] -8@%[a2]") :: ARK_SDT_ARG(1, a), ARK_SDT_ARG(2, b))
+#define ARK_PROBE3(name, a, b, c) \
+    __asm__ __volatile__(ARK_SDT_NOTE(name, "-8@%[a1] -8@%[a2] -8@%[a3]") :: ARK_SDT_ARG(1, a), ARK_SDT_ARG(2, b), ARK_SDT_ARG(3, c))
+#define ARK_PROBE4(name, a, b, c, d) \
+    __asm__ __volatile__(ARK_SDT_NOTE(name, "-8@%[a1] -8@%[a2] -8@%[a3] -8@%[a4]") :: ARK_SDT_ARG(1, a), ARK_SDT_ARG(2, b), ARK_SDT_ARG(3, c), ARK_SDT_ARG(4, d))
+
+#else
+
+#define ARK_PROBE(name)                 ((void)0)
+#define ARK_PROBE1(name, a)             ((void)0)
+#define ARK_PROBE2(name, a, b)          ((void)0)
+#define ARK_PROBE3(name, a, b, c)       ((void)0)
+#define ARK_PROBE4(name, a, b, c, d)    ((void)0)
+
+#endif
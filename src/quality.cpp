@@ -0,0 +1,33 @@
+#include "quality.h"
+#include <algorithm>
+
+const QualityLevel QualityGovernor::levels[level_count] = {
+    // name       per spawn  max   trail  segments  detail
+    { "high",     14,        2048, 16,    32,       true  },
+    { "medium",   8,         768,  10,    24,       true  },
+    { "low",      4,         256,  6,     16,       false },
+    { "minimal",  2,         64,   0,     12,       false },
+};
+
+void QualityGovernor::add_frame(float work_ms) {
+    avg_ms += (work_ms - avg_ms) * 0.2f;
+    if (!enabled) { over_frames = under_frames = 0; return; }
+
+    if (avg_ms > budget_ms) { over_frames++; under_frames = 0; }
+    else if (avg_ms < budget_ms * restore_ratio) { under_frames++; over_frames = 0; }
+    else { over_frames = 0; under_frames = 0; }
+
+    if (over_frames >= degrade_after && cur_level < level_count - 1) {
+        cur_level++;
+        over_frames = 0;
+    }
+    else if (under_frames >= restore_after && cur_level > 0) {
+        cur_level--;
+        under_frames = 0;
+    }
+}
+
+void QualityGovernor::set_level(int l) {
+    cur_level = std::max(0, std::min(level_count - 1, l));
+    over_frames = under_frames = 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+// Visual load knobs. They only change how much is drawn or spawned for effects,
+// never the simulation itself (particles and the trail are purely visual).
+struct QualityLevel
+{
+    const char* name;
+    int particles_per_spawn;   // cap for spawn_particles() count
+    int particles_max;         // cap for live particles
+    int trail_length;          // ball trail samples
+    int circle_segments;       // ball segments; trail/particles/magnet derive from it
+    bool brick_detail;         // brick outline + top highlight passes
+};
+
+// Lowers visual quality when the frame-time budget is exceeded and restores it
+// once there is headroom again. Two thresholds plus frame counters give hysteresis,
+// so the level does not flicker around the budget.
+class QualityGovernor
+{
+public:
+    static constexpr int level_count = 4;   // 0 = full quality
+
+    bool enabled = true;
+    float budget_ms = 8.0f;          // update + draw cost allowed per frame
+    float restore_ratio = 0.6f;      // restore when below budget * ratio
+    int degrade_after = 10;          // consecutive frames over budget
+    int restore_after = 120;         // consecutive frames with headroom
+
+    void add_frame(float work_ms);
+    void set_level(int l);
+
+    int level() const { return cur_level; }
+    const QualityLevel& current() const { return levels[cur_level]; }
+
+private:
+    static const QualityLevel levels[level_count];
+
+    int cur_level = 0;
+    float avg_ms = 0.0f;
+    int over_frames = 0;
+    int under_frames = 0;
+};
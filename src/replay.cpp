@@ -0,0 +1,326 @@
+#include "replay.h"
+#include "headless.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+
+static const char replay_magic[4] = { 'A', 'R', 'K', 'R' };
+static const char golden_magic[4] = { 'A', 'R', 'K', 'G' };
+static const uint32_t replay_version = 3;
+static const uint32_t golden_version = 1;
+
+// ----------------- File helpers -----------------
+
+template <typename T>
+static void write_pod(FILE* f, const T& v) { fwrite(&v, sizeof(T), 1, f); }
+
+template <typename T>
+static void write_pod(std::vector<uint8_t>& out, const T& v) {
+    const uint8_t* p = (const uint8_t*)&v;
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+static bool read_pod(FILE* f, T& v) { return fread(&v, sizeof(T), 1, f) == 1; }
+
+// Bytes left after the read position, so counts read from a file can be checked before resizing
+static uint64_t bytes_left(FILE* f) {
+    long pos = ftell(f);
+    if (pos < 0 || fseek(f, 0, SEEK_END) != 0) return 0;
+    long end = ftell(f);
+    fseek(f, pos, SEEK_SET);
+    return end > pos ? (uint64_t)(end - pos) : 0;
+}
+
+static void write_settings(std::vector<uint8_t>& f, const ArkanoidSettings& s) {
+    write_pod(f, s.world_size.x);
+    write_pod(f, s.world_size.y);
+    write_pod(f, (int32_t)s.bricks_columns_count);
+    write_pod(f, (int32_t)s.bricks_rows_count);
+    write_pod(f, s.bricks_columns_padding);
+    write_pod(f, s.bricks_rows_padding);
+    write_pod(f, s.ball_radius);
+    write_pod(f, s.ball_speed);
+    write_pod(f, s.carriage_width);
+    write_pod(f, (uint32_t)s.seed);
+    write_pod(f, (int32_t)s.level_generator);
+    write_pod(f, s.level_density);
+    write_pod(f, s.level_difficulty);
+}
+
+static bool read_settings(FILE* f, uint32_t version, ArkanoidSettings& s) {
+    int32_t cols = 0, rows = 0, generator = 0;
+    uint32_t seed = 0;
+    bool ok = read_pod(f, s.world_size.x) && read_pod(f, s.world_size.y) &&
+        read_pod(f, cols) && read_pod(f, rows) &&
+        read_pod(f, s.bricks_columns_padding) && read_pod(f, s.bricks_rows_padding) &&
+        read_pod(f, s.ball_radius) && read_pod(f, s.ball_speed) &&
+        read_pod(f, s.carriage_width) && read_pod(f, seed);
+
+    // v2: procedural level generator
+    if (ok && version >= 2)
+        ok = read_pod(f, generator) && read_pod(f, s.level_density) && read_pod(f, s.level_difficulty);
+
+    s.bricks_columns_count = cols;
+    s.bricks_rows_count = rows;
+    s.seed = seed;
+    s.level_generator = generator;
+    return ok;
+}
+
+
+
+// ----------------- Replay / Golden IO -----------------
+
+void encode_replay_prefix(const Replay& replay, std::vector<uint8_t>& out) {
+    out.assign(replay_magic, replay_magic + 4);
+    write_pod(out, replay_version);
+    write_settings(out, replay.settings);
+    write_pod(out, replay.display_size.x);
+    write_pod(out, replay.display_size.y);
+    write_pod(out, (uint32_t)replay.initial_state.size());
+    out.insert(out.end(), replay.initial_state.begin(), replay.initial_state.end());
+}
+
+bool save_replay(const std::string& path, const Replay& replay) {
+    std::vector<uint8_t> data;
+    encode_replay_prefix(replay, data);
+    write_pod(data, (uint32_t)replay.frames.size());
+    for (const auto& fr : replay.frames) {
+        write_pod(data, fr.dt);
+        write_pod(data, fr.keys);
+    }
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok = fclose(f) == 0 && ok;
+    return ok;
+}
+
+bool load_replay(const std::string& path, Replay& replay) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    bool ok = fread(magic, 1, 4, f) == 4 && memcmp(magic, replay_magic, 4) == 0 &&
+        read_pod(f, version) && version >= 1 && version <= replay_version &&
+        read_settings(f, version, replay.settings) &&
+        read_pod(f, replay.display_size.x) && read_pod(f, replay.display_size.y);
+
+    // v3: state restored right after reset (crash dumps start mid-game)
+    replay.initial_state.clear();
+    uint32_t state_size = 0;
+    if (ok && version >= 3 && read_pod(f, state_size) && state_size > 0) {
+        ok = state_size <= bytes_left(f);
+        if (ok) replay.initial_state.resize(state_size);
+        ok = ok && fread(replay.initial_state.data(), 1, state_size, f) == state_size;
+    }
+    ok = ok && read_pod(f, count) && count <= bytes_left(f) / (sizeof(float) + sizeof(uint32_t));
+    if (ok) {
+        replay.frames.resize(count);
+        for (auto& fr : replay.frames)
+            if (!read_pod(f, fr.dt) || !read_pod(f, fr.keys)) { ok = false; break; }
+    }
+    fclose(f);
+    return ok;
+}
+
+bool save_golden(const std::string& path, const GoldenTrace& golden) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    fwrite(golden_magic, 1, 4, f);
+    write_pod(f, golden_version);
+    write_pod(f, (uint32_t)ArkanoidStateDigest::Count);
+    write_pod(f, (uint32_t)golden.frames.size());
+    for (const auto& d : golden.frames) {
+        write_pod(f, d.hash());
+        fwrite(d.fields, sizeof(uint32_t), ArkanoidStateDigest::Count, f);
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+bool load_golden(const std::string& path, GoldenTrace& golden) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char magic[4];
+    uint32_t version = 0, field_count = 0, count = 0;
+    bool ok = fread(magic, 1, 4, f) == 4 && memcmp(magic, golden_magic, 4) == 0 &&
+        read_pod(f, version) && version == golden_version &&
+        read_pod(f, field_count) && field_count == ArkanoidStateDigest::Count &&
+        read_pod(f, count) && count <= bytes_left(f) / (sizeof(uint64_t) + field_count * sizeof(uint32_t));
+    if (ok) {
+        golden.frames.resize(count);
+        // Each frame carries the hash of its fields: a damaged trace is rejected, not reported as divergence
+        for (auto& d : golden.frames) {
+            uint64_t h = 0;
+            if (!read_pod(f, h) || fread(d.fields, sizeof(uint32_t), field_count, f) != field_count || h != d.hash()) { ok = false; break; }
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+std::string golden_path_for(const std::string& replay_path) {
+    return replay_path + ".golden";
+}
+
+
+
+// ----------------- Verification Tool -----------------
+
+struct ReplayJob
+{
+    std::string path;
+    bool passed = false;
+    uint32_t frames_run = 0;
+    double ms = 0.0;
+    std::string report;   // failure details, printed after all jobs finish
+};
+
+// Verify against the golden trace, write a new one (--bless) or just play the inputs (--run)
+enum class ReplayMode { Verify, Bless, Run };
+
+static void run_replay_job(ReplayJob& job, ReplayMode mode) {
+    bool bless = mode == ReplayMode::Bless;
+    bool run_only = mode == ReplayMode::Run;
+    auto t0 = std::chrono::steady_clock::now();
+    std::ostringstream out;
+
+    Replay replay;
+    GoldenTrace golden;
+    if (!load_replay(job.path, replay)) {
+        job.report = "  cannot read replay\n";
+        return;
+    }
+    if (mode == ReplayMode::Verify && !load_golden(golden_path_for(job.path), golden)) {
+        job.report = "  cannot read golden trace " + golden_path_for(job.path) + " (missing or damaged, run with --bless)\n";
+        return;
+    }
+
+    HeadlessSim sim(replay.settings, replay.display_size);
+    if (!replay.initial_state.empty() && !sim.game().load_state(replay.initial_state.data(), replay.initial_state.size())) {
+        job.report = "  initial state was written by a different build\n";
+        return;
+    }
+    GoldenTrace actual;
+    if (bless) actual.frames.resize(replay.frames.size());
+
+    bool diverged = false;
+    float t = 0.0f;
+    for (size_t i = 0; i < replay.frames.size() && !diverged; ++i) {
+        const ReplayFrame& fr = replay.frames[i];
+        sim.step(fr.dt, fr.keys);
+        t += fr.dt;
+        job.frames_run++;
+
+        if (run_only) continue;
+
+        ArkanoidStateDigest d;
+        sim.game().capture_digest(d);
+        if (bless) { actual.frames[i] = d; continue; }
+
+        if (i >= golden.frames.size()) {
+            out << "  golden trace ends at frame " << golden.frames.size() << ", replay has " << replay.frames.size() << "\n";
+            diverged = true;
+            break;
+        }
+
+        const ArkanoidStateDigest& e = golden.frames[i];
+        if (d.hash() == e.hash()) continue;
+
+        char line[160];
+        snprintf(line, sizeof(line), "  diverged at frame %zu (t=%.3fs, keys=0x%x)\n", i, t, fr.keys);
+        out << line;
+        for (int f = 0; f < ArkanoidStateDigest::Count; ++f) {
+            if (d.fields[f] == e.fields[f]) continue;
+            out << "    " << ArkanoidStateDigest::field_name(f) << ": expected "
+                << ArkanoidStateDigest::format_field(f, e.fields[f]) << ", got "
+                << ArkanoidStateDigest::format_field(f, d.fields[f]) << "\n";
+        }
+        diverged = true;
+    }
+
+    if (mode == ReplayMode::Verify && !diverged && golden.frames.size() != replay.frames.size()) {
+        out << "  golden trace has " << golden.frames.size() << " frames, replay has " << replay.frames.size() << "\n";
+        diverged = true;
+    }
+
+    if (bless) {
+        if (save_golden(golden_path_for(job.path), actual)) job.passed = true;
+        else out << "  cannot write golden trace\n";
+    }
+    else if (run_only) {
+        ArkanoidImpl::Observation o;
+        sim.game().observe(o);
+        char line[160];
+        snprintf(line, sizeof(line), "  finished: score %d, lives %d, %d bricks destroyed\n", o.score, o.lives, o.destroyed_bricks);
+        out << line;
+        job.passed = true;
+    }
+    else job.passed = !diverged;
+
+    job.report = out.str();
+    job.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Checked-in corpus, used when no replay is given (run from the repository root)
+static const char* default_replay_dir = "tools/replays";
+
+static void collect_replays(const std::string& arg, std::vector<std::string>& out) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (fs::is_directory(arg, ec)) {
+        std::vector<std::string> found;
+        for (const auto& e : fs::recursive_directory_iterator(arg, ec))
+            if (e.is_regular_file() && e.path().extension() == ".arkrep") found.push_back(e.path().string());
+        std::sort(found.begin(), found.end());
+        out.insert(out.end(), found.begin(), found.end());
+    }
+    else out.push_back(arg);
+}
+
+int run_replay_tool(int argc, char** argv) {
+    ReplayMode mode = ReplayMode::Verify;
+    unsigned threads = 0;
+    std::vector<std::string> paths;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--bless") == 0) mode = ReplayMode::Bless;
+        else if (strcmp(argv[i], "--run") == 0) mode = ReplayMode::Run;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+        else collect_replays(argv[i], paths);
+    }
+    if (paths.empty() && std::filesystem::is_directory(default_replay_dir)) collect_replays(default_replay_dir, paths);
+    if (paths.empty()) {
+        fprintf(stderr, "usage: --replay-verify [--bless | --run] [--threads N] [<replay.arkrep | dir>...]  (default %s)\n", default_replay_dir);
+        return 2;
+    }
+
+    std::vector<ReplayJob> jobs(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) jobs[i].path = paths[i];
+
+    auto t0 = std::chrono::steady_clock::now();
+    parallel_for(jobs.size(), threads, [&](size_t i) { run_replay_job(jobs[i], mode); });
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    int failed = 0;
+    uint64_t total_frames = 0;
+    for (const auto& job : jobs) {
+        printf("[%s] %s  %u frames  %.1f ms\n", job.passed ? (mode == ReplayMode::Bless ? "BLESS" : mode == ReplayMode::Run ? "RUN" : "PASS") : "FAIL", job.path.c_str(), job.frames_run, job.ms);
+        if (!job.report.empty()) fputs(job.report.c_str(), stdout);
+        if (!job.passed) failed++;
+        total_frames += job.frames_run;
+    }
+
+    printf("%zu replays, %d failed, %llu frames in %.1f ms (%.0f frames/s)\n",
+        jobs.size(), failed, (unsigned long long)total_frames, wall_ms,
+        wall_ms > 0.0 ? total_frames * 1000.0 / wall_ms : 0.0);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "arkanoid_impl.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One simulated frame of a recorded session
+struct ReplayFrame
+{
+    float dt = 0.0f;     // elapsed time passed to update()
+    uint32_t keys = 0;   // GameKeyBit mask, see headless.h
+};
+
+// Recorded session: starting settings plus the per-frame input stream
+struct Replay
+{
+    ArkanoidSettings settings;
+    Vect display_size = Vect(1280.0f, 720.0f);
+    std::vector<ReplayFrame> frames;
+    std::vector<uint8_t> initial_state;   // ArkanoidImpl::save_state() applied after reset, may be empty
+};
+
+// Expected per-frame state of a replay (stored next to it as "<replay>.golden")
+struct GoldenTrace
+{
+    std::vector<ArkanoidStateDigest> frames;
+};
+
+bool save_replay(const std::string& path, const Replay& replay);
+// Replay file bytes up to (not including) the frame count; the frames follow as {u32 count, {dt, keys}...}
+void encode_replay_prefix(const Replay& replay, std::vector<uint8_t>& out);
+bool load_replay(const std::string& path, Replay& replay);
+
+bool save_golden(const std::string& path, const GoldenTrace& golden);
+bool load_golden(const std::string& path, GoldenTrace& golden);
+
+std::string golden_path_for(const std::string& replay_path);
+
+// --replay-verify [--bless | --run] [--threads N] [<replay or directory>...]   (default tools/replays)
+// Replays the whole corpus in parallel and compares every frame against its golden trace.
+// --run only plays the inputs (e.g. to reproduce a crash dump under a debugger).
+int run_replay_tool(int argc, char** argv);
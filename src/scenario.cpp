@@ -0,0 +1,395 @@
+#include "scenario.h"
+#include "arkanoid_impl.h"
+#include "autopilot.h"
+#include "headless.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+// Scripted powerups go through the same path as a caught bonus
+class ScenarioRunner
+{
+public:
+    static void apply_powerup(ArkanoidImpl& game, int type) {
+        ArkanoidImpl::Bonus b;
+        b.type = (ArkanoidImpl::BonusType)type;
+        if (b.type == ArkanoidImpl::BonusType::Points) b.points = 50;   // as spawned
+        game.apply_bonus(b);
+    }
+
+    // Add the phase timings of the last update() and clear them: an update() that returns early
+    // (game over, paused) leaves the previous frame's values in place
+    static void take_phase_ms(ArkanoidImpl& game, double* sum) {
+        for (int p = 0; p < (int)PerfPhase::Count; ++p) {
+            sum[p] += game.perf.phase_ms[p];
+            game.perf.phase_ms[p] = 0.0f;
+        }
+    }
+};
+
+
+
+// ----------------- Parsing -----------------
+
+struct SettingField
+{
+    const char* name;
+    void (*set)(ArkanoidSettings& s, double v);
+};
+
+static const SettingField setting_fields[] = {
+    { "bricks_columns_count",   [](ArkanoidSettings& s, double v) { s.bricks_columns_count = (int)v; } },
+    { "bricks_rows_count",      [](ArkanoidSettings& s, double v) { s.bricks_rows_count = (int)v; } },
+    { "bricks_columns_padding", [](ArkanoidSettings& s, double v) { s.bricks_columns_padding = (float)v; } },
+    { "bricks_rows_padding",    [](ArkanoidSettings& s, double v) { s.bricks_rows_padding = (float)v; } },
+    { "ball_radius",            [](ArkanoidSettings& s, double v) { s.ball_radius = (float)v; } },
+    { "ball_speed",             [](ArkanoidSettings& s, double v) { s.ball_speed = (float)v; } },
+    { "carriage_width",         [](ArkanoidSettings& s, double v) { s.carriage_width = (float)v; } },
+    { "world_width",            [](ArkanoidSettings& s, double v) { s.world_size.x = (float)v; } },
+    { "world_height",           [](ArkanoidSettings& s, double v) { s.world_size.y = (float)v; } },
+    { "level_density",          [](ArkanoidSettings& s, double v) { s.level_density = (float)v; } },
+    { "level_difficulty",       [](ArkanoidSettings& s, double v) { s.level_difficulty = (float)v; } },
+};
+
+// Same order as GameKeyBit
+static const char game_key_names[GameKey_Count] = { 'A', 'D', 'R', '1', '2', '3', 'C', 'X', 'T', 'Q', 'Y', 'E', 'N' };
+
+// Same order as ArkanoidImpl::BonusType
+static const char* powerup_names[] = {
+    "speed_up", "enlarge_paddle", "extra_life", "pierce", "slow_mo", "points", "magnet", "score_mult"
+};
+static const int powerup_count = (int)(sizeof(powerup_names) / sizeof(powerup_names[0]));
+
+static const char* op_name(ScenarioOpCode c) {
+    static const char* names[] = { "key_down", "key_up", "powerup", "restart", "autopilot" };
+    return names[(int)c];
+}
+
+// A timed statement before times are turned into steps (dt may be set on a later line)
+struct TimedAction
+{
+    double at = 0.0, every = 0.0, until = -1.0;
+    ScenarioOpCode code = ScenarioOpCode::KeyDown;
+    int arg = 0;
+    double hold = 0.0;   // KeyDown: seconds until the KeyUp, 0 = one step
+};
+
+static bool parse_number(const std::string& text, double& out) {
+    char* end = nullptr;
+    size_t slash = text.find('/');
+    if (slash != std::string::npos) {
+        double num = strtod(text.substr(0, slash).c_str(), &end), den = strtod(text.c_str() + slash + 1, &end);
+        if (*end || den == 0.0) return false;
+        out = num / den;
+        return true;
+    }
+    out = strtod(text.c_str(), &end);
+    return !text.empty() && *end == 0;
+}
+
+static std::string directory_of(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+bool compile_scenario(const std::string& text, const std::string& source, Scenario& out, std::string& error) {
+    out = Scenario();
+    out.name = source;
+    std::vector<TimedAction> actions;
+    bool measures_set = false;
+
+    std::istringstream lines(text);
+    std::string line;
+    int line_no = 0;
+    auto fail = [&](const std::string& message) {
+        error = source + ":" + std::to_string(line_no) + ": " + message;
+        return false;
+    };
+
+    while (std::getline(lines, line)) {
+        line_no++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::vector<std::string> w;
+        for (std::string t; words >> t;) w.push_back(t);
+        if (w.empty()) continue;
+
+        const std::string& cmd = w[0];
+        double v = 0.0;
+        if (cmd == "name" && w.size() == 2) out.name = w[1];
+        else if (cmd == "set" && w.size() == 3) {
+            const SettingField* field = nullptr;
+            for (const SettingField& f : setting_fields) if (w[1] == f.name) field = &f;
+            if (!field) return fail("unknown setting '" + w[1] + "'");
+            if (!parse_number(w[2], v)) return fail("bad number '" + w[2] + "'");
+            field->set(out.settings, v);
+        }
+        else if (cmd == "seed" && w.size() == 2 && parse_number(w[1], v)) out.settings.seed = (unsigned)v;
+        else if (cmd == "dt" && w.size() == 2 && parse_number(w[1], v) && v > 0.0) out.dt = (float)v;
+        else if (cmd == "steps" && w.size() == 2 && parse_number(w[1], v) && v >= 1.0) out.steps = (uint32_t)v;
+        else if (cmd == "autopilot" && (w.size() == 2 || w.size() == 3) && (w[1] == "on" || w[1] == "off")) {
+            out.autopilot = w[1] == "on";
+            if (w.size() == 3 && parse_number(w[2], v)) out.autopilot_seed = (uint32_t)v;
+        }
+        else if (cmd == "level" && w.size() >= 3 && w[1] == "pack") {
+            std::string path = w[2];
+            if (path[0] != '/') path = directory_of(source) + path;
+            std::vector<LevelData> pack;
+            int index = w.size() > 3 ? atoi(w[3].c_str()) : 0;
+            if (!load_level_pack(path, pack)) return fail("cannot read level pack " + path);
+            if (index < 0 || index >= (int)pack.size()) return fail("level pack has no level " + std::to_string(index));
+            out.level = pack[index];
+            out.use_level = true;
+        }
+        else if (cmd == "level" && w.size() >= 2) {
+            int generator = find_level_generator(w[1].c_str());
+            if (generator < 0) return fail("unknown level generator '" + w[1] + "'");
+            out.settings.level_generator = generator;
+            out.use_level = false;
+            for (size_t i = 2; i < w.size(); ++i) {
+                size_t eq = w[i].find('=');
+                if (eq == std::string::npos || !parse_number(w[i].substr(eq + 1), v)) return fail("expected key=value, got '" + w[i] + "'");
+                std::string key = w[i].substr(0, eq);
+                if (key == "density") out.settings.level_density = (float)v;
+                else if (key == "difficulty") out.settings.level_difficulty = (float)v;
+                else if (key == "cols") out.settings.bricks_columns_count = (int)v;
+                else if (key == "rows") out.settings.bricks_rows_count = (int)v;
+                else return fail("unknown level parameter '" + key + "'");
+            }
+        }
+        else if (cmd == "measure" && w.size() >= 2) {
+            if (!measures_set) out.measures = 0;
+            measures_set = true;
+            for (size_t i = 1; i < w.size(); ++i) {
+                if (w[i] == "update") out.measures |= ScenarioMeasure_Update;
+                else if (w[i] == "phases") out.measures |= ScenarioMeasure_Phases;
+                else if (w[i] == "game") out.measures |= ScenarioMeasure_Game;
+                else return fail("unknown measure '" + w[i] + "'");
+            }
+        }
+        else if (cmd == "at" || cmd == "every") {
+            // at T <action> | every P [from T] [until T] <action>
+            TimedAction a;
+            size_t i = 1;
+            double& first = cmd == "at" ? a.at : a.every;
+            if (w.size() < 3 || !parse_number(w[i++], first)) return fail("expected a time after '" + cmd + "'");
+            if (cmd == "every" && a.every <= 0.0) return fail("period must be positive");
+            while (cmd == "every" && i + 1 < w.size() && (w[i] == "from" || w[i] == "until")) {
+                if (!parse_number(w[i + 1], w[i] == "from" ? a.at : a.until)) return fail("bad time '" + w[i + 1] + "'");
+                i += 2;
+            }
+            if (i >= w.size()) return fail("missing action");
+
+            const std::string& action = w[i];
+            size_t args = w.size() - i - 1;
+            if ((action == "hold" && args == 2) || (action == "press" && args == 1)) {
+                const char* key = (const char*)memchr(game_key_names, toupper((unsigned char)w[i + 1][0]), GameKey_Count);
+                if (w[i + 1].size() != 1 || !key) return fail("unknown key '" + w[i + 1] + "'");
+                a.code = ScenarioOpCode::KeyDown;
+                a.arg = (int)(key - game_key_names);
+                if (action == "hold" && (!parse_number(w[i + 2], a.hold) || a.hold <= 0.0)) return fail("bad hold time");
+            }
+            else if (action == "powerup" && args == 1) {
+                a.code = ScenarioOpCode::Powerup;
+                a.arg = -1;
+                for (int p = 0; p < powerup_count; ++p) if (w[i + 1] == powerup_names[p]) a.arg = p;
+                if (a.arg < 0) return fail("unknown powerup '" + w[i + 1] + "'");
+            }
+            else if (action == "restart" && args == 0) a.code = ScenarioOpCode::Restart;
+            else if (action == "autopilot" && args == 1 && (w[i + 1] == "on" || w[i + 1] == "off")) {
+                a.code = ScenarioOpCode::Autopilot;
+                a.arg = w[i + 1] == "on";
+            }
+            else return fail("bad action '" + action + "'");
+            actions.push_back(a);
+        }
+        else return fail("cannot parse '" + cmd + "' statement");
+    }
+
+    // Times -> steps. Ops past the last step are dropped.
+    auto to_step = [&](double t) { return (int64_t)std::llround(t / out.dt); };
+    auto emit = [&](int64_t step, ScenarioOpCode code, int arg) {
+        if (step >= 0 && step < (int64_t)out.steps) out.ops.push_back({ (uint32_t)step, code, (uint8_t)arg, 0 });
+    };
+    for (const TimedAction& a : actions) {
+        int64_t last = a.until >= 0.0 ? std::min<int64_t>(to_step(a.until), out.steps - 1) : (int64_t)out.steps - 1;
+        int64_t period = a.every > 0.0 ? std::max<int64_t>(1, to_step(a.every)) : 0;
+        for (int64_t s = to_step(a.at); s <= last; s += period) {
+            emit(s, a.code, a.arg);
+            if (a.code == ScenarioOpCode::KeyDown)
+                emit(s + std::max<int64_t>(1, to_step(a.hold)), ScenarioOpCode::KeyUp, a.arg);
+            if (!period) break;
+        }
+    }
+    // Releases first within a step, so a hold ending where a press starts leaves the key down
+    std::stable_sort(out.ops.begin(), out.ops.end(), [](const ScenarioOp& x, const ScenarioOp& y) {
+        if (x.step != y.step) return x.step < y.step;
+        return (x.code == ScenarioOpCode::KeyUp) > (y.code == ScenarioOpCode::KeyUp);
+    });
+    return true;
+}
+
+bool load_scenario(const std::string& path, Scenario& out, std::string& error) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::string text;
+    char buf[4096];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;) text.append(buf, n);
+    fclose(f);
+    return compile_scenario(text, path, out, error);
+}
+
+
+
+// ----------------- Running -----------------
+
+void run_scenario(const Scenario& sc, ScenarioResult& result) {
+    using clock = std::chrono::steady_clock;
+    result = ScenarioResult();
+
+    HeadlessSim sim(sc.settings);
+    ArkanoidImpl& game = sim.game();
+    if (sc.use_level) game.load_level(sc.level, sc.settings);
+    Autopilot pilot(sc.autopilot_seed);
+    bool pilot_on = sc.autopilot;
+
+    const bool time_steps = (sc.measures & ScenarioMeasure_Update) != 0;
+    const bool time_phases = (sc.measures & ScenarioMeasure_Phases) != 0;
+    std::vector<float> step_us(time_steps ? sc.steps : 0);
+
+    int held[GameKey_Count] = {};   // overlapping holds of one key release it once all have ended
+    uint32_t keys = 0;
+    const ScenarioOp* op = sc.ops.data();
+    const ScenarioOp* end = op + sc.ops.size();
+    ArkanoidImpl::Observation o;
+    auto restart = [&]() {
+        sim.reset(sc.settings);
+        if (sc.use_level) game.load_level(sc.level, sc.settings);
+        result.restarts++;
+    };
+
+    auto start = clock::now();
+    for (uint32_t step = 0; step < sc.steps; ++step) {
+        for (; op != end && op->step == step; ++op) {
+            switch (op->code) {
+            case ScenarioOpCode::KeyDown: held[op->arg]++; keys |= 1u << op->arg; break;
+            case ScenarioOpCode::KeyUp: if (held[op->arg] > 0 && --held[op->arg] == 0) keys &= ~(1u << op->arg); break;
+            case ScenarioOpCode::Powerup: ScenarioRunner::apply_powerup(game, op->arg); break;
+            case ScenarioOpCode::Restart: restart(); break;
+            case ScenarioOpCode::Autopilot: pilot_on = op->arg != 0; break;
+            }
+        }
+
+        uint32_t k = keys;
+        if (pilot_on) {
+            game.observe(o);
+            // Like the soak run, a finished game starts over: the steps measure play, not the Win/Lose screen
+            if (!o.playing) {
+                result.won |= o.won;
+                restart();
+                game.observe(o);
+            }
+            k |= pilot.keys(o);
+        }
+
+        if (time_steps) {
+            auto t0 = clock::now();
+            sim.step(sc.dt, k);
+            step_us[step] = std::chrono::duration<float, std::micro>(clock::now() - t0).count();
+        }
+        else sim.step(sc.dt, k);
+
+        if (time_phases) ScenarioRunner::take_phase_ms(game, result.phase_ms);
+    }
+    result.wall_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+    if (time_steps) {
+        double sum = 0.0;
+        for (float us : step_us) sum += us;
+        result.update_mean_us = sum / step_us.size();
+        std::sort(step_us.begin(), step_us.end());
+        auto pct = [&](double p) { return (double)step_us[std::min(step_us.size() - 1, (size_t)(p * (step_us.size() - 1) + 0.5))]; };
+        result.update_p50_us = pct(0.50);
+        result.update_p95_us = pct(0.95);
+        result.update_p99_us = pct(0.99);
+        result.update_max_us = step_us.back();
+    }
+
+    game.observe(o);
+    result.score = o.score;
+    result.destroyed_bricks = o.destroyed_bricks;
+    result.lives = o.lives;
+    result.won |= o.won;
+}
+
+static void dump_scenario(const Scenario& sc) {
+    printf("%s: %u steps of %.4f s, %zu ops (%zu bytes)%s\n", sc.name.c_str(), sc.steps, sc.dt, sc.ops.size(),
+        sc.ops.size() * sizeof(ScenarioOp), sc.autopilot ? ", autopilot" : "");
+    for (const ScenarioOp& op : sc.ops) {
+        printf("  %8u  %-9s ", op.step, op_name(op.code));
+        switch (op.code) {
+        case ScenarioOpCode::KeyDown: case ScenarioOpCode::KeyUp: printf("%c\n", game_key_names[op.arg]); break;
+        case ScenarioOpCode::Powerup: printf("%s\n", powerup_names[op.arg]); break;
+        case ScenarioOpCode::Autopilot: printf("%s\n", op.arg ? "on" : "off"); break;
+        default: printf("\n"); break;
+        }
+    }
+}
+
+static void print_result(const Scenario& sc, const ScenarioResult& r) {
+    printf("%s: %u steps in %.1f ms (%.0f steps/s)\n", sc.name.c_str(), sc.steps, r.wall_ms, sc.steps / (r.wall_ms * 0.001));
+    if (sc.measures & ScenarioMeasure_Update)
+        printf("  update us: mean %.2f  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f\n",
+            r.update_mean_us, r.update_p50_us, r.update_p95_us, r.update_p99_us, r.update_max_us);
+    if (sc.measures & ScenarioMeasure_Phases) {
+        printf("  phases ms:");
+        for (int p = 0; p < (int)PerfPhase::Count; ++p) printf("  %s %.2f", perf_phase_name((PerfPhase)p), r.phase_ms[p]);
+        printf("\n");
+    }
+    if (sc.measures & ScenarioMeasure_Game)
+        printf("  game: score %d  bricks %d  lives %d  restarts %d%s\n", r.score, r.destroyed_bricks, r.lives, r.restarts,
+            r.won ? "  won" : "");
+}
+
+int run_scenario_tool(int argc, char** argv) {
+    std::vector<const char*> paths;
+    int repeat = 1;
+    bool dump = false, usage = false;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--dump") == 0) dump = true;
+        else if (argv[i][0] != '-') paths.push_back(argv[i]);
+        else usage = true;
+    }
+    if (usage || paths.empty()) {
+        fprintf(stderr, "usage: --scenario [--repeat N] [--dump] <file.arks>...\n");
+        return 2;
+    }
+
+    int failed = 0;
+    for (const char* path : paths) {
+        Scenario sc;
+        std::string error;
+        if (!load_scenario(path, sc, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            failed++;
+            continue;
+        }
+        if (dump) { dump_scenario(sc); continue; }
+
+        // Runs are deterministic, only their timings differ: report the median one
+        std::vector<ScenarioResult> runs((size_t)repeat);
+        for (ScenarioResult& r : runs) run_scenario(sc, r);
+        std::sort(runs.begin(), runs.end(), [](const ScenarioResult& a, const ScenarioResult& b) { return a.wall_ms < b.wall_ms; });
+        print_result(sc, runs[runs.size() / 2]);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "arkanoid.h"
+#include "levelgen.h"
+#include "perf.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scripted benchmark workloads. A scenario is a small text file, one statement per line ('#' comments):
+//
+//   name      paddle_stress
+//   set       ball_speed 600                 ArkanoidSettings field override
+//   level     maze density=0.9 difficulty=0.7   generator (classic, noise, ...) or: level pack <file> [index]
+//   seed      42
+//   dt        1/60                           step length, seconds or a fraction
+//   steps     36000
+//   autopilot on [seed]                      the autopilot's keys are added to the scripted ones;
+//                                            while it plays, a won or lost game restarts
+//   at 0.5    hold A 1.5                     hold a key (A D R 1 2 3 C X T Q Y E N) for 1.5 s
+//   at 3      press N                        one step
+//   every 2 from 1   powerup pierce          repeat every 2 s; powerups: speed_up enlarge_paddle
+//                                            extra_life pierce slow_mo points magnet score_mult
+//   at 10     restart
+//   measure   update phases game             what to report (default: update game)
+//
+// Times are converted to steps and the script is compiled into a stream of ops sorted by step,
+// so running it costs a pointer compare per step on top of the simulation.
+
+enum class ScenarioOpCode : uint8_t { KeyDown, KeyUp, Powerup, Restart, Autopilot };
+
+struct ScenarioOp
+{
+    uint32_t step;
+    ScenarioOpCode code;
+    uint8_t arg;          // key bit, bonus type or on/off
+    uint16_t reserved;
+};
+
+enum ScenarioMeasure : uint32_t
+{
+    ScenarioMeasure_Update = 1u << 0,   // per-step update() time percentiles
+    ScenarioMeasure_Phases = 1u << 1,   // time per update phase
+    ScenarioMeasure_Game   = 1u << 2,   // score, bricks, lives, restarts at the end
+};
+
+struct Scenario
+{
+    std::string name;
+    ArkanoidSettings settings;
+    bool use_level = false;   // level from a pack instead of the generator
+    LevelData level;
+    float dt = 1.0f / 60.0f;
+    uint32_t steps = 3600;
+    bool autopilot = false;
+    uint32_t autopilot_seed = 1;
+    uint32_t measures = ScenarioMeasure_Update | ScenarioMeasure_Game;
+    std::vector<ScenarioOp> ops;
+};
+
+struct ScenarioResult
+{
+    double wall_ms = 0.0;
+    double update_mean_us = 0.0, update_p50_us = 0.0, update_p95_us = 0.0, update_p99_us = 0.0, update_max_us = 0.0;
+    double phase_ms[(int)PerfPhase::Count] = {};
+    int score = 0, destroyed_bricks = 0, lives = 0, restarts = 0;   // score..lives: the last game
+    bool won = false;                                               // any game
+};
+
+// Parse and compile a scenario; errors name the source and line
+bool compile_scenario(const std::string& text, const std::string& source, Scenario& out, std::string& error);
+bool load_scenario(const std::string& path, Scenario& out, std::string& error);
+
+void run_scenario(const Scenario& scenario, ScenarioResult& result);
+
+// --scenario [--repeat N] [--dump] <file.arks>...
+// Runs each scenario headless (--repeat times, reporting the median run) and prints its measures.
+// --dump prints the compiled op stream instead of running.
+int run_scenario_tool(int argc, char** argv);
@@ -0,0 +1,152 @@
+#include "soak.h"
+#include "mem_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+// ----------------- Series -----------------
+
+struct SoakSeriesInfo
+{
+    const char* name;
+    double min_growth;        // absolute growth over the run below which a trend is noise
+    double ceiling;           // values up to this are expected by design (caps, vector doubling)
+    double ceiling_per_cell;  // plus this much per cell of the largest level seen
+};
+
+static const SoakSeriesInfo series_info[(int)SoakSeries::Count] = {
+    { "rss_bytes",             4.0 * 1024 * 1024, 0.0, 0.0 },
+    { "heap_live_bytes",       1.0 * 1024 * 1024, 0.0, 0.0 },
+    { "heap_live_allocs",      1000.0, 0.0, 0.0 },
+    { "bricks_capacity",       16.0, 0.0, 2.0 },     // one per cell, doubled
+    { "bonuses_capacity",      16.0, 0.0, 2.0 },     // at most one per brick
+    { "particles_capacity",    16.0, 4096.0, 0.0 },  // highest quality level caps at 2048
+    { "ball_trail_capacity",   16.0, 32.0, 0.0 },    // 16 points at most
+    { "debug_hits_capacity",   16.0, 256.0, 0.0 },   // expire after debug_draw_timeout
+    { "shop_message_capacity", 16.0, 64.0, 0.0 },
+};
+
+const char* soak_series_name(SoakSeries s) { return series_info[(int)s].name; }
+
+
+
+// ----------------- Sampling -----------------
+
+void SoakMonitor::update(double time, const ArkanoidImpl& game, const ArkanoidDebugData& debug) {
+    if (time < next_time) return;
+    next_time = time + interval;
+
+    ArkanoidImpl::ContainerStats c;
+    game.container_stats(c);
+    MemStats mem = mem_stats();
+
+    Sample s;
+    s.time = time;
+    s.values[(int)SoakSeries::Rss] = (double)process_rss_bytes();
+    s.values[(int)SoakSeries::HeapLiveBytes] = (double)mem.live_bytes();
+    s.values[(int)SoakSeries::HeapLiveAllocs] = (double)mem.live_allocations();
+    s.values[(int)SoakSeries::Bricks] = (double)c.bricks;
+    s.values[(int)SoakSeries::Bonuses] = (double)c.bonuses;
+    s.values[(int)SoakSeries::Particles] = (double)c.particles;
+    s.values[(int)SoakSeries::BallTrail] = (double)c.ball_trail;
+    s.values[(int)SoakSeries::DebugHits] = (double)debug.hits.capacity();
+    s.values[(int)SoakSeries::ShopMessage] = (double)c.shop_message;
+    max_cells = std::max(max_cells, (double)game.brick_count());
+
+    // Keep the history bounded on multi-day runs
+    if (samples.size() >= max_samples) {
+        size_t j = 0;
+        for (size_t i = 0; i < samples.size(); i += 2) samples[j++] = samples[i];
+        samples.resize(j);
+        interval *= 2.0;
+        next_time = time + interval;
+    }
+    samples.push_back(s);
+}
+
+
+
+// ----------------- Analysis -----------------
+
+void SoakMonitor::analyze(Trend out[(int)SoakSeries::Count]) const {
+    for (int k = 0; k < (int)SoakSeries::Count; ++k) out[k] = Trend();
+    if (samples.empty()) return;
+
+    double t0 = samples.front().time, t1 = samples.back().time;
+    double warm_end = t0 + (t1 - t0) * warmup_fraction;
+    size_t begin = 0;
+    while (begin < samples.size() && samples[begin].time < warm_end) begin++;
+    size_t n = samples.size() - begin;
+
+    for (int k = 0; k < (int)SoakSeries::Count; ++k) {
+        Trend& tr = out[k];
+        tr.first = samples.front().values[k];
+        tr.last = samples.back().values[k];
+        tr.min = tr.max = tr.first;
+        for (const Sample& s : samples) {
+            tr.min = std::min(tr.min, s.values[k]);
+            tr.max = std::max(tr.max, s.values[k]);
+        }
+        if (n < 6) continue;   // too short to judge
+
+        // Least squares fit of value over time (hours)
+        double sx = 0, sy = 0, sxx = 0, sxy = 0, syy = 0;
+        for (size_t i = begin; i < samples.size(); ++i) {
+            double x = (samples[i].time - t0) / 3600.0, y = samples[i].values[k];
+            sx += x; sy += y; sxx += x * x; sxy += x * y; syy += y * y;
+        }
+        double cov = sxy - sx * sy / n, var_x = sxx - sx * sx / n, var_y = syy - sy * sy / n;
+        if (var_x <= 0.0) continue;
+        tr.slope_per_hour = cov / var_x;
+        tr.r2 = var_y > 0.0 ? cov * cov / (var_x * var_y) : 0.0;
+
+        // Sustained growth: a good linear fit, a rise above the noise floor and above 5% of the
+        // early level, still making new highs in the last third (capacities grow in steps)
+        // and past the level the container may legitimately reach
+        size_t third = n / 3;
+        double early_max = 0.0, late_max = 0.0;
+        for (size_t i = begin; i < begin + third; ++i) early_max = std::max(early_max, samples[i].values[k]);
+        for (size_t i = samples.size() - third; i < samples.size(); ++i) late_max = std::max(late_max, samples[i].values[k]);
+
+        double growth = tr.slope_per_hour * (t1 - warm_end) / 3600.0;
+        double ceiling = series_info[k].ceiling + series_info[k].ceiling_per_cell * max_cells;
+        tr.growing = tr.r2 >= 0.5 && growth > series_info[k].min_growth && growth > 0.05 * early_max && late_max > early_max &&
+                     late_max > ceiling;
+    }
+}
+
+bool SoakMonitor::write_report(const char* path) const {
+    Trend trends[(int)SoakSeries::Count];
+    analyze(trends);
+
+    std::string growing;
+    for (int k = 0; k < (int)SoakSeries::Count; ++k)
+        if (trends[k].growing) growing += std::string(growing.empty() ? "" : ", ") + series_info[k].name;
+
+    double duration = samples.empty() ? 0.0 : samples.back().time - samples.front().time;
+    char buf[256];
+    std::string text = "Arkanoid soak report\n";
+    snprintf(buf, sizeof(buf), "duration %.0f s, %zu samples every %.0f s, warmup %.0f%%\n\n",
+        duration, samples.size(), interval, warmup_fraction * 100.0);
+    text += buf;
+    snprintf(buf, sizeof(buf), "%-22s %14s %14s %14s %14s %14s %6s  %s\n", "series", "first", "last", "min", "max", "slope/h", "r2", "verdict");
+    text += buf;
+    for (int k = 0; k < (int)SoakSeries::Count; ++k) {
+        const Trend& t = trends[k];
+        snprintf(buf, sizeof(buf), "%-22s %14.0f %14.0f %14.0f %14.0f %14.1f %6.2f  %s\n", series_info[k].name,
+            t.first, t.last, t.min, t.max, t.slope_per_hour, t.r2, t.growing ? "GROWING" : "flat");
+        text += buf;
+    }
+    text += growing.empty() ? "\nresult: memory flat\n" : "\nresult: sustained growth in " + growing + "\n";
+
+    fputs(text.c_str(), stdout);
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write soak report %s\n", path);
+        return false;
+    }
+    fputs(text.c_str(), f);
+    fclose(f);
+    return growing.empty();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "arkanoid_impl.h"
+#include <vector>
+
+// Quantities tracked during a soak run
+enum class SoakSeries
+{
+    Rss, HeapLiveBytes, HeapLiveAllocs,
+    Bricks, Bonuses, Particles, BallTrail, DebugHits, ShopMessage,   // container capacities
+    Count
+};
+
+const char* soak_series_name(SoakSeries s);
+
+// Periodically samples memory and container capacities during long autopilot runs,
+// fits a linear trend per series and flags the ones that keep growing.
+// Memory use is bounded: past max_samples the history is thinned to every other sample.
+class SoakMonitor
+{
+public:
+    static constexpr size_t max_samples = 4096;
+
+    struct Sample {
+        double time;
+        double values[(int)SoakSeries::Count];
+    };
+
+    struct Trend {
+        double first = 0.0, last = 0.0, min = 0.0, max = 0.0;
+        double slope_per_hour = 0.0;   // least squares fit after warmup
+        double r2 = 0.0;
+        bool growing = false;
+    };
+
+    explicit SoakMonitor(double interval_seconds = 10.0) : interval(interval_seconds) {}
+
+    // Takes a sample when the interval has elapsed since the previous one
+    void update(double time, const ArkanoidImpl& game, const ArkanoidDebugData& debug);
+
+    void analyze(Trend out[(int)SoakSeries::Count]) const;
+
+    // Writes the report; returns false if any series shows sustained growth (or the file can't be written)
+    bool write_report(const char* path) const;
+
+    size_t sample_count() const { return samples.size(); }
+
+    double warmup_fraction = 0.1;   // leading part of the run ignored by the fit (caches and pools filling up)
+
+private:
+    double interval;
+    double next_time = 0.0;
+    std::vector<Sample> samples;
+    double max_cells = 0.0;         // largest brick grid sampled (cols * rows), scales the capacity ceilings
+};
@@ -0,0 +1,176 @@
+#include "soft_raster.h"
+#include "video_capture.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct RasterVertex
+{
+    float x, y, u, v;
+    float c[4];   // 0..1
+};
+
+RasterVertex make_vertex(const ImDrawVert& v, const ImVec2& origin) {
+    RasterVertex r;
+    r.x = v.pos.x - origin.x;
+    r.y = v.pos.y - origin.y;
+    r.u = v.uv.x;
+    r.v = v.uv.y;
+    for (int i = 0; i < 4; ++i) r.c[i] = ((v.col >> (i * 8)) & 0xFF) / 255.0f;
+    return r;
+}
+
+inline float edge(const RasterVertex& a, const RasterVertex& b, float px, float py) {
+    return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+}
+
+// Exactly one of the two directions of an edge owns the pixels lying on it
+inline bool owns_edge(const RasterVertex& a, const RasterVertex& b) {
+    float dx = b.x - a.x, dy = b.y - a.y;
+    return dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+}
+
+inline bool inside(float w, bool owned) { return w > 0.0f || (w == 0.0f && owned); }
+
+inline int to_byte(float v) { return (int)(std::min(1.0f, std::max(0.0f, v)) * 255.0f + 0.5f); }
+
+void draw_triangle(RgbaImage& img, RasterVertex a, RasterVertex b, RasterVertex c, const RasterTexture* tex, const int clip[4]) {
+    float area = edge(a, b, c.x, c.y);
+    if (area == 0.0f) return;
+    if (area < 0.0f) { std::swap(b, c); area = -area; }
+
+    int x0 = std::max(clip[0], (int)std::floor(std::min(a.x, std::min(b.x, c.x))));
+    int y0 = std::max(clip[1], (int)std::floor(std::min(a.y, std::min(b.y, c.y))));
+    int x1 = std::min(clip[2], (int)std::ceil(std::max(a.x, std::max(b.x, c.x))));
+    int y1 = std::min(clip[3], (int)std::ceil(std::max(a.y, std::max(b.y, c.y))));
+    if (x0 >= x1 || y0 >= y1) return;
+
+    bool own_a = owns_edge(b, c), own_b = owns_edge(c, a), own_c = owns_edge(a, b);
+    float inv_area = 1.0f / area;
+
+    for (int y = y0; y < y1; ++y) {
+        float py = y + 0.5f;
+        for (int x = x0; x < x1; ++x) {
+            float px = x + 0.5f;
+            float wa = edge(b, c, px, py), wb = edge(c, a, px, py), wc = edge(a, b, px, py);
+            if (!inside(wa, own_a) || !inside(wb, own_b) || !inside(wc, own_c)) continue;
+            wa *= inv_area;
+            wb *= inv_area;
+            wc *= inv_area;
+
+            float src[4];
+            for (int i = 0; i < 4; ++i) src[i] = a.c[i] * wa + b.c[i] * wb + c.c[i] * wc;
+            if (tex && tex->rgba) {
+                float u = a.u * wa + b.u * wb + c.u * wc;
+                float v = a.v * wa + b.v * wb + c.v * wc;
+                int tx = std::min(tex->width - 1, std::max(0, (int)(u * tex->width)));
+                int ty = std::min(tex->height - 1, std::max(0, (int)(v * tex->height)));
+                const unsigned char* t = tex->rgba + ((size_t)ty * tex->width + tx) * 4;
+                for (int i = 0; i < 4; ++i) src[i] *= t[i] / 255.0f;
+            }
+            if (src[3] <= 0.0f) continue;
+
+            ImU32& dst = img.at(x, y);
+            ImU32 out = 0xFF000000u;
+            for (int i = 0; i < 3; ++i) {
+                float d = ((dst >> (i * 8)) & 0xFF) / 255.0f;
+                out |= (ImU32)to_byte(src[i] * src[3] + d * (1.0f - src[3])) << (i * 8);
+            }
+            dst = out;
+        }
+    }
+}
+
+} // namespace
+
+void rasterize_draw_lists(const ImDrawList* const* lists, int count, const ImVec2& display_pos, RgbaImage& target) {
+    for (int l = 0; l < count; ++l) {
+        const ImDrawList* dl = lists[l];
+        for (const ImDrawCmd& cmd : dl->CmdBuffer) {
+            if (cmd.UserCallback) continue;
+
+            // Same integer scissor as the GL backend
+            int clip[4] = {
+                std::max(0, (int)(cmd.ClipRect.x - display_pos.x)),
+                std::max(0, (int)(cmd.ClipRect.y - display_pos.y)),
+                std::min(target.width, (int)(cmd.ClipRect.z - display_pos.x)),
+                std::min(target.height, (int)(cmd.ClipRect.w - display_pos.y)) };
+            if (clip[0] >= clip[2] || clip[1] >= clip[3]) continue;
+
+            const RasterTexture* tex = (const RasterTexture*)cmd.TextureId;
+            const ImDrawIdx* idx = dl->IdxBuffer.Data + cmd.IdxOffset;
+            const ImDrawVert* vtx = dl->VtxBuffer.Data + cmd.VtxOffset;
+            for (unsigned int i = 0; i + 2 < cmd.ElemCount; i += 3)
+                draw_triangle(target, make_vertex(vtx[idx[i]], display_pos), make_vertex(vtx[idx[i + 1]], display_pos),
+                    make_vertex(vtx[idx[i + 2]], display_pos), tex, clip);
+        }
+    }
+}
+
+
+
+// ----------------- PPM -----------------
+
+bool save_ppm(const std::string& path, const RgbaImage& image) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    fprintf(f, "P6\n%d %d\n255\n", image.width, image.height);
+    std::vector<unsigned char> row((size_t)image.width * 3);
+    for (int y = 0; y < image.height; ++y) {
+        for (int x = 0; x < image.width; ++x) {
+            ImU32 p = image.at(x, y);
+            row[x * 3 + 0] = (unsigned char)(p & 0xFF);
+            row[x * 3 + 1] = (unsigned char)((p >> 8) & 0xFF);
+            row[x * 3 + 2] = (unsigned char)((p >> 16) & 0xFF);
+        }
+        fwrite(row.data(), 1, row.size(), f);
+    }
+    return fclose(f) == 0;
+}
+
+bool load_ppm(const std::string& path, RgbaImage& image) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    int w = 0, h = 0, maxval = 0;
+    bool ok = fscanf(f, "P6 %d %d %d", &w, &h, &maxval) == 3 && fgetc(f) != EOF && w > 0 && h > 0 && maxval == 255;
+    if (ok) {
+        image.resize(w, h, 0xFF000000u);
+        std::vector<unsigned char> row((size_t)w * 3);
+        for (int y = 0; y < h && ok; ++y) {
+            ok = fread(row.data(), 1, row.size(), f) == row.size();
+            for (int x = 0; ok && x < w; ++x)
+                image.at(x, y) = IM_COL32(row[x * 3 + 0], row[x * 3 + 1], row[x * 3 + 2], 255);
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+bool save_qoi(const std::string& path, const RgbaImage& image) {
+    std::vector<uint8_t> data;
+    size_t size = qoi_encode((const uint8_t*)image.pixels.data(), image.width, image.height, false, data);
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, size, f) == size;
+    return fclose(f) == 0 && ok;
+}
+
+bool load_qoi(const std::string& path, RgbaImage& image) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    std::vector<uint8_t> data;
+    char buf[1 << 16];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    int w = 0, h = 0;
+    std::vector<uint8_t> rgba;
+    if (!qoi_decode(data.data(), data.size(), w, h, rgba)) return false;
+    image.resize(w, h, 0xFF000000u);
+    memcpy(image.pixels.data(), rgba.data(), rgba.size());
+    for (ImU32& p : image.pixels) p |= 0xFF000000u;   // IM_COL32_A_MASK
+    return true;
+}
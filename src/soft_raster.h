@@ -0,0 +1,43 @@
+#pragma once
+
+#include "base.h"
+#include <string>
+#include <vector>
+
+// 8-bit RGBA image, row-major, pixels packed like ImU32 (IM_COL32)
+struct RgbaImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<ImU32> pixels;
+
+    void resize(int w, int h, ImU32 fill) {
+        width = w;
+        height = h;
+        pixels.assign((size_t)w * h, fill);
+    }
+    ImU32& at(int x, int y) { return pixels[(size_t)y * width + x]; }
+    ImU32 at(int x, int y) const { return pixels[(size_t)y * width + x]; }
+};
+
+// RGBA texture for the rasterizer; an ImTextureID of the draw lists points to one (nullptr = white)
+struct RasterTexture
+{
+    const unsigned char* rgba = nullptr;
+    int width = 0;
+    int height = 0;
+};
+
+// Renders ImGui draw lists on the CPU the way the OpenGL3 backend does: scissored triangles,
+// vertex colour times the nearest texel, SRC_ALPHA / ONE_MINUS_SRC_ALPHA blending. Shared edges use
+// a top-left rule, so adjacent triangles never blend a pixel twice. Output is bit-exact for a
+// given input, whatever the thread it runs on. Draw callbacks are skipped.
+void rasterize_draw_lists(const ImDrawList* const* lists, int count, const ImVec2& display_pos, RgbaImage& target);
+
+// Binary PPM (P6) of the RGB channels; loading sets alpha to 255
+bool save_ppm(const std::string& path, const RgbaImage& image);
+bool load_ppm(const std::string& path, RgbaImage& image);
+
+// QOI of the RGB channels (lossless, a few percent of the PPM for UI captures); loading sets alpha to 255
+bool save_qoi(const std::string& path, const RgbaImage& image);
+bool load_qoi(const std::string& path, RgbaImage& image);
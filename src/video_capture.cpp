@@ -0,0 +1,343 @@
+#include "video_capture.h"
+#include "soft_raster.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+static double now_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const char capture_magic[4] = { 'A', 'R', 'K', 'V' };
+static const uint32_t capture_version = 1;
+static const long capture_frame_count_offset = 20;
+
+
+
+// ----------------- QOI -----------------
+
+enum : uint8_t
+{
+    QOI_OP_INDEX = 0x00,
+    QOI_OP_DIFF  = 0x40,
+    QOI_OP_LUMA  = 0x80,
+    QOI_OP_RUN   = 0xc0,
+    QOI_OP_RGB   = 0xfe,
+    QOI_OP_RGBA  = 0xff,
+    QOI_MASK_2   = 0xc0,
+};
+
+static const uint8_t qoi_padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+static inline uint8_t* put_be32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+    return p + 4;
+}
+
+static inline uint32_t get_be32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static inline int qoi_hash(uint32_t px) {
+    return ((px & 0xFF) * 3 + ((px >> 8) & 0xFF) * 5 + ((px >> 16) & 0xFF) * 7 + (px >> 24) * 11) % 64;
+}
+
+size_t qoi_encode(const uint8_t* rgba, int width, int height, bool flip_y, std::vector<uint8_t>& out) {
+    size_t worst = 14 + (size_t)width * height * 4 + sizeof(qoi_padding);
+    if (out.size() < worst) out.resize(worst);
+
+    uint8_t* p = out.data();
+    memcpy(p, "qoif", 4);
+    p = put_be32(p + 4, (uint32_t)width);
+    p = put_be32(p, (uint32_t)height);
+    *p++ = 3;   // RGB
+    *p++ = 0;   // sRGB
+
+    uint32_t index[64] = {};
+    uint32_t prev = 0xFF000000u;
+    int run = 0;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* src = rgba + (size_t)(flip_y ? height - 1 - y : y) * width * 4;
+        for (int x = 0; x < width; ++x, src += 4) {
+            uint32_t px = (uint32_t)src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16 | 0xFF000000u;
+            if (px == prev) {
+                if (++run == 62) { *p++ = QOI_OP_RUN | (run - 1); run = 0; }
+                continue;
+            }
+            if (run) { *p++ = QOI_OP_RUN | (run - 1); run = 0; }
+
+            int h = qoi_hash(px);
+            if (index[h] == px) {
+                *p++ = QOI_OP_INDEX | (uint8_t)h;
+            } else {
+                index[h] = px;
+                int dr = (int8_t)(src[0] - (uint8_t)prev);
+                int dg = (int8_t)(src[1] - (uint8_t)(prev >> 8));
+                int db = (int8_t)(src[2] - (uint8_t)(prev >> 16));
+                int dr_dg = dr - dg, db_dg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    *p++ = QOI_OP_DIFF | (uint8_t)((dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                    *p++ = QOI_OP_LUMA | (uint8_t)(dg + 32);
+                    *p++ = (uint8_t)((dr_dg + 8) << 4 | (db_dg + 8));
+                } else {
+                    *p++ = QOI_OP_RGB;
+                    *p++ = src[0];
+                    *p++ = src[1];
+                    *p++ = src[2];
+                }
+            }
+            prev = px;
+        }
+    }
+    if (run) *p++ = QOI_OP_RUN | (run - 1);
+    memcpy(p, qoi_padding, sizeof(qoi_padding));
+    p += sizeof(qoi_padding);
+    return (size_t)(p - out.data());
+}
+
+bool qoi_decode(const uint8_t* data, size_t size, int& width, int& height, std::vector<uint8_t>& rgba) {
+    if (size < 14 + sizeof(qoi_padding) || memcmp(data, "qoif", 4) != 0) return false;
+    width = (int)get_be32(data + 4);
+    height = (int)get_be32(data + 8);
+    if (width <= 0 || height <= 0 || (uint64_t)width * height > (1u << 28)) return false;
+    rgba.resize((size_t)width * height * 4);
+
+    const uint8_t* p = data + 14;
+    const uint8_t* end = data + size - sizeof(qoi_padding);
+    uint8_t index[64][4] = {};
+    uint8_t px[4] = { 0, 0, 0, 255 };
+    int run = 0;
+    for (size_t i = 0, n = (size_t)width * height; i < n; ++i) {
+        if (run > 0) {
+            run--;
+        } else {
+            if (p >= end) return false;
+            uint8_t op = *p++;
+            if (op == QOI_OP_RGB) {
+                if (end - p < 3) return false;
+                px[0] = p[0]; px[1] = p[1]; px[2] = p[2];
+                p += 3;
+            } else if (op == QOI_OP_RGBA) {
+                if (end - p < 4) return false;
+                memcpy(px, p, 4);
+                p += 4;
+            } else if ((op & QOI_MASK_2) == QOI_OP_INDEX) {
+                memcpy(px, index[op], 4);
+            } else if ((op & QOI_MASK_2) == QOI_OP_DIFF) {
+                px[0] += ((op >> 4) & 3) - 2;
+                px[1] += ((op >> 2) & 3) - 2;
+                px[2] += (op & 3) - 2;
+            } else if ((op & QOI_MASK_2) == QOI_OP_LUMA) {
+                if (p >= end) return false;
+                int dg = (op & 0x3f) - 32;
+                px[0] += dg - 8 + ((*p >> 4) & 0x0f);
+                px[1] += dg;
+                px[2] += dg - 8 + (*p & 0x0f);
+                p++;
+            } else {
+                run = op & 0x3f;
+            }
+            uint32_t packed = (uint32_t)px[0] | (uint32_t)px[1] << 8 | (uint32_t)px[2] << 16 | (uint32_t)px[3] << 24;
+            memcpy(index[qoi_hash(packed)], px, 4);
+        }
+        memcpy(&rgba[i * 4], px, 4);
+    }
+    return memcmp(end, qoi_padding, sizeof(qoi_padding)) == 0;
+}
+
+
+
+// ----------------- Capture pipeline -----------------
+
+void CaptureStats::print(FILE* f) const {
+    double mb = 1024.0 * 1024.0;
+    fprintf(f, "capture: %llu frames, %.1f MB raw -> %.1f MB (%.1fx), encode %.0f MB/s per thread, %.1f frames/s wall, waited %.2f s\n",
+        (unsigned long long)frames, raw_bytes / mb, encoded_bytes / mb, ratio(),
+        encode_seconds > 0.0 ? raw_bytes / mb / encode_seconds : 0.0,
+        wall_seconds > 0.0 ? frames / wall_seconds : 0.0, wait_seconds);
+}
+
+bool VideoCapture::open(const std::string& path, int width, int height, int fps, unsigned threads, int max_in_flight) {
+    close();
+    if (!file.open(path)) return false;
+
+    uint32_t header[5] = { capture_version, (uint32_t)width, (uint32_t)height, (uint32_t)fps, 0 };
+    if (!file.write(capture_magic, 4) || !file.write(header, sizeof(header))) {
+        file.close();
+        return false;
+    }
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency() - 1);
+    if (max_in_flight <= 0) max_in_flight = (int)threads * 2;
+    slots = std::vector<Slot>((size_t)max_in_flight);
+    next_seq = next_write = 0;
+    stopping = failed = false;
+    totals = CaptureStats();
+    open_time = now_seconds();
+    for (unsigned i = 0; i < threads; ++i) workers.emplace_back(&VideoCapture::worker, this);
+    return true;
+}
+
+bool VideoCapture::push_frame(const uint8_t* rgba, int width, int height, bool flip_y) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!file.is_open() || failed) return false;
+
+    // Back-pressure: wait for the oldest frames to reach the file
+    auto free_slot = [&]() {
+        for (Slot& s : slots) if (s.state == Slot::State::Free) return &s;
+        return (Slot*)nullptr;
+    };
+    Slot* slot = free_slot();
+    if (!slot) {
+        double t0 = now_seconds();
+        slot_freed.wait(lock, [&]() { return failed || (slot = free_slot()) != nullptr; });
+        totals.wait_seconds += now_seconds() - t0;
+        if (failed) return false;
+    }
+    slot->state = Slot::State::Filling;
+    slot->seq = next_seq++;
+    lock.unlock();
+
+    size_t bytes = (size_t)width * height * 4;
+    if (slot->raw.size() < bytes) slot->raw.resize(bytes);
+    memcpy(slot->raw.data(), rgba, bytes);
+    slot->width = width;
+    slot->height = height;
+    slot->flip_y = flip_y;
+
+    lock.lock();
+    slot->state = Slot::State::Queued;
+    totals.raw_bytes += bytes;
+    work_ready.notify_one();
+    return true;
+}
+
+void VideoCapture::worker() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        // Oldest queued frame first, so the writer is never kept waiting on a late one
+        Slot* job = nullptr;
+        for (Slot& s : slots)
+            if (s.state == Slot::State::Queued && (!job || s.seq < job->seq)) job = &s;
+        if (!job) {
+            if (stopping) return;
+            work_ready.wait(lock);
+            continue;
+        }
+
+        job->state = Slot::State::Encoding;
+        lock.unlock();
+        double t0 = now_seconds();
+        job->encoded_size = qoi_encode(job->raw.data(), job->width, job->height, job->flip_y, job->encoded);
+        double t1 = now_seconds();
+        lock.lock();
+
+        job->state = Slot::State::Encoded;
+        totals.encode_seconds += t1 - t0;
+        write_ready_locked();
+    }
+}
+
+// Append every encoded frame that is next in order
+void VideoCapture::write_ready_locked() {
+    for (bool wrote = true; wrote;) {
+        wrote = false;
+        for (Slot& s : slots) {
+            if (s.state != Slot::State::Encoded || s.seq != next_write) continue;
+            uint32_t size = (uint32_t)s.encoded_size;
+            if (!failed && (!file.write(&size, sizeof(size)) || !file.write(s.encoded.data(), size)))
+                failed = true;
+            totals.frames++;
+            totals.encoded_bytes += size;
+            s.state = Slot::State::Free;
+            next_write++;
+            wrote = true;
+        }
+    }
+    slot_freed.notify_all();
+}
+
+bool VideoCapture::close() {
+    if (!file.is_open()) return true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (auto& t : workers) t.join();
+    workers.clear();
+
+    uint32_t frames = (uint32_t)totals.frames;
+    bool ok = !failed && file.write_at(&frames, sizeof(frames), capture_frame_count_offset);
+    ok = file.close() && ok;
+    slots.clear();
+    totals.wall_seconds = now_seconds() - open_time;
+    return ok;
+}
+
+
+
+// ----------------- Export tool -----------------
+
+int run_capture_export_tool(int argc, char** argv) {
+    const char* path = nullptr;
+    const char* out_dir = nullptr;
+    int every = 1;
+    for (int i = 0; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--every") == 0 && has_value) every = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "-o") == 0 && has_value) out_dir = argv[++i];
+        else if (!path) path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: --capture-export <capture.arkv> [--every N] [-o dir]\n");
+        return 2;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    char magic[4];
+    uint32_t header[5];
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, capture_magic, 4) != 0 || fread(header, sizeof(header), 1, f) != 1 || header[0] != capture_version) {
+        fprintf(stderr, "%s: not an .arkv capture\n", path);
+        fclose(f);
+        return 1;
+    }
+
+    // The frame count is 0 when the capture was cut short; read until the data ends then
+    std::vector<uint8_t> encoded, rgba;
+    RgbaImage image;
+    uint64_t raw_bytes = 0, encoded_bytes = 0;
+    uint32_t frames = 0, size = 0;
+    bool ok = true;
+    while ((header[4] == 0 || frames < header[4]) && fread(&size, sizeof(size), 1, f) == 1) {
+        encoded.resize(size);
+        int w = 0, h = 0;
+        if (fread(encoded.data(), 1, size, f) != size || !qoi_decode(encoded.data(), size, w, h, rgba)) {
+            fprintf(stderr, "frame %u: corrupt\n", frames);
+            ok = false;
+            break;
+        }
+        if (out_dir && frames % every == 0) {
+            image.resize(w, h, 0);
+            memcpy(image.pixels.data(), rgba.data(), rgba.size());
+            char name[64];
+            snprintf(name, sizeof(name), "/frame_%06u.ppm", frames);
+            ok = save_ppm(std::string(out_dir) + name, image) && ok;
+        }
+        raw_bytes += rgba.size();
+        encoded_bytes += size;
+        frames++;
+    }
+    fclose(f);
+    if (header[4] != 0 && frames != header[4]) ok = false;
+
+    printf("%s: %u frames %ux%u @ %u fps, %.1f MB encoded, %.1f MB raw (%.1fx)%s\n", path, frames, header[1], header[2], header[3],
+        encoded_bytes / 1048576.0, raw_bytes / 1048576.0, encoded_bytes ? (double)raw_bytes / encoded_bytes : 0.0, ok ? "" : ", errors");
+    return ok ? 0 : 1;
+}
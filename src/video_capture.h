@@ -0,0 +1,88 @@
+#pragma once
+
+#include "async_io.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Gameplay capture: every frame is encoded losslessly as a QOI image on a pool of worker threads
+// and appended to an .arkv file. Frames are encoded out of order but written in order, and at most
+// 'max_in_flight' frames are buffered (push_frame() waits for a free slot), so memory stays bounded
+// whatever the disk does. Encoded frames go out through the shared async I/O engine. Typical
+// gameplay compresses 8-20x against raw RGBA.
+//
+// .arkv layout (little-endian): "ARKV", version, width, height, fps, frame count (0 until closed),
+// then per frame: u32 byte size + a complete QOI image (its own header carries the frame size).
+struct CaptureStats
+{
+    uint64_t frames = 0;
+    uint64_t raw_bytes = 0;          // RGBA bytes submitted
+    uint64_t encoded_bytes = 0;      // QOI bytes written
+    double encode_seconds = 0.0;     // summed over workers
+    double wall_seconds = 0.0;       // open() to close()
+    double wait_seconds = 0.0;       // push_frame() blocked on a full pipeline
+
+    double ratio() const { return encoded_bytes ? (double)raw_bytes / encoded_bytes : 0.0; }
+    void print(FILE* f) const;
+};
+
+class VideoCapture
+{
+public:
+    VideoCapture() = default;
+    VideoCapture(const VideoCapture&) = delete;
+    VideoCapture& operator=(const VideoCapture&) = delete;
+    ~VideoCapture() { close(); }
+
+    // threads == 0: one per core minus one (the game keeps a core); max_in_flight == 0: 2 per thread
+    bool open(const std::string& path, int width, int height, int fps, unsigned threads = 0, int max_in_flight = 0);
+    bool is_open() const { return file.is_open(); }
+
+    // Copy an RGBA8 frame into the pipeline (alpha is ignored). flip_y: rows are bottom-up (glReadPixels)
+    bool push_frame(const uint8_t* rgba, int width, int height, bool flip_y);
+
+    // Drain the pipeline, finish the file; false if anything failed to encode or write
+    bool close();
+
+    const CaptureStats& stats() const { return totals; }
+
+private:
+    struct Slot
+    {
+        std::vector<uint8_t> raw;
+        std::vector<uint8_t> encoded;   // capacity for the worst case, encoded_size used
+        size_t encoded_size = 0;
+        int width = 0, height = 0;
+        bool flip_y = false;
+        uint64_t seq = 0;
+        enum class State { Free, Filling, Queued, Encoding, Encoded } state = State::Free;
+    };
+
+    void worker();
+    void write_ready_locked();
+
+    AsyncFile file;
+    std::vector<Slot> slots;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_ready;    // a slot was queued (or stopping)
+    std::condition_variable slot_freed;    // a slot was written out
+    uint64_t next_seq = 0;                 // next frame pushed
+    uint64_t next_write = 0;               // next frame to hit the file
+    bool stopping = false;
+    bool failed = false;
+    CaptureStats totals;
+    double open_time = 0.0;
+};
+
+// QOI (qoiformat.org) of an RGBA8 image, written as 3 channels. out only grows (to the worst case),
+// so a reused buffer is never cleared; returns the encoded size
+size_t qoi_encode(const uint8_t* rgba, int width, int height, bool flip_y, std::vector<uint8_t>& out);
+bool qoi_decode(const uint8_t* data, size_t size, int& width, int& height, std::vector<uint8_t>& rgba);
+
+// --capture-export <capture.arkv> [--every N] [-o dir]: decode a capture, check it and write frames as PPM
+int run_capture_export_tool(int argc, char** argv);
@@ -0,0 +1,73 @@
+#include "world_layer.h"
+#include <algorithm>
+#include <cmath>
+
+void RenderScaleGovernor::add_frame(float frame_ms) {
+    avg_ms += (frame_ms - avg_ms) * 0.2f;
+    since_restore++;
+    if (restore_wait == 0) restore_wait = restore_after;
+    if (!enabled) { over_frames = under_frames = 0; return; }
+
+    if (avg_ms > target_ms * over_ratio) { over_frames++; under_frames = 0; }
+    else if (avg_ms < target_ms * restore_ratio) { under_frames++; over_frames = 0; }
+    else { over_frames = 0; under_frames = 0; }
+
+    if (over_frames >= degrade_after && cur_scale > min_scale) {
+        cur_scale = std::max(min_scale, cur_scale - step);
+        over_frames = 0;
+        // The last step up didn't hold: wait longer before the next one
+        if (since_restore < restore_wait) restore_wait = std::min(restore_wait * 2, restore_after * 32);
+    }
+    else if (under_frames >= restore_wait && cur_scale < 1.0f) {
+        cur_scale = std::min(1.0f, cur_scale + step);
+        under_frames = 0;
+        since_restore = 0;
+    }
+}
+
+void RenderScaleGovernor::set_scale(float s) {
+    cur_scale = std::max(min_scale, std::min(1.0f, s));
+    over_frames = under_frames = 0;
+    restore_wait = restore_after;
+}
+
+
+
+WorldLayer::~WorldLayer() {
+    if (list) IM_DELETE(list);
+}
+
+ImDrawList& WorldLayer::begin(const ImVec2& display_size, const ImVec2& framebuffer_scale, ImTextureID font_texture) {
+    // The shared data belongs to the current ImGui context, which may change between frames (tools)
+    if (!list) list = IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData());
+    list->_Data = ImGui::GetDrawListSharedData();
+
+    display = ImVec2(std::max(1.0f, display_size.x), std::max(1.0f, display_size.y));
+    float s = governor.scale();
+    w = std::max(1, (int)std::lround(display.x * std::max(1.0f, framebuffer_scale.x) * s));
+    h = std::max(1, (int)std::lround(display.y * std::max(1.0f, framebuffer_scale.y) * s));
+
+    list->_ResetForNewFrame();
+    list->PushTextureID(font_texture);
+    list->PushClipRect(ImVec2(0.0f, 0.0f), ImVec2((float)w, (float)h));
+    return *list;
+}
+
+void WorldLayer::composite(ImDrawList& dl) const {
+    ImVec2 uv0(0.0f, flip ? 1.0f : 0.0f), uv1(1.0f, flip ? 0.0f : 1.0f);
+    dl.AddImage(texture, ImVec2(0.0f, 0.0f), display, uv0, uv1);
+}
+
+ImDrawData* WorldLayer::draw_data() {
+    lists[0] = list;
+    data.Clear();
+    data.Valid = list != nullptr;
+    data.CmdLists = lists;
+    data.CmdListsCount = list ? 1 : 0;
+    data.TotalVtxCount = list ? list->VtxBuffer.Size : 0;
+    data.TotalIdxCount = list ? list->IdxBuffer.Size : 0;
+    data.DisplayPos = ImVec2(0.0f, 0.0f);
+    data.DisplaySize = ImVec2((float)w, (float)h);
+    data.FramebufferScale = ImVec2(1.0f, 1.0f);
+    return &data;
+}
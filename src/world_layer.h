@@ -0,0 +1,76 @@
+#pragma once
+
+#include "base.h"
+
+// Picks the world layer's internal resolution from frame-time headroom: the scale steps down
+// while frames run over the target and back up after a long run of frames that make it. With
+// vsync a frame that makes it looks the same however much room is left, so a step up that has
+// to be dropped again right away doubles the wait before the next try.
+class RenderScaleGovernor
+{
+public:
+    bool enabled = true;
+    float target_ms = 1000.0f / 60.0f;   // frame time to hold (the refresh period with vsync)
+    float over_ratio = 1.15f;            // over budget above target * ratio
+    float restore_ratio = 1.03f;         // headroom below target * ratio
+    float min_scale = 0.5f;
+    float step = 0.125f;
+    int degrade_after = 15;              // consecutive frames over budget
+    int restore_after = 180;             // consecutive frames with headroom (before backoff)
+
+    void add_frame(float frame_ms);
+    void set_scale(float s);
+    float scale() const { return cur_scale; }
+
+private:
+    float cur_scale = 1.0f;
+    float avg_ms = 0.0f;
+    int over_frames = 0;
+    int under_frames = 0;
+    int restore_wait = 0;                // restore_after with backoff, 0 = not started
+    int since_restore = 1 << 30;
+};
+
+// Offscreen world layer. The world is recorded into its own draw list at the internal
+// resolution; the host renders that list into a texture (OpenGL framebuffer or the CPU
+// rasterizer) and the frame's draw list only gets one quad that upscales it to the display.
+// HUD, labels and menus keep drawing at native resolution on top.
+//
+// Per frame: begin() -> record the world -> composite() into the frame; the host renders
+// draw_data() into its texture before it renders the frame.
+class WorldLayer
+{
+public:
+    RenderScaleGovernor governor;
+    bool enabled = false;
+
+    WorldLayer() = default;
+    WorldLayer(const WorldLayer&) = delete;
+    WorldLayer& operator=(const WorldLayer&) = delete;
+    ~WorldLayer();
+
+    // Texture the host renders the layer into; flip_v when its rows go bottom-up (OpenGL)
+    void set_texture(ImTextureID tex, bool flip_v) { texture = tex; flip = flip_v; }
+    bool active() const { return enabled && texture != nullptr; }
+
+    // Start this frame's layer at the governor's scale of the display in framebuffer pixels
+    ImDrawList& begin(const ImVec2& display_size, const ImVec2& framebuffer_scale, ImTextureID font_texture);
+    int width() const { return w; }
+    int height() const { return h; }
+    Vect scale_from_display() const { return Vect(w / display.x, h / display.y); }
+
+    void composite(ImDrawList& dl) const;
+
+    // The layer's draw list as draw data of its own size, for the host's renderer
+    ImDrawData* draw_data();
+    const ImDrawList* draw_list() const { return list; }
+
+private:
+    ImDrawList* list = nullptr;
+    ImDrawList* lists[1] = {};
+    ImDrawData data;
+    ImTextureID texture = nullptr;
+    bool flip = false;
+    int w = 0, h = 0;
+    ImVec2 display = ImVec2(1.0f, 1.0f);
+};